@@ -0,0 +1,1229 @@
+#include "utl/utl.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#ifdef __unix__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+struct entry {
+    std::string name;
+    size_t size;
+    size_t bytes;
+    utl::bench_result res;
+};
+
+std::vector<entry> results;
+utl::bench_cfg cfg;
+const char *filter;
+std::mt19937 rng{42};
+
+/**
+ * @brief Register and run single benchmark.
+ *
+ * @param name Benchmark family name
+ * @param size Input size, appended to name
+ * @param bytes Bytes processed by single call, 0 if not applicable
+ * @param fn Callable to measure
+ */
+template<class Fn>
+void run(const char *name, size_t size, size_t bytes, Fn &&fn)
+{
+    auto full = std::string(name) + "/" + std::to_string(size);
+    if (filter && full.find(filter) == std::string::npos)
+        return;
+    fprintf(stderr, "%-32s", full.c_str());
+    results.push_back({full, size, bytes, utl::bench(cfg, fn)});
+    fprintf(stderr, "%12.2f ns\n", results.back().res.median);
+}
+
+std::vector<uint8_t> random_bytes(size_t n)
+{
+    std::vector<uint8_t> v(n);
+    for (auto &b : v)
+        b = rng();
+    return v;
+}
+
+std::vector<double> random_doubles(size_t n, double lo, double hi)
+{
+    std::uniform_real_distribution<double> dist(lo, hi);
+    std::vector<double> v(n);
+    for (auto &x : v)
+        x = dist(rng);
+    return v;
+}
+
+/**
+ * @brief Temporarily redirect stdout to null device, for
+ * functions which print as a side effect.
+ *
+ */
+struct mute_stdout {
+    mute_stdout()
+    {
+        fflush(stdout);
+#ifdef __unix__
+        saved = dup(STDOUT_FILENO);
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        close(null);
+#endif
+    }
+    ~mute_stdout()
+    {
+        fflush(stdout);
+#ifdef __unix__
+        dup2(saved, STDOUT_FILENO);
+        close(saved);
+#endif
+    }
+private:
+    int saved = -1;
+};
+
+void bench_bit()
+{
+    for (size_t n : {16, 256, 4096}) {
+        auto buf = random_bytes(n);
+        run("get_arr_bit", n, n, [&] {
+            int cnt = 0;
+            for (size_t i = 0; i < n * 8; ++i)
+                cnt += utl::get_arr_bit(buf.data(), i);
+            return cnt;
+        });
+        run("set_arr_bit", n, n, [&] {
+            for (size_t i = 0; i < n * 8; i += 3)
+                utl::set_arr_bit(buf.data(), i);
+            utl::clobber_memory();
+        });
+    }
+    uint64_t w4[4] = {1, 2, 3, 4};
+    uint64_t w16[16] = {1, 2, 3, 4};
+    run("shift_left", 4, sizeof(w4), [&] { utl::shift_left(w4); utl::clobber_memory(); });
+    run("shift_left", 16, sizeof(w16), [&] { utl::shift_left(w16); utl::clobber_memory(); });
+}
+
+void bench_math()
+{
+    constexpr size_t n = 1024;
+    std::vector<uint32_t> u(n);
+    std::vector<uint8_t> b = random_bytes(n);
+    for (auto &x : u)
+        x = rng();
+
+    run("uceil", n, 0, [&] {
+        uint32_t s = 0;
+        for (size_t i = 0; i < n; ++i)
+            s += utl::uceil<uint32_t>(u[i], b[i] | 1);
+        return s;
+    });
+    volatile uint32_t vd = 1000;
+    const uint32_t d32 = vd;
+    const utl::divider<uint32_t> div32(d32);
+    run("div_u32", n, 0, [&] {
+        uint32_t s = 0;
+        for (size_t i = 0; i < n; ++i)
+            s += u[i] / d32 + u[i] % d32;
+        return s;
+    });
+    run("divider_u32", n, 0, [&] {
+        uint32_t s = 0;
+        for (size_t i = 0; i < n; ++i)
+            s += u[i] / div32 + u[i] % div32;
+        return s;
+    });
+    std::vector<uint32_t> q(n);
+    run("divider_u32_batch", n, n * 4, [&] {
+        div32.divide(u.data(), q.data(), n);
+        utl::clobber_memory();
+    });
+    std::vector<int64_t> l(n);
+    for (auto &x : l)
+        x = int64_t(rng() << 32 | rng());
+    const int64_t d64 = -int64_t(vd) * 1000;
+    const utl::divider<int64_t> div64(d64);
+    run("div_i64", n, 0, [&] {
+        int64_t s = 0;
+        for (size_t i = 0; i < n; ++i)
+            s += l[i] / d64;
+        return s;
+    });
+    run("divider_i64", n, 0, [&] {
+        int64_t s = 0;
+        for (size_t i = 0; i < n; ++i)
+            s += l[i] / div64;
+        return s;
+    });
+    run("uceil_divider", n, 0, [&] {
+        uint32_t s = 0;
+        for (size_t i = 0; i < n; ++i)
+            s += utl::uceil(u[i], div32);
+        return s;
+    });
+    run("imap", n, 0, [&] {
+        int s = 0;
+        for (size_t i = 0; i < n; ++i)
+            s += utl::imap<int>(b[i], 0, 255, -1000, 1000);
+        return s;
+    });
+    std::vector<int> mi(b.begin(), b.end()), mo(n);
+    run("imap_runtime", n, n * 4, [&] {
+        for (size_t i = 0; i < n; ++i)
+            mo[i] = utl::imap<int>(mi[i], 0, int(vd) / 4, -1000, 1000);
+        utl::clobber_memory();
+    });
+    run("imap_batch", n, n * 4, [&] {
+        utl::imap<int>(mi.data(), mo.data(), n, 0, int(vd) / 4, -1000, 1000);
+        utl::clobber_memory();
+    });
+    run("ipow", n, 0, [&] {
+        uint32_t s = 0;
+        for (size_t i = 0; i < n; ++i)
+            s += utl::ipow<uint32_t>(b[i], b[i] & 15);
+        return s;
+    });
+    run("ilen", n, 0, [&] {
+        uint32_t s = 0;
+        for (size_t i = 0; i < n; ++i)
+            s += utl::ilen(u[i]);
+        return s;
+    });
+    run("fact", n, 0, [&] {
+        uint64_t s = 0;
+        for (size_t i = 0; i < n; ++i)
+            s += utl::fact<uint64_t>((b[i] & 15) + 1);
+        return s;
+    });
+    run("gf_mul", n, 0, [&] {
+        uint8_t s = 0;
+        for (size_t i = 1; i < n; ++i)
+            s ^= utl::gf_mul(b[i - 1], b[i]);
+        return s;
+    });
+    auto deg = random_doubles(n, -360, 360);
+    run("radians", n, 0, [&] {
+        double s = 0;
+        for (auto x : deg)
+            s += utl::degrees(utl::radians(x));
+        return s;
+    });
+}
+
+void bench_float()
+{
+    for (size_t n : {256, 4096, 65536}) {
+        auto src = random_doubles(n, -70000, 70000);
+        std::vector<float> f(src.begin(), src.end());
+        std::vector<uint16_t> h(n);
+        std::vector<float> out(n);
+        std::vector<uint8_t> b(n);
+
+        run("float_to_half", n, n * sizeof(float), [&] {
+            for (size_t i = 0; i < n; ++i)
+                h[i] = utl::float_to_half(utl::Float(f[i]).u32);
+            utl::clobber_memory();
+        });
+        run("half_to_float", n, n * sizeof(uint16_t), [&] {
+            for (size_t i = 0; i < n; ++i)
+                out[i] = utl::Float(utl::half_to_float(h[i])).f32;
+            utl::clobber_memory();
+        });
+        run("float_to_half_batch", n, n * sizeof(float), [&] {
+            utl::float_to_half(f.data(), h.data(), n);
+            utl::clobber_memory();
+        });
+        run("float_to_half_batch_sw", n, n * sizeof(float), [&] {
+            utl::impl::float_to_half_sw(f.data(), h.data(), n);
+            utl::clobber_memory();
+        });
+        run("half_to_float_batch", n, n * sizeof(uint16_t), [&] {
+            utl::half_to_float(h.data(), out.data(), n);
+            utl::clobber_memory();
+        });
+        run("half_to_float_batch_sw", n, n * sizeof(uint16_t), [&] {
+            utl::impl::half_to_float_sw(h.data(), out.data(), n);
+            utl::clobber_memory();
+        });
+        run("double_to_half_batch", n, n * sizeof(double), [&] {
+            utl::double_to_half(src.data(), h.data(), n);
+            utl::clobber_memory();
+        });
+        run("float_to_bf16_batch", n, n * sizeof(float), [&] {
+            utl::float_to_bf16(f.data(), h.data(), n);
+            utl::clobber_memory();
+        });
+        run("bf16_to_float_batch", n, n * sizeof(uint16_t), [&] {
+            utl::bf16_to_float(h.data(), out.data(), n);
+            utl::clobber_memory();
+        });
+        run("float_to_e4m3_batch", n, n * sizeof(float), [&] {
+            utl::float_to_e4m3<utl::fp_mode::saturate>(f.data(), b.data(), n);
+            utl::clobber_memory();
+        });
+        run("e4m3_to_float_batch", n, n, [&] {
+            utl::e4m3_to_float(b.data(), out.data(), n);
+            utl::clobber_memory();
+        });
+        run("float_to_e5m2_batch", n, n * sizeof(float), [&] {
+            utl::float_to_e5m2(f.data(), b.data(), n);
+            utl::clobber_memory();
+        });
+        run("e5m2_to_float_batch", n, n, [&] {
+            utl::e5m2_to_float(b.data(), out.data(), n);
+            utl::clobber_memory();
+        });
+        run("double_to_half", n, n * sizeof(double), [&] {
+            for (size_t i = 0; i < n; ++i)
+                h[i] = utl::double_to_half(utl::Float(src[i]).u64);
+            utl::clobber_memory();
+        });
+        run("half_to_double", n, n * sizeof(uint16_t), [&] {
+            for (size_t i = 0; i < n; ++i)
+                src[i] = utl::Float(utl::half_to_double(h[i])).f64;
+            utl::clobber_memory();
+        });
+    }
+}
+
+void bench_gf()
+{
+    constexpr size_t k = 10, m = 4;
+    using codec = utl::rs_codec<k, m>;
+
+    for (size_t n : {4096, 65536}) {
+        std::vector<std::vector<uint8_t>> buf;
+        uint8_t *shard[codec::shards];
+        bool present[codec::shards];
+
+        for (size_t i = 0; i < codec::shards; ++i) {
+            buf.push_back(random_bytes(n));
+            shard[i] = buf[i].data();
+            present[i] = true;
+        }
+        run("gf_mul_add", n, n, [&] {
+            utl::gf_mul_add(0x8e, shard[0], shard[1], n);
+            utl::clobber_memory();
+        });
+        run("rs_encode_10_4", n, n * k, [&] {
+            codec::encode(shard, shard + k, n);
+            utl::clobber_memory();
+        });
+        for (size_t i = 0; i < m; ++i)
+            present[i * 3] = false;
+        run("rs_reconstruct_10_4", n, n * k, [&] {
+            codec::reconstruct(shard, present, n);
+            utl::clobber_memory();
+        });
+    }
+}
+
+void bench_fixed()
+{
+    using q16 = utl::fixed<15, 16>;
+    constexpr size_t n = 1024;
+    auto src = random_doubles(n, -100, 100);
+    std::vector<q16> fx(n);
+    std::vector<uint32_t> bits(n);
+    for (size_t i = 0; i < n; ++i) {
+        fx[i] = q16(src[i]);
+        bits[i] = utl::Float(float(src[i])).u32;
+    }
+
+    run("fixed_mul_add", n, 0, [&] {
+        q16 s;
+        for (size_t i = 1; i < n; ++i)
+            s += fx[i - 1] * fx[i];
+        return s.raw;
+    });
+    run("fixed_div", n, 0, [&] {
+        q16 s;
+        for (size_t i = 1; i < n; ++i)
+            s += fx[i - 1] / fx[i];
+        return s.raw;
+    });
+    run("fixed_from_float_bits", n, 0, [&] {
+        q16 s;
+        for (auto b : bits)
+            s += q16::from_float_bits(b);
+        return s.raw;
+    });
+    run("fixed_to_float_bits", n, 0, [&] {
+        uint32_t s = 0;
+        for (auto x : fx)
+            s ^= x.to_float_bits();
+        return s;
+    });
+    run("fixed_imap", n, 0, [&] {
+        q16 s;
+        for (auto x : fx)
+            s += utl::imap(x, q16(-100), q16(100), q16(0), q16(1000));
+        return s.raw;
+    });
+    run("fixed_radians", n, 0, [&] {
+        q16 s;
+        for (auto x : fx)
+            s += utl::degrees(utl::radians(x));
+        return s.raw;
+    });
+    run("fixed_sincos", n, 0, [&] {
+        q16 s, c, acc;
+        for (auto x : fx) {
+            sincos(x, s, c);
+            acc += s + c;
+        }
+        return acc.raw;
+    });
+    run("fixed_atan2", n, 0, [&] {
+        q16 s;
+        for (size_t i = 1; i < n; ++i)
+            s += atan2(fx[i - 1], fx[i]);
+        return s.raw;
+    });
+    run("libm_sincos", n, 0, [&] {
+        double s = 0;
+        for (auto x : src)
+            s += std::sin(x) + std::cos(x);
+        return s;
+    });
+    run("libm_atan2", n, 0, [&] {
+        double s = 0;
+        for (size_t i = 1; i < n; ++i)
+            s += std::atan2(src[i - 1], src[i]);
+        return s;
+    });
+}
+
+template<unsigned Bits>
+void bench_wide_size(const std::vector<utl::wide_uint<Bits>> &v)
+{
+    typedef utl::wide_uint<Bits> T;
+    const size_t n = v.size();
+    run("wide_add", Bits, 0, [&] {
+        T s;
+        for (size_t i = 0; i < n; ++i)
+            s += v[i];
+        return s.w[0];
+    });
+    run("wide_mul", Bits, 0, [&] {
+        T s = 1;
+        for (size_t i = 0; i < n; ++i)
+            s = s * v[i] + v[i];
+        return s.w[0];
+    });
+    run("mul_wide", Bits, 0, [&] {
+        uint64_t s = 0;
+        for (size_t i = 1; i < n; ++i)
+            s += utl::mul_wide(v[i - 1], v[i]).w[T::words];
+        return s;
+    });
+    run("wide_div", Bits, 0, [&] {
+        uint64_t s = 0;
+        for (size_t i = 1; i < n; ++i)
+            s += (v[i] / (v[i - 1] >> Bits / 2)).w[0];
+        return s;
+    });
+    char hex[Bits / 4 + 1];
+    run("wide_hex", Bits, 0, [&] {
+        uint64_t s = 0;
+        for (size_t i = 0; i < n; ++i) {
+            v[i].to_hex(hex, sizeof(hex));
+            s += T::from_hex(hex).w[0];
+        }
+        return s;
+    });
+}
+
+void bench_wide()
+{
+    constexpr size_t n = 256;
+    std::vector<utl::uint128> v128(n);
+    std::vector<utl::uint256> v256(n);
+    std::vector<utl::uint512> v512(n);
+    std::vector<utl::wide_uint<1024>> v1024(n);
+    const auto fill = [](auto &v) {
+        for (auto &x : v)
+            for (auto &w : x.w)
+                w = uint64_t(rng()) << 32 | rng();
+    };
+    fill(v128);
+    fill(v256);
+    fill(v512);
+    fill(v1024);
+
+    __extension__ typedef unsigned __int128 u128;
+    std::vector<u128> b128(n);
+    for (size_t i = 0; i < n; ++i)
+        b128[i] = u128(v128[i].w[1]) << 64 | v128[i].w[0];
+    run("int128_mul", 128, 0, [&] {
+        u128 s = 1;
+        for (size_t i = 0; i < n; ++i)
+            s = s * b128[i] + b128[i];
+        return uint64_t(s);
+    });
+    run("int128_div", 128, 0, [&] {
+        uint64_t s = 0;
+        for (size_t i = 1; i < n; ++i)
+            s += uint64_t(b128[i] / (b128[i - 1] >> 64));
+        return s;
+    });
+    bench_wide_size(v128);
+    bench_wide_size(v256);
+    bench_wide_size(v512);
+    bench_wide_size(v1024);
+}
+
+void bench_str()
+{
+    for (size_t n : {16, 256, 4096, 65536}) {
+        auto bin = random_bytes(n);
+        std::vector<char> str(n * 2 + 1);
+        run("bin_to_str", n, n, [&] {
+            return utl::bin_to_str(bin.data(), n, str.data(), str.size());
+        });
+        const uint32_t prev = utl::cpu_restrict(0);
+        run("bin_to_str_scalar", n, n, [&] {
+            return utl::bin_to_str(bin.data(), n, str.data(), str.size());
+        });
+        run("crc32c_table", n, n, [&] {
+            return utl::crc32c(bin.data(), n);
+        });
+        utl::cpu_restrict(prev);
+        run("crc32c", n, n, [&] {
+            return utl::crc32c(bin.data(), n);
+        });
+        run("str_to_bin", n, n * 2, [&] {
+            return utl::str_to_bin(str.data(), n * 2, bin.data(), n);
+        });
+    }
+    for (size_t digits : {4, 8, 16}) {
+        constexpr size_t n = 256;
+        std::vector<std::string> ints(n);
+        std::vector<std::string> dbls(n);
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = 0; j < digits; ++j) {
+                ints[i] += char('0' + rng() % 10);
+                dbls[i] += char('0' + rng() % 10);
+            }
+            dbls[i].insert(digits / 2, 1, '.');
+        }
+        run("str_to_int", digits, n * digits, [&] {
+            long s = 0;
+            for (auto &x : ints)
+                s += utl::str_to_int(x);
+            return s;
+        });
+        run("str_to_dbl", digits, n * digits, [&] {
+            double s = 0;
+            for (auto &x : dbls)
+                s += utl::str_to_dbl(x);
+            return s;
+        });
+    }
+    auto split_case = [](auto tag) {
+        constexpr size_t n = decltype(tag)::value;
+        std::string s;
+        for (size_t i = 0; i < n; ++i)
+            s += "token" + std::to_string(i) + (i & 1 ? ", " : ":");
+        run("split", n, s.size(), [&] { return utl::split<n>(s, ",: ").size(); });
+    };
+    split_case(std::integral_constant<size_t, 4>{});
+    split_case(std::integral_constant<size_t, 16>{});
+    split_case(std::integral_constant<size_t, 64>{});
+    constexpr size_t lines = 256;
+    const auto vals = random_doubles(lines, -100, 100);
+    run("log_line_std_string", lines, lines, [&] {
+        size_t len = 0;
+        for (size_t i = 0; i < lines; ++i) {
+            std::string s = "imu.";
+            s += std::to_string(i);
+            s += " v=";
+            s += std::to_string(vals[i]);
+            len += s.size();
+        }
+        return len;
+    });
+    run("log_line_sstring", lines, lines, [&] {
+        size_t len = 0;
+        for (size_t i = 0; i < lines; ++i) {
+            utl::sstring<48> s = "imu.";
+            s.append(i).append(" v=").append(vals[i]);
+            len += s.size();
+        }
+        return len;
+    });
+}
+
+void bench_cbor()
+{
+    constexpr size_t n = 1024;
+    auto src = random_doubles(n, -100, 100);
+    std::vector<double> v(n);
+    for (size_t i = 0; i < n; ++i)      // Mix of half, single and double exact values
+        v[i] = i % 3 == 0 ? std::round(src[i] * 4) / 4 : i % 3 == 1 ? double(float(src[i])) : src[i];
+    std::vector<uint8_t> buf(n * 9 + 16);
+    std::vector<char> json(n * 32);
+    run("json_encode_doubles", n, 0, [&] {
+        size_t len = 0;
+        json[len++] = '[';
+        for (size_t i = 0; i < n; ++i)
+            len += snprintf(json.data() + len, json.size() - len, i ? ",%.17g" : "%.17g", v[i]);
+        json[len++] = ']';
+        return len;
+    });
+    run("cbor_encode_doubles", n, 0, [&] {
+        utl::cbor_writer w(buf.data(), buf.size());
+        w.put_array(n);
+        for (double x : v)
+            w.put(x);
+        return w.size();
+    });
+    run("cbor_encode_batch", n, 0, [&] {
+        utl::cbor_writer w(buf.data(), buf.size());
+        w.put(v.data(), n);
+        return w.size();
+    });
+    utl::cbor_writer w(buf.data(), buf.size());
+    w.put(v.data(), n);
+    auto out = std::make_unique<utl::svector<double, n>>();
+    run("cbor_decode_doubles", n, 0, [&] {
+        utl::cbor_reader r(w.data(), w.size());
+        return r.read(*out);
+    });
+}
+
+void bench_fastmath()
+{
+    for (size_t n : {256, 4096}) {
+        auto x = random_doubles(n, -10, 10);
+        auto y = random_doubles(n, -10, 10);
+        auto u = random_doubles(n, -1, 1);
+        std::vector<double> out(n);
+        run("libm_sin", n, 0, [&] {
+            for (size_t i = 0; i < n; ++i)
+                out[i] = std::sin(x[i]);
+            utl::clobber_memory();
+        });
+        run("fast_sin", n, 0, [&] {
+            for (size_t i = 0; i < n; ++i)
+                out[i] = utl::fast_sin(x[i]);
+            utl::clobber_memory();
+        });
+        run("fast_sin_batch", n, 0, [&] {
+            utl::fast_sin(x.data(), out.data(), n);
+            utl::clobber_memory();
+        });
+        run("libm_asin", n, 0, [&] {
+            for (size_t i = 0; i < n; ++i)
+                out[i] = std::asin(u[i]);
+            utl::clobber_memory();
+        });
+        run("fast_asin", n, 0, [&] {
+            for (size_t i = 0; i < n; ++i)
+                out[i] = utl::fast_asin(u[i]);
+            utl::clobber_memory();
+        });
+        run("fast_asin_batch", n, 0, [&] {
+            utl::fast_asin(u.data(), out.data(), n);
+            utl::clobber_memory();
+        });
+        run("libm_atan2", n, 0, [&] {
+            for (size_t i = 0; i < n; ++i)
+                out[i] = std::atan2(y[i], x[i]);
+            utl::clobber_memory();
+        });
+        run("fast_atan2", n, 0, [&] {
+            for (size_t i = 0; i < n; ++i)
+                out[i] = utl::fast_atan2(y[i], x[i]);
+            utl::clobber_memory();
+        });
+        run("fast_atan2_batch", n, 0, [&] {
+            utl::fast_atan2(y.data(), x.data(), out.data(), n);
+            utl::clobber_memory();
+        });
+        run("fast_hypot_batch", n, 0, [&] {
+            utl::fast_hypot(x.data(), y.data(), out.data(), n);
+            utl::clobber_memory();
+        });
+    }
+}
+
+void bench_physics()
+{
+    for (size_t n : {16, 1024}) {
+        auto lat = random_doubles(n, -90, 90);
+        auto lng = random_doubles(n, -180, 180);
+        auto acc = random_doubles(n * 3, -16, 16);
+        run("haversine", n, 0, [&] {
+            double s = 0;
+            for (size_t i = 1; i < n; ++i)
+                s += utl::haversine(lat[i - 1], lng[i - 1], lat[i], lng[i], 1.0);
+            return s;
+        });
+        run("gcs_distance", n, 0, [&] {
+            double s = 0;
+            for (size_t i = 1; i < n; ++i)
+                s += utl::gcs_distance(lat[i - 1], lng[i - 1], lat[i], lng[i]);
+            return s;
+        });
+        run("inclination", n, 0, [&] {
+            double s = 0;
+            for (size_t i = 0; i < n; ++i)
+                s += utl::inclination(acc[i * 3], acc[i * 3 + 1], acc[i * 3 + 2]);
+            return s;
+        });
+        run("roll", n, 0, [&] {
+            double s = 0;
+            for (size_t i = 0; i < n; ++i)
+                s += utl::roll(acc[i * 3 + 1], acc[i * 3 + 2]);
+            return s;
+        });
+        run("pitch", n, 0, [&] {
+            double s = 0;
+            for (size_t i = 0; i < n; ++i)
+                s += utl::pitch(acc[i * 3], acc[i * 3 + 1], acc[i * 3 + 2]);
+            return s;
+        });
+        run("haversine_fast", n, 0, [&] {
+            double s = 0;
+            for (size_t i = 1; i < n; ++i)
+                s += utl::fast_haversine(lat[i - 1], lng[i - 1], lat[i], lng[i], 1.0);
+            return s;
+        });
+        run("inclination_fast", n, 0, [&] {
+            double s = 0;
+            for (size_t i = 0; i < n; ++i)
+                s += utl::fast_inclination(acc[i * 3], acc[i * 3 + 1], acc[i * 3 + 2]);
+            return s;
+        });
+        run("pitch_fast", n, 0, [&] {
+            double s = 0;
+            for (size_t i = 0; i < n; ++i)
+                s += utl::fast_pitch(acc[i * 3], acc[i * 3 + 1], acc[i * 3 + 2]);
+            return s;
+        });
+
+        std::vector<double> d(n);
+        const utl::geo_points pts(lat.data(), lng.data(), n);
+        const utl::geo_points prev(lat.data(), lng.data(), n - 1), next(lat.data() + 1, lng.data() + 1, n - 1);
+        run("gcs_distance_one_to_many", n, 0, [&] {
+            for (size_t i = 0; i < n; ++i)
+                d[i] = utl::gcs_distance(lat[0], lng[0], lat[i], lng[i]);
+            utl::clobber_memory();
+        });
+        run("haversine_one_to_many", n, 0, [&] {
+            utl::haversine(lat[0], lng[0], pts, d.data());
+            utl::clobber_memory();
+        });
+        run("haversine_pairwise", n, 0, [&] {
+            utl::haversine(prev, next, d.data());
+            utl::clobber_memory();
+        });
+        run("geo_points", n, 0, [&] {
+            const utl::geo_points p(lat.data(), lng.data(), n);
+            return p.cos_lat()[n - 1];
+        });
+    }
+}
+
+void bench_geo()
+{
+    constexpr size_t n = 1 << 20;
+    auto lat = random_doubles(n, 40, 60);
+    auto lng = random_doubles(n, 0, 40);
+    auto qlat = random_doubles(64, 40, 60);
+    auto qlng = random_doubles(64, 0, 40);
+    std::vector<uint64_t> cells(n);
+    run("geo_cell", n, 0, [&] {
+        utl::geo_cell(lat.data(), lng.data(), cells.data(), n);
+        utl::clobber_memory();
+    });
+    const utl::geo_index idx(lat.data(), lng.data(), n);
+    std::vector<utl::geo_hit> hits;
+    size_t q = 0;
+    run("geo_index_within_1km", n, 0, [&] {
+        q = (q + 1) & 63;
+        return idx.within(qlat[q], qlng[q], 1000, hits);
+    });
+    run("geo_index_within_50km", n, 0, [&] {
+        q = (q + 1) & 63;
+        return idx.within(qlat[q], qlng[q], 50000, hits);
+    });
+    run("geo_index_nearest_10", n, 0, [&] {
+        q = (q + 1) & 63;
+        return idx.nearest(qlat[q], qlng[q], 10, hits);
+    });
+    const utl::geo_points pts(lat.data(), lng.data(), n);
+    std::vector<double> d(n);
+    run("haversine_full_scan", n, 0, [&] {
+        q = (q + 1) & 63;
+        utl::haversine(qlat[q], qlng[q], pts, d.data());
+        utl::clobber_memory();
+    });
+}
+
+void bench_window()
+{
+    constexpr size_t n = 4096;
+    constexpr size_t win = 256;
+    auto src = random_doubles(n, -100, 100);
+    utl::ring<double, win, true> r;
+    run("window_rescan", n, 0, [&] {
+        double s = 0;
+        for (double x : src) {
+            r.put(x);
+            double mean = 0, var = 0, lo = x, hi = x;
+            for (double y : r)
+                mean += y;
+            mean /= double(r.size());
+            for (double y : r) {
+                var += (y - mean) * (y - mean);
+                lo = y < lo ? y : lo;
+                hi = y > hi ? y : hi;
+            }
+            s += mean + var + lo + hi;
+        }
+        return s;
+    });
+    utl::window_stats<double, win> w(-100, 100);
+    run("window_put", n, 0, [&] {
+        double s = 0;
+        for (double x : src) {
+            w.put(x);
+            s += w.mean() + w.variance() + w.min() + w.max();
+        }
+        return s;
+    });
+    run("window_write", n, 0, [&] {
+        double s = 0;
+        for (size_t i = 0; i < n; i += 64) {
+            w.write(src.data() + i, 64);
+            s += w.mean() + w.variance() + w.min() + w.max();
+        }
+        return s;
+    });
+    run("window_percentile", n, 0, [&] {
+        double s = 0;
+        for (double x : src) {
+            w.put(x);
+            s += w.percentile(99);
+        }
+        return s;
+    });
+}
+
+void bench_imu()
+{
+    constexpr size_t n = 1024;
+    auto acc = random_doubles(n * 3, -16, 16);
+    auto gyr = random_doubles(n * 3, -1, 1);
+    std::vector<utl::imu_vec> v(n);
+    std::vector<utl::imu_sample> s(n);
+    for (size_t i = 0; i < n; ++i) {
+        v[i] = {acc[i * 3], acc[i * 3 + 1], acc[i * 3 + 2]};
+        s[i] = {v[i], {gyr[i * 3], gyr[i * 3 + 1], gyr[i * 3 + 2]}};
+    }
+    utl::ring<utl::imu_vec, n> vin;
+    utl::ring<utl::imu_sample, n> sin;
+    utl::ring<utl::imu_angles, n, true> out;
+    run("imu_scalar", n, 0, [&] {
+        vin.write(v.data(), n);
+        utl::imu_vec x;
+        while (vin.get(x))
+            out.put({utl::roll(x.y, x.z), utl::pitch(x.x, x.y, x.z), utl::inclination(x.x, x.y, x.z)});
+        return out.size();
+    });
+    run("imu_tilt", n, 0, [&] {
+        vin.write(v.data(), n);
+        return utl::imu_tilt(vin, out);
+    });
+    utl::imu_complementary comp(0.001);
+    run("imu_complementary", n, 0, [&] {
+        sin.write(s.data(), n);
+        return comp.process(sin, out);
+    });
+    utl::imu_madgwick madg(0.001);
+    run("imu_madgwick", n, 0, [&] {
+        sin.write(s.data(), n);
+        return madg.process(sin, out);
+    });
+}
+
+void bench_parallel()
+{
+    utl::thread_pool &pool = utl::thread_pool::global();
+    constexpr size_t n = 16 << 20;
+    auto bin = random_bytes(n);
+    std::vector<char> str(n * 2 + 1);
+    run("bin_to_str_serial", n, n, [&] {
+        utl::bin_to_str(bin.data(), n, str.data(), str.size());
+        utl::clobber_memory();
+    });
+    run("bin_to_str_pool", n, n, [&] {
+        utl::bin_to_str(pool, bin.data(), n, str.data(), str.size());
+        utl::clobber_memory();
+    });
+
+    auto src = random_doubles(n / 4, -70000, 70000);
+    std::vector<float> f(src.begin(), src.end());
+    std::vector<uint16_t> h(f.size());
+    run("float_to_half_serial", f.size(), f.size() * sizeof(float), [&] {
+        utl::float_to_half(f.data(), h.data(), f.size());
+        utl::clobber_memory();
+    });
+    run("float_to_half_pool", f.size(), f.size() * sizeof(float), [&] {
+        utl::float_to_half(pool, f.data(), h.data(), f.size());
+        utl::clobber_memory();
+    });
+
+    auto lat = random_doubles(1 << 20, -90, 90), lng = random_doubles(1 << 20, -180, 180);
+    utl::geo_points pts(lat.data(), lng.data(), lat.size());
+    std::vector<double> d(pts.size());
+    run("haversine_serial", pts.size(), 0, [&] {
+        utl::haversine(1, 2, pts, d.data());
+        utl::clobber_memory();
+    });
+    run("haversine_pool", pts.size(), 0, [&] {
+        utl::haversine(pool, 1, 2, pts, d.data());
+        utl::clobber_memory();
+    });
+
+    utl::thread_pool four(4);
+    run("parallel_reduce_1024", 1024, 0, [&] {
+        return four.parallel_reduce(0, 1024, 64, size_t(0),
+            [](size_t b, size_t e) { return e - b; }, [](size_t a, size_t b) { return a + b; });
+    });
+}
+
+void bench_containers()
+{
+    for (size_t n : {16, 256, 1024}) {
+        utl::ring<uint32_t, 1024> r;
+        run("ring_put_get", n, n * sizeof(uint32_t), [&] {
+            uint32_t s = 0;
+            uint32_t x;
+            for (size_t i = 0; i < n; ++i)
+                r.put(i);
+            while (r.get(x))
+                s += x;
+            return s;
+        });
+        utl::ring<uint32_t, 1024, true> d;
+        run("ring_discard_put", n, n * sizeof(uint32_t), [&] {
+            for (size_t i = 0; i < n; ++i)
+                d.put(i);
+            return d.size();
+        });
+        auto msg = random_bytes(n);
+        std::vector<uint8_t> out(n);
+        utl::ring<uint8_t, 4096> rb;
+        run("ring_bytes_write_read", n, n, [&] {
+            rb.write(msg.data(), n);
+            return rb.read(out.data(), n);
+        });
+        utl::mring m(4096);
+        run("mring_write_read", n, n, [&] {
+            m.write(msg.data(), n);
+            return m.read(out.data(), n);
+        });
+        run("mring_zero_copy", n, n, [&] {
+            memcpy(m.prepare(n), msg.data(), n);
+            m.commit(n);
+            size_t len;
+            const uint8_t *p = m.peek(len);
+            const uint8_t s = p[0] ^ p[len - 1];
+            m.consume(len);
+            return s;
+        });
+        utl::svector<uint32_t, 1024> v;
+        run("svector_push_pop", n, n * sizeof(uint32_t), [&] {
+            for (size_t i = 0; i < n; ++i)
+                v.push_back(i);
+            uint32_t s = 0;
+            while (!v.empty()) {
+                s += v[v.size() - 1];
+                v.pop_back();
+            }
+            return s;
+        });
+    }
+}
+
+void bench_time()
+{
+    constexpr size_t n = 1024;
+    std::vector<tm> t(n);
+    for (auto &x : t) {
+        x.tm_year = 70 + rng() % 100;
+        x.tm_mon = rng() % 12;
+        x.tm_mday = 1 + rng() % 28;
+        x.tm_hour = rng() % 24;
+        x.tm_min = rng() % 60;
+        x.tm_sec = rng() % 60;
+    }
+    run("timeutc", n, 0, [&] {
+        int64_t s = 0;
+        for (auto &x : t)
+            s += utl::timeutc(x);
+        return s;
+    });
+    std::vector<int64_t> ts(n);
+    for (auto &x : ts)
+        x = rng() % 4000000000ll;
+    run("utctime", n, 0, [&] {
+        int s = 0;
+        for (auto x : ts)
+            s += utl::utctime(x).tm_mday;
+        return s;
+    });
+    for (size_t m : {256, 4096, 65536}) {
+        std::vector<int64_t> in(m);
+        std::vector<utl::civil> date(m);
+        std::vector<uint32_t> sod(m);
+        for (auto &x : in)
+            x = rng() % 4000000000ll;
+        run("utc_to_civil", m, m * sizeof(int64_t), [&] {
+            utl::utc_to_civil(in.data(), date.data(), sod.data(), m);
+            utl::clobber_memory();
+        });
+        run("civil_to_utc", m, m * sizeof(int64_t), [&] {
+            utl::civil_to_utc(date.data(), sod.data(), in.data(), m);
+            utl::clobber_memory();
+        });
+    }
+}
+
+void bench_iso8601()
+{
+    constexpr size_t n = 256;
+    std::vector<utl::timestamp> ts(n);
+    std::vector<std::string> str(n);
+    int64_t sec = 1700000000;
+    for (size_t i = 0; i < n; ++i) {
+        sec += rng() % 3 == 0;
+        ts[i] = {sec, uint32_t(rng() % 1000000000)};
+        char buf[utl::iso8601_max_len];
+        str[i].assign(buf, utl::iso8601_format(ts[i], buf, sizeof(buf), 6, 120));
+    }
+    run("iso8601_parse", n, n * str[0].size(), [&] {
+        int64_t s = 0;
+        utl::timestamp t = {};
+        for (auto &x : str)
+            s += utl::iso8601_parse(x, t) + t.sec;
+        return s;
+    });
+    for (unsigned frac : {0, 9}) {
+        char buf[utl::iso8601_max_len];
+        run("iso8601_format", frac, 0, [&] {
+            size_t s = 0;
+            for (auto &t : ts)
+                s += utl::iso8601_format(t, buf, sizeof(buf), frac);
+            utl::clobber_memory();
+            return s;
+        });
+        utl::iso8601_formatter fmt{frac};
+        run("iso8601_formatter", frac, 0, [&] {
+            size_t s = 0;
+            for (auto &t : ts)
+                s += fmt.format(t, buf, sizeof(buf));
+            utl::clobber_memory();
+            return s;
+        });
+    }
+}
+
+void bench_log()
+{
+    for (size_t n : {16, 256, 4096}) {
+        auto buf = random_bytes(n);
+        mute_stdout mute;
+        run("log_hex", n, n, [&] { utl::log_hex(buf.data(), n); });
+        run("log_bits", n, n, [&] { utl::log_bits(buf.data(), n * 8, 0); });
+    }
+}
+
+void write_json(FILE *f)
+{
+    fprintf(f, "{\n  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        auto &e = results[i];
+        fprintf(f, "    {\"name\": \"%s\", \"size\": %zu, \"iters\": %zu, \"reps\": %zu, "
+            "\"min_ns\": %.3f, \"median_ns\": %.3f, \"mean_ns\": %.3f, \"p99_ns\": %.3f, \"mad_ns\": %.3f, "
+            "\"bytes_per_sec\": %.0f",
+            e.name.c_str(), e.size, e.res.iters, e.res.reps,
+            e.res.min, e.res.median, e.res.mean, e.res.p99, e.res.mad,
+            e.bytes ? e.bytes * 1e9 / e.res.median : 0.0);
+        if (e.res.counters.valid()) {
+            auto &c = e.res.counters;
+            auto num = [&](const char *key, double v) {
+                if (v == v)
+                    fprintf(f, ", \"%s\": %.3f", key, v);
+                else
+                    fprintf(f, ", \"%s\": null", key);
+            };
+            num("cycles", c.cycles);
+            num("instructions", c.instructions);
+            num("ipc", c.ipc());
+            num("l1d_misses", c.l1d_misses);
+            num("llc_misses", c.llc_misses);
+            num("branch_misses", c.branch_misses);
+        }
+        fprintf(f, "}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+}
+
+/**
+ * @brief Read "name" and "median_ns" pairs from JSON previously written by write_json().
+ *
+ * @param path Baseline file
+ * @param out Map of benchmark name to median
+ * @return true on success
+ */
+bool read_baseline(const char *path, std::map<std::string, double> &out)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return false;
+
+    std::string s;
+    char chunk[4096];
+    for (size_t n; (n = fread(chunk, 1, sizeof(chunk), f));)
+        s.append(chunk, n);
+    fclose(f);
+
+    constexpr std::string_view key_name = "\"name\": \"";
+    constexpr std::string_view key_median = "\"median_ns\": ";
+
+    for (size_t pos = 0; (pos = s.find(key_name, pos)) != std::string::npos;) {
+        pos += key_name.size();
+        size_t end = s.find('"', pos);
+        size_t med = s.find(key_median, end);
+        if (end == std::string::npos || med == std::string::npos)
+            return false;
+        out[s.substr(pos, end - pos)] = strtod(s.c_str() + med + key_median.size(), nullptr);
+        pos = med;
+    }
+    return true;
+}
+
+/**
+ * @brief Compare results against baseline. Benchmark regresses when its
+ * median is slower by more than threshold percent and the difference
+ * exceeds 3 median absolute deviations, so noisy cases aren't flagged.
+ *
+ * @param base Baseline medians
+ * @param threshold Allowed slowdown in percent
+ * @return Number of regressions
+ */
+int compare(const std::map<std::string, double> &base, double threshold)
+{
+    int regressions = 0;
+
+    fprintf(stderr, "\n%-32s %12s %12s %9s\n", "benchmark", "base ns", "new ns", "delta");
+
+    for (auto &e : results) {
+        auto it = base.find(e.name);
+        if (it == base.end() || it->second <= 0) {
+            fprintf(stderr, "%-32s %12s %12.2f %9s\n", e.name.c_str(), "-", e.res.median, "new");
+            continue;
+        }
+        double delta = (e.res.median - it->second) / it->second * 100;
+        bool bad = delta > threshold && e.res.median - it->second > 3 * e.res.mad;
+        regressions += bad;
+        fprintf(stderr, "%-32s %12.2f %12.2f %+8.1f%%%s\n",
+            e.name.c_str(), it->second, e.res.median, delta, bad ? "  REGRESSION" : "");
+    }
+    return regressions;
+}
+
+void usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --out FILE        write JSON results to FILE instead of stdout\n"
+        "  --baseline FILE   compare against JSON from previous run, exit 1 on regression\n"
+        "  --threshold PCT   allowed slowdown against baseline, default 10\n"
+        "  --filter STR      run only benchmarks whose name contains STR\n"
+        "  --min-time MS     minimum duration of single repetition, default 2\n"
+        "  --counters        collect hardware performance counters, if available\n", prog);
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    const char *out = nullptr;
+    const char *baseline = nullptr;
+    double threshold = 10;
+
+    for (int i = 1; i < argc; ++i) {
+        auto arg = std::string_view(argv[i]);
+        auto next = [&] { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char *val = nullptr;
+
+        if (arg == "--out" && (val = next()))
+            out = val;
+        else if (arg == "--baseline" && (val = next()))
+            baseline = val;
+        else if (arg == "--threshold" && (val = next()))
+            threshold = strtod(val, nullptr);
+        else if (arg == "--filter" && (val = next()))
+            filter = val;
+        else if (arg == "--min-time" && (val = next()))
+            cfg.min_time = std::chrono::microseconds(long(strtod(val, nullptr) * 1000));
+        else if (arg == "--counters")
+            cfg.counters = true;
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::map<std::string, double> base;
+
+    if (cfg.counters && !utl::perf_counters().valid())
+        fprintf(stderr, "hardware counters unavailable, reporting time only\n");
+
+    if (baseline && !read_baseline(baseline, base)) {
+        fprintf(stderr, "failed to read baseline '%s'\n", baseline);
+        return 2;
+    }
+
+    bench_bit();
+    bench_math();
+    bench_float();
+    bench_gf();
+    bench_fixed();
+    bench_wide();
+    bench_str();
+    bench_cbor();
+    bench_fastmath();
+    bench_physics();
+    bench_geo();
+    bench_imu();
+    bench_window();
+    bench_parallel();
+    bench_containers();
+    bench_time();
+    bench_iso8601();
+    bench_log();
+
+    FILE *f = out ? fopen(out, "wb") : stdout;
+    if (!f) {
+        fprintf(stderr, "failed to open '%s'\n", out);
+        return 2;
+    }
+    write_json(f);
+    if (out)
+        fclose(f);
+
+    return baseline && compare(base, threshold) ? 1 : 0;
+}
\ No newline at end of file
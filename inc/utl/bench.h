@@ -0,0 +1,350 @@
+#ifndef UTL_BENCH_H
+#define UTL_BENCH_H
+
+#include "utl/math.h"
+#include "utl/perf.h"
+#include "utl/time.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <type_traits>
+
+namespace utl {
+namespace impl {
+inline const volatile void *volatile bench_sink; // Escape target for compilers without inline asm
+}
+
+/**
+ * @brief Prevent compiler from optimizing away computation of a value.
+ * Value is considered read by an opaque instruction, so expression which
+ * produced it must be evaluated.
+ *
+ * @tparam T Auto-deduced value type
+ * @param val Value to keep
+ */
+template<class T>
+inline void do_not_optimize(const T &val)
+{
+#ifdef __GNUC__
+    asm volatile("" : : "r,m"(val) : "memory");
+#else
+    impl::bench_sink = &val;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+/**
+ * @brief Prevent compiler from optimizing away computation of a value.
+ * Value is considered both read and modified by an opaque instruction,
+ * so it can't be constant folded or hoisted out of a loop.
+ *
+ * @tparam T Auto-deduced value type
+ * @param val Value to keep
+ */
+template<class T>
+inline void do_not_optimize(T &val)
+{
+#if defined(__clang__)
+    asm volatile("" : "+r,m"(val) : : "memory");
+#elif defined(__GNUC__)
+    asm volatile("" : "+m,r"(val) : : "memory");
+#else
+    impl::bench_sink = &val;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+/**
+ * @brief Force all pending memory writes to be considered visible,
+ * so stores to buffers can't be elided.
+ *
+ */
+inline void clobber_memory()
+{
+#ifdef __GNUC__
+    asm volatile("" : : : "memory");
+#else
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+/**
+ * @brief Benchmark configuration.
+ *
+ */
+struct bench_cfg {
+    std::chrono::nanoseconds min_time = std::chrono::milliseconds(2);   // Minimum duration of single repetition, drives iteration count
+    size_t warmup = 2;                                                  // Number of discarded repetitions
+    size_t max_iters = size_t(1) << 30;                                 // Upper bound of calls per repetition
+    bool counters = false;                                              // Collect hardware counters in extra repetition
+};
+
+/**
+ * @brief Benchmark result, all times are in nanoseconds per call.
+ *
+ */
+struct bench_result {
+    double min;     // Fastest repetition
+    double median;  // Median of repetitions
+    double mean;    // Arithmetic mean of repetitions
+    double p99;     // 99-th percentile of repetitions
+    double mad;     // Median absolute deviation from median
+    size_t iters;   // Calls per repetition
+    size_t reps;    // Number of measured repetitions
+    perf_sample counters;   // Hardware counters per call, if requested and available
+};
+
+namespace impl {
+
+/**
+ * @brief Time given number of calls of a callable with utl::tsc_clock.
+ *
+ * @param call Callable which performs single call
+ * @param iters Number of calls
+ * @return Elapsed time in nanoseconds
+ */
+template<class Call>
+double bench_once(Call &call, size_t iters)
+{
+    auto begin = tsc_clock::ticks();
+    for (size_t i = 0; i < iters; ++i)
+        call();
+    auto end = tsc_clock::ticks();
+
+    return tsc_clock::to_ns(end - begin);
+}
+
+/**
+ * @brief Calibrate iteration count, warm up, measure and summarize.
+ *
+ * @tparam Reps Number of measured repetitions
+ * @param cfg Configuration
+ * @param call Callable which performs single call
+ * @return Summary statistics
+ */
+template<size_t Reps, class Call>
+bench_result bench_run(const bench_cfg &cfg, Call &&call)
+{
+    static_assert(Reps > 0, "at least one repetition required");
+
+    const double min_ns = cfg.min_time.count();
+
+    size_t iters = 1;
+
+    for (;;) {
+        double ns = bench_once(call, iters);
+        if (ns >= min_ns || iters >= cfg.max_iters)
+            break;
+        // Aim for 20% above the target, but grow at most 10x per step in case of noise
+        double scale = ns > 0 ? min_ns * 1.2 / ns : 10.0;
+        size_t next = iters * std::min(std::max(scale, 2.0), 10.0);
+        iters = std::min(next, cfg.max_iters);
+    }
+
+    for (size_t i = 0; i < cfg.warmup; ++i)
+        bench_once(call, iters);
+
+    double s[Reps];
+    double dev[Reps];
+    double sum = 0;
+
+    for (auto &x : s) {
+        x = bench_once(call, iters) / iters;
+        sum += x;
+    }
+    std::sort(s, s + Reps);
+
+    auto median = [](const double *x) {
+        return Reps & 1 ? x[Reps / 2] : (x[Reps / 2 - 1] + x[Reps / 2]) / 2;
+    };
+    bench_result res = {};
+
+    res.min     = s[0];
+    res.median  = median(s);
+    res.mean    = sum / Reps;
+    res.p99     = s[uceil<size_t>(Reps * 99, 100) - 1];
+    res.iters   = iters;
+    res.reps    = Reps;
+
+    for (size_t i = 0; i < Reps; ++i)
+        dev[i] = s[i] > res.median ? s[i] - res.median : res.median - s[i];
+    std::sort(dev, dev + Reps);
+
+    res.mad = median(dev);
+
+    if (cfg.counters) {
+        perf_counters pc;
+        pc.start();
+        for (size_t i = 0; i < iters; ++i)
+            call();
+        res.counters = pc.stop(iters);
+    }
+
+    return res;
+}
+
+}
+
+/**
+ * @brief Measure execution time of a function. Number of calls per repetition
+ * is scaled automatically until a repetition lasts at least cfg.min_time, then
+ * warm-up repetitions are discarded and Reps repetitions are measured. Result
+ * of each call is passed through do_not_optimize().
+ *
+ * @tparam Reps Number of measured repetitions
+ * @tparam Fn Function pointer
+ * @tparam Args Arguments of the function
+ * @param cfg Configuration
+ * @param fn Function pointer
+ * @param args Arguments of the function
+ * @return Statistics in nanoseconds per call
+ */
+template<size_t Reps = 31, class Fn, class ...Args>
+bench_result bench(const bench_cfg &cfg, Fn &&fn, Args &&...args)
+{
+    return impl::bench_run<Reps>(cfg, [&] {
+        (do_not_optimize(args), ...);
+        if constexpr (std::is_void_v<std::invoke_result_t<Fn&, Args&...>>)
+            fn(args...);
+        else
+            do_not_optimize(fn(args...));
+    });
+}
+
+/**
+ * @brief Measure execution time of a function with default configuration.
+ *
+ * @tparam Reps Number of measured repetitions
+ * @tparam Fn Function pointer
+ * @tparam Args Arguments of the function
+ * @param fn Function pointer
+ * @param args Arguments of the function
+ * @return Statistics in nanoseconds per call
+ */
+template<size_t Reps = 31, class Fn, class ...Args,
+    class = std::enable_if_t<!std::is_same_v<std::decay_t<Fn>, bench_cfg>>>
+bench_result bench(Fn &&fn, Args &&...args)
+{
+    return bench<Reps>(bench_cfg{}, fn, args...);
+}
+
+/**
+ * @brief Measure execution time of a member function.
+ *
+ * @tparam Reps Number of measured repetitions
+ * @tparam Fn Member function pointer
+ * @tparam Ptr Object pointer
+ * @tparam Args Arguments of the member function
+ * @param cfg Configuration
+ * @param fn Member function pointer
+ * @param ptr Object pointer
+ * @param args Arguments of the member function
+ * @return Statistics in nanoseconds per call
+ */
+template<size_t Reps = 31, class Fn, class Ptr, class ...Args>
+bench_result m_bench(const bench_cfg &cfg, Fn &&fn, Ptr *ptr, Args &&...args)
+{
+    return bench<Reps>(cfg, [&] {
+        do_not_optimize(ptr);
+        return (ptr->*fn)(args...);
+    });
+}
+
+/**
+ * @brief Record latency of every single call into a histogram, to see tail
+ * behaviour hidden by per-repetition averages. Each sample includes overhead
+ * of reading the TSC twice.
+ *
+ * @tparam Hist Histogram type, e.g. utl::histogram
+ * @tparam Fn Function pointer
+ * @tparam Args Arguments of the function
+ * @param hist Histogram to record nanoseconds into
+ * @param calls Number of calls
+ * @param fn Function pointer
+ * @param args Arguments of the function
+ */
+template<class Hist, class Fn, class ...Args>
+void bench_latency(Hist &hist, size_t calls, Fn &&fn, Args &&...args)
+{
+    for (size_t i = 0; i < calls; ++i) {
+        (do_not_optimize(args), ...);
+        auto begin = tsc_clock::ticks();
+        if constexpr (std::is_void_v<std::invoke_result_t<Fn&, Args&...>>)
+            fn(args...);
+        else
+            do_not_optimize(fn(args...));
+        auto end = tsc_clock::ticks();
+        hist.record(tsc_clock::to_ns(end - begin));
+    }
+}
+
+/**
+ * @brief Measure execution time of a member function with default configuration.
+ *
+ * @tparam Reps Number of measured repetitions
+ * @tparam Fn Member function pointer
+ * @tparam Ptr Object pointer
+ * @tparam Args Arguments of the member function
+ * @param fn Member function pointer
+ * @param ptr Object pointer
+ * @param args Arguments of the member function
+ * @return Statistics in nanoseconds per call
+ */
+template<size_t Reps = 31, class Fn, class Ptr, class ...Args,
+    class = std::enable_if_t<!std::is_same_v<std::decay_t<Fn>, bench_cfg>>>
+bench_result m_bench(Fn &&fn, Ptr *ptr, Args &&...args)
+{
+    return m_bench<Reps>(bench_cfg{}, fn, ptr, args...);
+}
+
+/**
+ * @brief Measure hardware counters of a function for N calls. Arguments
+ * and result of each call are passed through do_not_optimize().
+ *
+ * @tparam N Number of calls
+ * @tparam Fn Function pointer
+ * @tparam Args Arguments of the function
+ * @param fn Function pointer
+ * @param args Arguments of the function
+ * @return Average counter values for each call
+ */
+template<size_t N = 1, class Fn, class ...Args>
+perf_sample exec_counters(Fn &&fn, Args &&...args)
+{
+    perf_counters pc;
+    pc.start();
+    for (size_t i = 0; i < N; ++i) {
+        (do_not_optimize(args), ...);
+        if constexpr (std::is_void_v<std::invoke_result_t<Fn&, Args&...>>)
+            fn(args...);
+        else
+            do_not_optimize(fn(args...));
+    }
+    return pc.stop(N);
+}
+
+/**
+ * @brief Measure hardware counters of a member function for N calls,
+ * same as exec_counters().
+ *
+ * @tparam N Number of calls
+ * @tparam Fn Member function pointer
+ * @tparam Ptr Object pointer
+ * @tparam Args Arguments of the member function
+ * @param fn Member function pointer
+ * @param ptr Object pointer
+ * @param args Arguments of the member function
+ * @return Average counter values for each call
+ */
+template<size_t N = 1, class Fn, class Ptr, class ...Args>
+perf_sample m_exec_counters(Fn &&fn, Ptr *ptr, Args &&...args)
+{
+    return exec_counters<N>([&] {
+        do_not_optimize(ptr);
+        return (ptr->*fn)(args...);
+    });
+}
+
+}
+
+#endif
\ No newline at end of file
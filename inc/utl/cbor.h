@@ -0,0 +1,508 @@
+#ifndef UTL_CBOR_H
+#define UTL_CBOR_H
+
+#include "utl/float.h"
+#include "utl/svector.h"
+#include <limits>
+#include <string_view>
+#include <type_traits>
+
+namespace utl {
+
+/**
+ * @brief CBOR major types and simple values, see RFC 8949.
+ *
+ */
+enum class cbor_type : uint8_t {
+    uint,       // Unsigned integer
+    nint,       // Negative integer, -1 - value
+    bytes,      // Byte string
+    text,       // UTF-8 string
+    array,      // Array header, followed by items
+    map,        // Map header, followed by key-value pairs
+    tag,        // Tag, followed by tagged item
+    simple,     // Unassigned simple value
+    boolean,
+    null,
+    undefined,
+    floating,   // Half, single or double
+    brk,        // End of indefinite length item
+    error,      // Malformed or truncated input
+};
+
+/**
+ * @brief Single CBOR token. Strings point into decoded buffer.
+ *
+ */
+struct cbor_item {
+    cbor_type type = cbor_type::error;
+    bool indefinite = false;    // Array, map or string without length
+    uint64_t val = 0;           // Integer, length, number of pairs, tag or simple value
+    double f = 0;               // Floating point value
+    std::string_view str;       // Contents of definite length string
+
+    // Integer as signed, false if it doesn't fit.
+    bool get(int64_t &x) const
+    {
+        if (type == cbor_type::uint && val <= uint64_t(INT64_MAX))
+            return x = int64_t(val), true;
+        if (type == cbor_type::nint && val <= uint64_t(INT64_MAX))
+            return x = -1 - int64_t(val), true;
+        return false;
+    }
+};
+
+namespace impl {
+
+enum cbor_major : uint8_t {
+    cbor_uint   = 0 << 5,
+    cbor_nint   = 1 << 5,
+    cbor_bytes  = 2 << 5,
+    cbor_text   = 3 << 5,
+    cbor_array  = 4 << 5,
+    cbor_map    = 5 << 5,
+    cbor_tag    = 6 << 5,
+    cbor_prim   = 7 << 5,
+};
+
+inline constexpr uint8_t cbor_indefinite = 31;
+inline constexpr uint8_t cbor_false = cbor_prim | 20;
+inline constexpr uint8_t cbor_true = cbor_prim | 21;
+inline constexpr uint8_t cbor_null = cbor_prim | 22;
+inline constexpr uint8_t cbor_undefined = cbor_prim | 23;
+inline constexpr uint8_t cbor_half = cbor_prim | 25;
+inline constexpr uint8_t cbor_single = cbor_prim | 26;
+inline constexpr uint8_t cbor_double = cbor_prim | 27;
+inline constexpr uint8_t cbor_break = cbor_prim | 31;
+inline constexpr size_t cbor_chunk = 64;        // Stack buffer of batch float encoding
+inline constexpr unsigned cbor_max_depth = 64;  // Nesting skipped recursively
+
+/**
+ * @brief Narrowest lossless float encoding, NaN becomes canonical half.
+ *
+ * @param d Value
+ * @param f Value rounded to single
+ * @param back Single rounded to half and back, as bits
+ * @return 2, 4 or 8 bytes
+ */
+constexpr unsigned cbor_float_width(double d, float f, uint32_t back)
+{
+    if (d != d)
+        return 2;
+    if (double(f) != d)
+        return 8;
+    return Float(f).u32 == back ? 2 : 4;
+}
+
+}
+
+/**
+ * @brief Streaming CBOR encoder into caller buffer. Each write checks
+ * space, after overflow writer stops and valid() is false. Floats are
+ * written in narrowest of half, single or double which keeps the value
+ * exactly, NaN payloads aren't kept. Integers also take narrowest head.
+ *
+ */
+struct cbor_writer {
+    cbor_writer(uint8_t *buf, size_t cap) : buf{buf}, cap{cap} {}
+
+    // Encoded data.
+    const uint8_t* data() const     { return buf; }
+    // Number of bytes written.
+    size_t size() const             { return len; }
+    // Check if everything fit.
+    bool valid() const              { return ok; }
+    // Start over in the same buffer.
+    void clear()                    { len = 0; ok = true; }
+
+    /**
+     * @brief Encode integer, bool, floating point or string.
+     *
+     * @param x Value
+     * @return Writer, for chaining
+     */
+    template<class T>
+    cbor_writer& put(const T &x)
+    {
+        if constexpr (std::is_same_v<T, bool>)
+            byte(x ? impl::cbor_true : impl::cbor_false);
+        else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+            head(x < 0 ? impl::cbor_nint : impl::cbor_uint, x < 0 ? ~uint64_t(x) : uint64_t(x));
+        else if constexpr (std::is_integral_v<T>)
+            head(impl::cbor_uint, x);
+        else if constexpr (std::is_floating_point_v<T>)
+            put_float(double(x));
+        else if constexpr (std::is_same_v<T, std::nullptr_t>)
+            byte(impl::cbor_null);
+        else
+            put_str(impl::cbor_text, std::string_view(x));
+        return *this;
+    }
+
+    /**
+     * @brief Encode array of doubles, each in narrowest exact width. Half
+     * round trips run over chunks with batch functions of "float.h", which
+     * use F16C when CPU has it.
+     *
+     * @param v Values
+     * @param n Number of values
+     * @return Writer
+     */
+    cbor_writer& put(const double *v, size_t n)
+    {
+        put_array(n);
+        float f[impl::cbor_chunk];
+        float back[impl::cbor_chunk];
+        uint16_t h[impl::cbor_chunk];
+        for (size_t i = 0; i < n; i += impl::cbor_chunk) {
+            const size_t m = n - i < impl::cbor_chunk ? n - i : impl::cbor_chunk;
+            for (size_t k = 0; k < m; ++k)
+                f[k] = float(v[i + k]);
+            float_to_half(f, h, m);
+            half_to_float(h, back, m);
+            for (size_t k = 0; k < m; ++k)
+                put_float(v[i + k], f[k], h[k], Float(back[k]).u32);
+        }
+        return *this;
+    }
+
+    // Encode byte string.
+    cbor_writer& put_bytes(const uint8_t *p, size_t n)
+    {
+        return put_str(impl::cbor_bytes, std::string_view(reinterpret_cast<const char*>(p), n));
+    }
+    // Encode array header, followed by n items.
+    cbor_writer& put_array(size_t n)    { return head(impl::cbor_array, n); }
+    // Encode map header, followed by n key-value pairs.
+    cbor_writer& put_map(size_t n)      { return head(impl::cbor_map, n); }
+    // Encode tag, followed by tagged item.
+    cbor_writer& put_tag(uint64_t tag)  { return head(impl::cbor_tag, tag); }
+    // Encode null.
+    cbor_writer& put_null()             { return byte(impl::cbor_null); }
+    // Start array of unknown length, end it with put_break().
+    cbor_writer& begin_array()          { return byte(impl::cbor_array | impl::cbor_indefinite); }
+    // Start map of unknown length, end it with put_break().
+    cbor_writer& begin_map()            { return byte(impl::cbor_map | impl::cbor_indefinite); }
+    // End indefinite length item.
+    cbor_writer& put_break()            { return byte(impl::cbor_break); }
+private:
+    cbor_writer& byte(uint8_t b)
+    {
+        if (!ok)
+            return *this;
+        if (len < cap)
+            buf[len++] = b;
+        else
+            ok = false;
+        return *this;
+    }
+
+    // Number of argument bytes after initial byte.
+    static unsigned head_width(uint64_t val)
+    {
+        return val < 24 ? 0 : val <= 0xff ? 1 : val <= 0xffff ? 2 : val <= 0xffffffff ? 4 : 8;
+    }
+
+    cbor_writer& head(uint8_t major, uint64_t val)
+    {
+        const unsigned n = head_width(val);
+        if (!ok || cap - len < n + 1u) {
+            ok = false;
+            return *this;
+        }
+        buf[len++] = uint8_t(major | (!n ? val : n == 1 ? 24 : n == 2 ? 25 : n == 4 ? 26 : 27));
+        for (unsigned i = n; i--;)
+            buf[len++] = uint8_t(val >> i * 8);
+        return *this;
+    }
+
+    cbor_writer& put_float(double d)
+    {
+        const float f = float(d);
+        const uint16_t h = float_to_half(Float(f).u32);
+        return put_float(d, f, h, half_to_float(h));
+    }
+
+    cbor_writer& put_float(double d, float f, uint16_t h, uint32_t back)
+    {
+        const unsigned w = impl::cbor_float_width(d, f, back);
+        if (!ok || cap - len < w + 1u) {
+            ok = false;
+            return *this;
+        }
+        const uint64_t bits = w == 2 ? (d != d ? 0x7e00 : h) : w == 4 ? Float(f).u32 : Float(d).u64;
+        buf[len++] = w == 2 ? impl::cbor_half : w == 4 ? impl::cbor_single : impl::cbor_double;
+        for (unsigned i = w; i--;)
+            buf[len++] = uint8_t(bits >> i * 8);
+        return *this;
+    }
+
+    cbor_writer& put_str(uint8_t major, std::string_view s)
+    {
+        const size_t n = head_width(s.size()) + 1u;
+        if (!ok || cap - len < n || cap - len - n < s.size()) {   // Header is only written with payload
+            ok = false;
+            return *this;
+        }
+        head(major, s.size());
+        memcpy(buf + len, s.data(), s.size());
+        len += s.size();
+        return *this;
+    }
+
+    uint8_t *buf;
+    size_t cap;
+    size_t len = 0;
+    bool ok = true;
+};
+
+/**
+ * @brief Pull CBOR decoder. Tokens are read one by one, strings are views
+ * into input, so input must outlive them. Nothing is allocated, typed
+ * reads fill fixed capacity containers. Failed typed read doesn't consume
+ * anything, malformed input stops decoder with cbor_type::error.
+ *
+ */
+struct cbor_reader {
+    cbor_reader(const uint8_t *buf, size_t len) : buf{buf}, len{len} {}
+
+    // Check if all input was consumed.
+    bool done() const   { return pos == len; }
+    // Current offset in input.
+    size_t offset() const { return pos; }
+
+    /**
+     * @brief Read next token, header only for arrays, maps and tags.
+     *
+     * @param item Output token
+     * @return false on error or end of input
+     */
+    bool next(cbor_item &item)
+    {
+        const size_t p = decode(pos, item);
+        if (item.type == cbor_type::error)
+            return false;
+        pos = p;
+        return true;
+    }
+
+    /**
+     * @brief Look at next token without consuming it.
+     *
+     * @return Token type, error at end of input
+     */
+    cbor_type peek() const
+    {
+        cbor_item item;
+        decode(pos, item);
+        return item.type;
+    }
+
+    /**
+     * @brief Skip next complete item, including nested items and tagged value.
+     *
+     * @return false on malformed input
+     */
+    bool skip()
+    {
+        const size_t p = skip(pos, 0);
+        if (!p)
+            return false;
+        pos = p;
+        return true;
+    }
+
+    /**
+     * @brief Read value of given type, see below for containers.
+     *
+     * @param x Output integer, bool, floating point or string view
+     * @return false if next item has other type or doesn't fit
+     */
+    template<class T>
+    bool read(T &x)
+    {
+        cbor_item item;
+        const size_t p = decode(pos, item);
+        if (!convert(item, x))
+            return false;
+        pos = p;
+        return true;
+    }
+
+    /**
+     * @brief Read definite length array of values into static vector.
+     *
+     * @param out Output vector, cleared first
+     * @return false if item isn't array, has wrong elements or is too long
+     */
+    template<class T, size_t N>
+    bool read(svector<T, N> &out)
+    {
+        cbor_item item;
+        size_t p = decode(pos, item);
+        if (item.type != cbor_type::array || item.indefinite || item.val > N)
+            return false;
+        out.clear();
+        for (uint64_t i = 0; i < item.val; ++i) {
+            cbor_item el;
+            p = decode(p, el);
+            T x;
+            if (!convert(el, x))
+                return false;
+            out.push_back(x);
+        }
+        pos = p;
+        return true;
+    }
+private:
+    template<class T>
+    static bool convert(const cbor_item &item, T &x)
+    {
+        if constexpr (std::is_same_v<T, bool>) {
+            if (item.type != cbor_type::boolean)
+                return false;
+            x = item.val;
+        } else if constexpr (std::is_integral_v<T>) {
+            if (item.type == cbor_type::uint) {
+                if (item.val > uint64_t(std::numeric_limits<T>::max()))
+                    return false;
+                x = T(item.val);
+            } else if (std::is_signed_v<T> && item.type == cbor_type::nint) {
+                int64_t v;
+                if (!item.get(v) || v < int64_t(std::numeric_limits<T>::min()))
+                    return false;
+                x = T(v);
+            } else {
+                return false;
+            }
+        } else if constexpr (std::is_floating_point_v<T>) {
+            if (item.type == cbor_type::floating)
+                x = T(item.f);
+            else if (item.type == cbor_type::uint)
+                x = T(item.val);
+            else if (item.type == cbor_type::nint)
+                x = -1 - T(item.val);
+            else
+                return false;
+        } else {
+            if (item.type != cbor_type::text || item.indefinite)
+                return false;
+            x = item.str;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Decode token at offset.
+     *
+     * @return Offset after token, item type is error on failure
+     */
+    size_t decode(size_t p, cbor_item &item) const
+    {
+        item = {};
+        if (p >= len)
+            return p;
+        const uint8_t ib = buf[p++];
+        const uint8_t major = ib & 0xe0;
+        const uint8_t info = ib & 0x1f;
+        uint64_t val = info;
+        if (info >= 24 && info <= 27) {
+            const size_t n = size_t(1) << (info - 24);
+            if (len - p < n)
+                return p;
+            val = 0;
+            for (size_t i = 0; i < n; ++i)
+                val = val << 8 | buf[p++];
+        } else if (info == impl::cbor_indefinite) {
+            if (major == impl::cbor_uint || major == impl::cbor_nint || major == impl::cbor_tag)
+                return p;
+            item.indefinite = true;
+            val = 0;
+        } else if (info > 27) {
+            return p;
+        }
+        item.val = val;
+        switch (major) {
+        case impl::cbor_uint:   item.type = cbor_type::uint; break;
+        case impl::cbor_nint:   item.type = cbor_type::nint; break;
+        case impl::cbor_array:  item.type = cbor_type::array; break;
+        case impl::cbor_map:    item.type = cbor_type::map; break;
+        case impl::cbor_tag:    item.type = cbor_type::tag; break;
+        case impl::cbor_bytes:
+        case impl::cbor_text:
+            if (!item.indefinite) {
+                if (len - p < val)
+                    return p;
+                item.str = std::string_view(reinterpret_cast<const char*>(buf + p), size_t(val));
+                p += size_t(val);
+            }
+            item.type = major == impl::cbor_text ? cbor_type::text : cbor_type::bytes;
+            break;
+        default:
+            switch (info) {
+            case 20: case 21:
+                item.type = cbor_type::boolean;
+                item.val = info == 21;
+                break;
+            case 22: item.type = cbor_type::null; break;
+            case 23: item.type = cbor_type::undefined; break;
+            case 25: item.type = cbor_type::floating; item.f = Float(half_to_double(uint16_t(val))).f64; break;
+            case 26: item.type = cbor_type::floating; item.f = Float(uint32_t(val)).f32; break;
+            case 27: item.type = cbor_type::floating; item.f = Float(val).f64; break;
+            case 31: item.type = cbor_type::brk; break;
+            default:
+                if (info == 24 && val < 32)     // Must have used short form
+                    return p;
+                item.type = cbor_type::simple;
+            }
+        }
+        return p;
+    }
+
+    /**
+     * @brief Skip item at offset with all nested items.
+     *
+     * @return Offset after item, 0 on failure
+     */
+    size_t skip(size_t p, unsigned depth) const
+    {
+        cbor_item item;
+        p = decode(p, item);
+        if (item.type == cbor_type::error || item.type == cbor_type::brk || depth > impl::cbor_max_depth)
+            return 0;
+        if (item.type == cbor_type::tag)
+            return skip(p, depth + 1);
+        if (item.indefinite) {
+            const bool chunked = item.type == cbor_type::bytes || item.type == cbor_type::text;
+            for (uint64_t i = 0;; ++i) {
+                cbor_item end;
+                const size_t q = decode(p, end);
+                if (end.type == cbor_type::brk)     // Map needs value for each key
+                    return item.type == cbor_type::map && (i & 1) ? 0 : q;
+                if (chunked) {  // Only definite strings of the same type, RFC 8949 3.2.3
+                    if (end.type != item.type || end.indefinite)
+                        return 0;
+                    p = q;
+                } else if (!(p = skip(p, depth + 1))) {
+                    return 0;
+                }
+            }
+        }
+        const size_t left = len - p;    // Each item takes at least a byte, so longer headers are malformed
+        if ((item.type == cbor_type::array && item.val > left) || (item.type == cbor_type::map && item.val > left / 2))
+            return 0;
+        const uint64_t n = item.type == cbor_type::array ? item.val : item.type == cbor_type::map ? item.val * 2 : 0;
+        for (uint64_t i = 0; i < n; ++i)
+            if (!(p = skip(p, depth + 1)))
+                return 0;
+        return p;
+    }
+
+    const uint8_t *buf;
+    size_t len;
+    size_t pos = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,187 @@
+#ifndef UTL_CPU_H
+#define UTL_CPU_H
+
+#include "utl/base.h"
+#include <atomic>
+#include <cstdlib>
+#include <string_view>
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <cpuid.h>
+#define UTL_CPU_X86 1
+#ifndef UTL_NO_MULTI_ISA
+#include <immintrin.h>
+#define UTL_CPU_DISPATCH 1  // Build target-specific kernel variants, picked at runtime
+#endif
+#endif
+
+namespace utl {
+
+/**
+ * @brief Instruction set extensions used by runtime dispatched kernels.
+ * AVX family is reported only if OS saves the wider registers.
+ *
+ */
+enum cpu_feature : uint32_t {
+    cpu_sse2    = 1 << 0,
+    cpu_ssse3   = 1 << 1,
+    cpu_sse42   = 1 << 2,
+    cpu_avx     = 1 << 3,
+    cpu_avx2    = 1 << 4,
+    cpu_fma     = 1 << 5,
+    cpu_f16c    = 1 << 6,
+    cpu_bmi2    = 1 << 7,
+    cpu_avx512f = 1 << 8,
+};
+
+namespace impl {
+
+inline constexpr std::string_view cpu_names[] = {
+    "sse2", "ssse3", "sse42", "avx", "avx2", "fma", "f16c", "bmi2", "avx512f",
+};
+
+/**
+ * @brief Parse comma separated feature names, "all" selects every feature.
+ * Unknown names are ignored.
+ *
+ * @param str Feature list
+ * @return Feature mask
+ */
+constexpr uint32_t cpu_parse(std::string_view str)
+{
+    uint32_t mask = 0;
+    while (!str.empty()) {
+        const size_t end = str.find(',');
+        const std::string_view name = str.substr(0, end);
+        if (name == "all")
+            mask = ~0u;
+        for (size_t i = 0; i < std::size(cpu_names); ++i)
+            if (name == cpu_names[i])
+                mask |= 1u << i;
+        str.remove_prefix(end == std::string_view::npos ? str.size() : end + 1);
+    }
+    return mask;
+}
+
+/**
+ * @brief Execute CPUID.
+ *
+ * @param leaf Leaf in EAX
+ * @param sub Subleaf in ECX
+ * @param r Output EAX, EBX, ECX, EDX
+ * @return false if leaf isn't supported
+ */
+inline bool cpuid(unsigned leaf, unsigned sub, unsigned (&r)[4])
+{
+#ifdef UTL_CPU_X86
+    return __get_cpuid_count(leaf, sub, &r[0], &r[1], &r[2], &r[3]);
+#else
+    (void) leaf, (void) sub, (void) r;
+    return false;
+#endif
+}
+
+/**
+ * @brief Query CPUID and OS register support once.
+ *
+ * @return Supported features
+ */
+inline uint32_t cpu_detect()
+{
+    uint32_t f = 0;
+#ifdef UTL_CPU_X86
+    unsigned r[4];
+    if (!cpuid(1, 0, r))
+        return 0;
+    const unsigned c = r[2];
+    uint64_t xcr0 = 0;
+    if (c & bit_OSXSAVE) {
+        unsigned lo, hi;
+        __asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        xcr0 = uint64_t(hi) << 32 | lo;
+    }
+    const bool ymm = (xcr0 & 0x06) == 0x06;     // XMM and YMM state
+    const bool zmm = (xcr0 & 0xe6) == 0xe6;     // And opmask, ZMM state
+    if (r[3] & bit_SSE2)
+        f |= cpu_sse2;
+    if (c & bit_SSSE3)
+        f |= cpu_ssse3;
+    if (c & bit_SSE4_2)
+        f |= cpu_sse42;
+    if (ymm && (c & bit_AVX))
+        f |= cpu_avx;
+    if (ymm && (c & bit_FMA))
+        f |= cpu_fma;
+    if (ymm && (c & bit_F16C))
+        f |= cpu_f16c;
+    if (cpuid(7, 0, r)) {
+        if (ymm && (r[1] & bit_AVX2))
+            f |= cpu_avx2;
+        if (r[1] & bit_BMI2)
+            f |= cpu_bmi2;
+        if (zmm && (r[1] & bit_AVX512F))
+            f |= cpu_avx512f;
+    }
+#endif
+    return f;
+}
+
+/**
+ * @brief Detected features minus ones listed in UTL_CPU_DISABLE
+ * environment variable, e.g. "avx512f,bmi2" or "all" for scalar code.
+ *
+ * @return Usable features
+ */
+inline uint32_t cpu_usable()
+{
+    static const uint32_t f = [] {
+        const char *env = std::getenv("UTL_CPU_DISABLE");
+        return cpu_detect() & ~cpu_parse(env ? env : "");
+    }();
+    return f;
+}
+
+inline std::atomic<uint32_t>& cpu_state()
+{
+    static std::atomic<uint32_t> f{cpu_usable()};
+    return f;
+}
+
+}
+
+/**
+ * @brief Features that dispatched kernels may currently use.
+ *
+ * @return Mask of cpu_feature
+ */
+inline uint32_t cpu_features()
+{
+    return impl::cpu_state().load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Check if all given features may be used.
+ *
+ * @param mask Mask of cpu_feature
+ * @return true if all are present
+ */
+inline bool cpu_has(uint32_t mask)
+{
+    return (cpu_features() & mask) == mask;
+}
+
+/**
+ * @brief Restrict dispatched kernels to subset of usable features, e.g.
+ * to test or benchmark slower paths on fast host. Features can't be added
+ * beyond detected ones, ~0 restores them all.
+ *
+ * @param mask Allowed features
+ * @return Previously allowed features
+ */
+inline uint32_t cpu_restrict(uint32_t mask)
+{
+    return impl::cpu_state().exchange(impl::cpu_usable() & mask, std::memory_order_relaxed);
+}
+
+}
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef UTL_CRC_H
+#define UTL_CRC_H
+
+#include "utl/cpu.h"
+#include "utl/table.h"
+#include <cstring>
+
+namespace utl {
+namespace impl {
+
+inline constexpr auto crc32c_table = crc_table<uint32_t, 0x82f63b78>();
+
+#ifdef UTL_CPU_DISPATCH
+__attribute__((target("sse4.2")))
+inline uint32_t crc32c_sse42(const uint8_t *data, size_t len, uint32_t crc)
+{
+    uint64_t c = crc;
+    size_t i = 0;
+    for (const size_t m = len & ~size_t(7); i < m; i += 8) {
+        uint64_t w;
+        memcpy(&w, data + i, sizeof(w));
+        c = _mm_crc32_u64(c, w);
+    }
+    for (; i < len; ++i)
+        c = _mm_crc32_u8(uint32_t(c), data[i]);
+    return uint32_t(c);
+}
+#endif
+
+}
+
+/**
+ * @brief CRC-32C (Castagnoli), as used by iSCSI, ext4 and SCTP. Uses SSE4.2
+ * crc32 instruction when CPU has it, bytewise table otherwise.
+ *
+ * @param data Input array
+ * @param len Input array length
+ * @param crc Result of previous part to continue, 0 to start
+ * @return CRC
+ */
+constexpr uint32_t crc32c(const uint8_t *data, size_t len, uint32_t crc = 0)
+{
+    crc = ~crc;
+#ifdef UTL_CPU_DISPATCH
+    if (!__builtin_is_constant_evaluated() && cpu_has(cpu_sse42))
+        return ~impl::crc32c_sse42(data, len, crc);
+#endif
+    for (size_t i = 0; i < len; ++i)
+        crc = impl::crc32c_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+}
+
+#endif
@@ -0,0 +1,208 @@
+#ifndef UTL_DIVIDE_H
+#define UTL_DIVIDE_H
+
+#include "utl/base.h"
+#include <type_traits>
+
+namespace utl {
+namespace impl {
+
+/**
+ * @brief Count leading zeros, argument must be non-zero.
+ *
+ */
+template<class U>
+constexpr unsigned clz(U x)
+{
+#ifdef __GNUC__
+    return sizeof(U) > 4 ? __builtin_clzll(x) : __builtin_clz(x);
+#else
+    unsigned n = 0;
+    for (U m = U(1) << (sizeof(U) * 8 - 1); !(x & m); m >>= 1)
+        ++n;
+    return n;
+#endif
+}
+
+constexpr uint32_t mulhi(uint32_t a, uint32_t b)
+{
+    return uint64_t(a) * b >> 32;
+}
+
+constexpr uint64_t mulhi(uint64_t a, uint64_t b)
+{
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef unsigned __int128 u128;
+    return u128(a) * b >> 64;
+#else
+    const uint64_t lo = (a & 0xffffffff) * (b & 0xffffffff);
+    const uint64_t m1 = (a >> 32) * (b & 0xffffffff) + (lo >> 32);
+    const uint64_t m2 = (a & 0xffffffff) * (b >> 32) + (m1 & 0xffffffff);
+    return (a >> 32) * (b >> 32) + (m1 >> 32) + (m2 >> 32);
+#endif
+}
+
+constexpr int32_t mulhi(int32_t a, int32_t b)
+{
+    return int64_t(a) * b >> 32;
+}
+
+constexpr int64_t mulhi(int64_t a, int64_t b)
+{
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef __int128 i128;
+    return i128(a) * b >> 64;
+#else
+    const uint64_t h = mulhi(uint64_t(a), uint64_t(b)) - (a < 0 ? uint64_t(b) : 0) - (b < 0 ? uint64_t(a) : 0);
+    return int64_t(h);
+#endif
+}
+
+/**
+ * @brief Divide double-width number hi * 2^N by d, quotient must fit.
+ *
+ * @param hi High word, less than d
+ * @param d Divisor
+ * @return Quotient
+ */
+constexpr uint32_t div_wide(uint32_t hi, uint32_t d)
+{
+    return (uint64_t(hi) << 32) / d;
+}
+
+constexpr uint64_t div_wide(uint64_t hi, uint64_t d)
+{
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef unsigned __int128 u128;
+    return (u128(hi) << 64) / d;
+#else
+    uint64_t q = 0;
+    for (int i = 0; i < 64; ++i) {
+        const bool carry = hi >> 63;
+        hi <<= 1;
+        q <<= 1;
+        if (carry || hi >= d) {
+            hi -= d;
+            q |= 1;
+        }
+    }
+    return q;
+#endif
+}
+
+}
+
+/**
+ * @brief Division by runtime invariant integer, replaced with multiplication
+ * by precomputed magic number and shifts, see Granlund and Montgomery,
+ * "Division by Invariant Integers using Multiplication". Division is
+ * branchless and takes a few cycles instead of 20-90 for hardware divide.
+ * Quotients round toward zero, same as built-in operators.
+ *
+ * @tparam T Integer type, 8 to 64 bits
+ */
+template<class T>
+struct divider {
+private:
+    static_assert(std::is_integral_v<T> && !std::is_same_v<T, bool>, "T must be integer");
+    typedef std::conditional_t<sizeof(T) <= 4, uint32_t, uint64_t> U;
+    typedef std::make_signed_t<U> S;
+    static constexpr unsigned bits = sizeof(U) * 8;
+public:
+    /**
+     * @brief Precompute constants.
+     *
+     * @param d Divisor, must be non-zero
+     */
+    constexpr explicit divider(T d = 1) : d{d}
+    {
+        if constexpr (std::is_unsigned_v<T>) {
+            const unsigned l = d > 1 ? bits - impl::clz(U(d - 1)) : 0;   // ceil(log2(d))
+            const U hi = l < bits ? (U(1) << l) - U(d) : U(0) - U(d);   // 2^l - d
+            mul = impl::div_wide(hi, U(d)) + 1;
+            sh1 = l ? 1 : 0;
+            sh2 = l ? l - 1 : 0;
+        } else {
+            const U ad = d < 0 ? U(0) - U(S(d)) : U(d);
+            const unsigned l = ad > 2 ? bits - impl::clz(U(ad - 1)) : 1;
+            mul = 1 + (ad > 1 ? impl::div_wide(U(1) << (l - 1), ad) : 0); // Less 2^N, so it's signed
+            sh1 = l - 1;
+            sh2 = d < 0;
+        }
+    }
+
+    constexpr T divisor() const
+    {
+        return d;
+    }
+
+    /**
+     * @brief Divide by precomputed divisor.
+     *
+     * @param n Dividend
+     * @return Quotient, rounded toward zero
+     */
+    constexpr T divide(T n) const
+    {
+        if constexpr (std::is_unsigned_v<T>) {
+            const U q = impl::mulhi(mul, U(n));
+            return T((((U(n) - q) >> sh1) + q) >> sh2);
+        } else {
+            const S sn = S(n);
+            const S sign = -S(sh2);
+            const S q = S(U(sn) + U(impl::mulhi(S(mul), sn))) >> sh1;
+            const U r = U(q) - U(sn >> (bits - 1));
+            return T(S((r ^ U(sign)) - U(sign)));
+        }
+    }
+
+    /**
+     * @brief Remainder of division by precomputed divisor.
+     *
+     * @param n Dividend
+     * @return Remainder, with sign of dividend
+     */
+    constexpr T modulo(T n) const
+    {
+        return T(U(n) - U(divide(n)) * U(d));
+    }
+
+    /**
+     * @brief Divide array elementwise. Loop has no branches, so compiler
+     * may vectorize it. Output may be the same array as input.
+     *
+     * @param src Dividends
+     * @param dst Quotients
+     * @param n Number of elements
+     */
+    void divide(const T *src, T *dst, size_t n) const
+    {
+        for (size_t i = 0; i < n; ++i)
+            dst[i] = divide(src[i]);
+    }
+
+    /**
+     * @brief Remainder of array elements. Output may be the same array as input.
+     *
+     * @param src Dividends
+     * @param dst Remainders
+     * @param n Number of elements
+     */
+    void modulo(const T *src, T *dst, size_t n) const
+    {
+        for (size_t i = 0; i < n; ++i)
+            dst[i] = modulo(src[i]);
+    }
+
+    friend constexpr T operator/(T n, const divider &d) { return d.divide(n); }
+    friend constexpr T operator%(T n, const divider &d) { return d.modulo(n); }
+private:
+    U mul = 0;
+    uint8_t sh1 = 0;    // Pre-shift for unsigned, post-shift for signed
+    uint8_t sh2 = 0;    // Post-shift for unsigned, divisor sign for signed
+    T d;
+};
+
+}
+
+#endif
@@ -0,0 +1,425 @@
+#ifndef UTL_FASTMATH_H
+#define UTL_FASTMATH_H
+
+#include "utl/cpu.h"
+#include "utl/math.h"
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+#ifdef UTL_CPU_DISPATCH
+#define UTL_FASTMATH_SIMD 1
+#endif
+
+namespace utl {
+
+/**
+ * @brief Implementation of elementary functions used by physics.h.
+ *
+ */
+enum class math_mode {
+    precise,    // libm
+    fast,       // Polynomial approximations from "fastmath.h"
+};
+
+namespace impl {
+
+/**
+ * @brief Lane kernels below are shared by scalar double and GCC vectors of
+ * doubles, e.g. __m256d. Vectors are passed by reference, as passing them
+ * by value from code compiled without AVX changes ABI. Kernels are forced
+ * inline, so they get compiled for the target of each caller.
+ *
+ */
+template<class T>
+using fm_int = std::conditional_t<std::is_same_v<T, double>, int64_t, decltype(T{} < T{})>;
+
+#ifdef __GNUC__
+#define UTL_FM_INLINE __attribute__((always_inline)) inline
+#define UTL_FM_CONSTEXPR constexpr
+#define UTL_FM_BIT_CAST(T, x) __builtin_bit_cast(T, x)  // Builtin keeps vectors out of call ABI
+#else
+#define UTL_FM_INLINE inline
+#define UTL_FM_CONSTEXPR    // Bit casts need memcpy
+#define UTL_FM_BIT_CAST(T, x) ::utl::impl::fm_bit_cast<T>(x)
+#endif
+
+#ifndef __GNUC__
+/**
+ * @brief Reinterpret bits of scalar, fallback for compilers without
+ * __builtin_bit_cast, which only build scalar lanes.
+ *
+ */
+template<class To, class From>
+inline To fm_bit_cast(const From &x)
+{
+    static_assert(sizeof(To) == sizeof(From), "sizes must match");
+    To r;
+    memcpy(&r, &x, sizeof(To));
+    return r;
+}
+#endif
+
+UTL_FM_INLINE void fm_sqrt(const double &x, double &r)
+{
+    r = std::sqrt(x);
+}
+
+/**
+ * @brief Square root of vector by reciprocal square root estimate and
+ * Newton iterations, as vector sqrt instruction can't be reached without
+ * target specific code. Argument must be finite and non-negative.
+ *
+ */
+template<class T>
+UTL_FM_INLINE UTL_FM_CONSTEXPR void fm_sqrt(const T &x, T &r)
+{
+    typedef fm_int<T> I;
+    T y = UTL_FM_BIT_CAST(T, 0x5fe6eb50c7b537a9 - (UTL_FM_BIT_CAST(I, x) >> 1));
+
+    y = y * (1.5 - 0.5 * x * y * y);
+    y = y * (1.5 - 0.5 * x * y * y);
+    y = y * (1.5 - 0.5 * x * y * y);
+    r = x * y;
+    r = r + 0.5 * y * (x - r * r);
+}
+
+/**
+ * @brief Sine or cosine. Argument is reduced modulo pi/2 with three-part
+ * Cody-Waite constant, exact for |x| < 2^20 * pi/2, then fdlibm minimax
+ * polynomials of degree 13 and 14 are evaluated.
+ *
+ * @param x Argument
+ * @param r Result
+ * @param cosine Quadrant offset, 0 for sine and 1 for cosine
+ */
+template<class T>
+UTL_FM_INLINE UTL_FM_CONSTEXPR void fm_sincos_lanes(const T &x, T &r, int64_t cosine)
+{
+    typedef fm_int<T> I;
+    constexpr double magic  = 0x1.8p52;
+    constexpr double pio2_1 = 1.57079632673412561417e+00;
+    constexpr double pio2_2 = 6.07710050630396597660e-11;
+    constexpr double pio2_3 = 2.02226624871116645580e-21;
+
+    const T k = x * 6.36619772367581382433e-01 + magic;
+    const I q = UTL_FM_BIT_CAST(I, k) + cosine;
+    const T n = k - magic;
+    const T a = ((x - n * pio2_1) - n * pio2_2) - n * pio2_3;
+    const T z = a * a;
+
+    const T s = a + a * z * (-1.66666666666666324348e-01 + z * (8.33333333332248946124e-03 +
+        z * (-1.98412698298579493134e-04 + z * (2.75573137070700676789e-06 +
+        z * (-2.50507602534068634195e-08 + z * 1.58969099521155010221e-10)))));
+    const T c = 1.0 - 0.5 * z + z * z * (4.16666666666666019037e-02 + z * (-1.38888888888741095749e-03 +
+        z * (2.48015872894767294178e-05 + z * (-2.75573143513906633035e-07 +
+        z * (2.08757232129817482790e-09 + z * -1.13596475577881948265e-11)))));
+    const T v = (q & 1) ? c : s;
+
+    r = (q & 2) ? -v : v;
+}
+
+/**
+ * @brief Arcsine or arccosine. Uses fdlibm rational approximation of
+ * (asin(x) - x) / x^3 on [0, 0.5], and asin(x) = pi/2 - 2 * asin(sqrt((1 - x) / 2))
+ * above. Argument must be within [-1, 1].
+ *
+ * @param x Argument
+ * @param r Result
+ * @param acos Compute arccosine
+ */
+template<class T>
+UTL_FM_INLINE void fm_asin_lanes(const T &x, T &r, bool acos)
+{
+    constexpr double pio2 = 1.57079632679489661923;
+    const T ax = x < 0.0 ? -x : x;
+    const auto big = ax > 0.5;
+    const T zb = (1.0 - ax) * 0.5;
+    T s;
+    fm_sqrt(zb, s);
+
+    const T z = big ? zb : x * x;
+    const T w = big ? s : x;
+    const T p = z * (1.66666666666666657415e-01 + z * (-3.25565818622400915405e-01 +
+        z * (2.01212532134862925881e-01 + z * (-4.00555345006794114027e-02 +
+        z * (7.91534994289814532176e-04 + z * 3.47933107596021167570e-05)))));
+    const T q = 1.0 + z * (-2.40339491173441421878e+00 + z * (2.02094576023350569471e+00 +
+        z * (-6.88283971605453293030e-01 + z * 7.70381505559019352791e-02)));
+    const T v = w + w * (p / q);
+
+    if (acos) {
+        const T b = x > 0.0 ? 2.0 * v : pio2 * 2 - 2.0 * v;
+        r = big ? b : pio2 - v;
+    } else {
+        const T b = pio2 - 2.0 * v;
+        r = big ? (x < 0.0 ? -b : b) : v;
+    }
+}
+
+/**
+ * @brief Arctangent of y / x in the correct quadrant. Ratio of smaller to
+ * larger magnitude is reduced to [-0.2, 0.66] and passed to Cephes rational
+ * approximation. Zero signs are honored as in libm, infinities aren't.
+ *
+ * @param y Ordinate
+ * @param x Abscissa
+ * @param r Result within [-pi, pi]
+ */
+template<class T>
+UTL_FM_INLINE UTL_FM_CONSTEXPR void fm_atan2_lanes(const T &y, const T &x, T &r)
+{
+    typedef fm_int<T> I;
+    constexpr double pio4 = 0.785398163397448309616;
+    const T ay = y < 0.0 ? -y : y;
+    const T ax = x < 0.0 ? -x : x;
+    const auto swap = ay > ax;
+    const T mn = swap ? ax : ay;
+    const T mx = swap ? ay : ax;
+    const auto red = mn > 0.66 * mx;
+    const T num = red ? mn - mx : mn;
+    const T den = red ? mn + mx : mx;
+    const T t = mx == 0.0 ? T{} : num / den;
+    const T z = t * t;
+
+    const T p = (((-8.750608600031904122785e-01 * z + -1.615753718733365076637e+01) * z +
+        -7.500855792314704667340e+01) * z + -1.228866684490136173410e+02) * z + -6.485021904942025371773e+01;
+    const T q = ((((z + 2.485846490142306297962e+01) * z + 1.650270098316988542046e+02) * z +
+        4.328810604912902668951e+02) * z + 4.853903996359136964868e+02) * z + 1.945506571482613964425e+02;
+    T a = t + t * z * (p / q);
+
+    a = red ? a + pio4 : a;
+    a = swap ? pio4 * 2 - a : a;
+    a = UTL_FM_BIT_CAST(I, x) < 0 ? pio4 * 4 - a : a;
+    r = UTL_FM_BIT_CAST(I, y) < 0 ? -a : a;
+}
+
+template<class T>
+UTL_FM_INLINE void fm_hypot_lanes(const T &x, const T &y, T &r)
+{
+    fm_sqrt(T(x * x + y * y), r);
+}
+
+enum class fm_op { sin, cos, asin, acos, atan2, hypot };
+
+template<fm_op Op, class T>
+UTL_FM_INLINE void fm_lanes(const T &a, const T &b, T &r)
+{
+    if constexpr (Op == fm_op::sin)
+        fm_sincos_lanes(a, r, 0);
+    else if constexpr (Op == fm_op::cos)
+        fm_sincos_lanes(a, r, 1);
+    else if constexpr (Op == fm_op::asin)
+        fm_asin_lanes(a, r, false);
+    else if constexpr (Op == fm_op::acos)
+        fm_asin_lanes(a, r, true);
+    else if constexpr (Op == fm_op::atan2)
+        fm_atan2_lanes(a, b, r);
+    else
+        fm_hypot_lanes(a, b, r);
+}
+
+/**
+ * @brief Apply kernel to arrays with vectors of type T, remainder is
+ * processed with scalars.
+ *
+ * @param a First argument array
+ * @param b Second argument array, may be null for unary functions
+ * @param dst Output array
+ * @param n Number of elements
+ */
+template<fm_op Op, class T>
+UTL_FM_INLINE void fm_batch(const double *a, const double *b, double *dst, size_t n)
+{
+    constexpr size_t w = sizeof(T) / sizeof(double);
+    size_t i = 0;
+
+    for (const size_t m = n & ~(w - 1); i < m; i += w) {
+        T va, vb = {}, vr;
+        memcpy(&va, a + i, sizeof(T));
+        if (b)
+            memcpy(&vb, b + i, sizeof(T));
+        fm_lanes<Op>(va, vb, vr);
+        memcpy(dst + i, &vr, sizeof(T));
+    }
+    for (; i < n; ++i)
+        fm_lanes<Op>(a[i], b ? b[i] : 0.0, dst[i]);
+}
+
+#ifdef UTL_FASTMATH_SIMD
+template<fm_op Op>
+__attribute__((target("avx2,fma")))
+inline void fm_batch_avx2(const double *a, const double *b, double *dst, size_t n)
+{
+    fm_batch<Op, __m256d>(a, b, dst, n);
+}
+
+template<fm_op Op>
+__attribute__((target("avx512f")))
+inline void fm_batch_avx512(const double *a, const double *b, double *dst, size_t n)
+{
+    fm_batch<Op, __m512d>(a, b, dst, n);
+}
+
+/**
+ * @brief Widest usable vector: 2 for AVX-512, 1 for AVX2 with FMA,
+ * 0 for SSE2, -1 for scalar lanes.
+ *
+ */
+inline int fm_simd_level()
+{
+    const uint32_t f = cpu_features();
+    return f & cpu_avx512f ? 2 : (f & (cpu_avx2 | cpu_fma)) == (cpu_avx2 | cpu_fma) ? 1 : f & cpu_sse2 ? 0 : -1;
+}
+#endif
+
+template<fm_op Op>
+inline void fm_dispatch(const double *a, const double *b, double *dst, size_t n)
+{
+#ifdef UTL_FASTMATH_SIMD
+    switch (fm_simd_level()) {
+    case 2:
+        return fm_batch_avx512<Op>(a, b, dst, n);
+    case 1:
+        return fm_batch_avx2<Op>(a, b, dst, n);
+    case 0:
+        return fm_batch<Op, __m128d>(a, b, dst, n);
+    }
+#endif
+    fm_batch<Op, double>(a, b, dst, n);
+}
+
+}
+
+/**
+ * @brief Fast sine. Max error is 2 ulp for |x| < 1e6, beyond that
+ * argument reduction loses precision.
+ *
+ * @param x Radians
+ * @return Sine
+ */
+UTL_FM_CONSTEXPR double fast_sin(double x)
+{
+    double r = 0;
+    impl::fm_sincos_lanes(x, r, 0);
+    return r;
+}
+
+/**
+ * @brief Fast cosine. Max error is 2 ulp for |x| < 1e6, beyond that
+ * argument reduction loses precision.
+ *
+ * @param x Radians
+ * @return Cosine
+ */
+UTL_FM_CONSTEXPR double fast_cos(double x)
+{
+    double r = 0;
+    impl::fm_sincos_lanes(x, r, 1);
+    return r;
+}
+
+/**
+ * @brief Fast arcsine, max error is 2 ulp.
+ *
+ * @param x Argument within [-1, 1]
+ * @return Radians within [-pi/2, pi/2]
+ */
+inline double fast_asin(double x)
+{
+    double r;
+    impl::fm_asin_lanes(x, r, false);
+    return r;
+}
+
+/**
+ * @brief Fast arccosine, max error is 2 ulp.
+ *
+ * @param x Argument within [-1, 1]
+ * @return Radians within [0, pi]
+ */
+inline double fast_acos(double x)
+{
+    double r;
+    impl::fm_asin_lanes(x, r, true);
+    return r;
+}
+
+/**
+ * @brief Fast arctangent of y / x, max error is 2 ulp for finite arguments.
+ *
+ * @param y Ordinate
+ * @param x Abscissa
+ * @return Radians within [-pi, pi]
+ */
+UTL_FM_CONSTEXPR double fast_atan2(double y, double x)
+{
+    double r = 0;
+    impl::fm_atan2_lanes(y, x, r);
+    return r;
+}
+
+/**
+ * @brief Euclidean norm without overflow protection of std::hypot().
+ *
+ * @return sqrt(x^2 + y^2)
+ */
+inline double fast_hypot(double x, double y)
+{
+    return std::sqrt(x * x + y * y);
+}
+
+/**
+ * @brief Euclidean norm without overflow protection of std::hypot().
+ *
+ * @return sqrt(x^2 + y^2 + z^2)
+ */
+inline double fast_hypot(double x, double y, double z)
+{
+    return std::sqrt(x * x + y * y + z * z);
+}
+
+/**
+ * @brief Batch versions of functions above. Use AVX-512 or AVX2 with FMA
+ * when CPU has them, SSE2 otherwise. Vector square root is computed with
+ * Newton iterations, which adds up to 1 ulp of error compared to scalar
+ * versions. Output may be the same array as input.
+ *
+ * @param src Input array
+ * @param dst Output array
+ * @param n Number of elements
+ */
+inline void fast_sin(const double *src, double *dst, size_t n)  { impl::fm_dispatch<impl::fm_op::sin>(src, nullptr, dst, n); }
+inline void fast_cos(const double *src, double *dst, size_t n)  { impl::fm_dispatch<impl::fm_op::cos>(src, nullptr, dst, n); }
+inline void fast_asin(const double *src, double *dst, size_t n) { impl::fm_dispatch<impl::fm_op::asin>(src, nullptr, dst, n); }
+inline void fast_acos(const double *src, double *dst, size_t n) { impl::fm_dispatch<impl::fm_op::acos>(src, nullptr, dst, n); }
+
+inline void fast_atan2(const double *y, const double *x, double *dst, size_t n)
+{
+    impl::fm_dispatch<impl::fm_op::atan2>(y, x, dst, n);
+}
+
+inline void fast_hypot(const double *x, const double *y, double *dst, size_t n)
+{
+    impl::fm_dispatch<impl::fm_op::hypot>(x, y, dst, n);
+}
+
+namespace impl {
+
+/**
+ * @brief Elementary functions selected by mode.
+ *
+ */
+template<math_mode M>
+struct math_ops {
+    static constexpr bool fast = M == math_mode::fast;
+    static double sin(double x)             { return fast ? fast_sin(x) : std::sin(x); }
+    static double cos(double x)             { return fast ? fast_cos(x) : std::cos(x); }
+    static double asin(double x)            { return fast ? fast_asin(x) : std::asin(x); }
+    static double acos(double x)            { return fast ? fast_acos(x) : std::acos(x); }
+    static double atan2(double y, double x) { return fast ? fast_atan2(y, x) : std::atan2(y, x); }
+};
+
+}
+
+}
+
+#endif
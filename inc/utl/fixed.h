@@ -0,0 +1,634 @@
+#ifndef UTL_FIXED_H
+#define UTL_FIXED_H
+
+#include "utl/float.h"
+#include "utl/math.h"
+
+namespace utl {
+
+/**
+ * @brief Rounding of fixed point results which drop fraction bits.
+ *
+ */
+enum class fx_round {
+    floor,          // Toward negative infinity, plain arithmetic shift
+    zero,           // Toward zero
+    nearest,        // To nearest, ties away from zero
+    nearest_even,   // To nearest, ties to even
+};
+
+namespace impl {
+
+/**
+ * @brief Storage of fixed point number with given byte size, together
+ * with types for intermediate products. All are signed except uwide.
+ *
+ */
+template<unsigned Bytes> struct fx_int;
+template<> struct fx_int<1> { typedef int8_t  raw; typedef int32_t wide; typedef uint32_t uwide; typedef int64_t lng; };
+template<> struct fx_int<2> { typedef int16_t raw; typedef int32_t wide; typedef uint32_t uwide; typedef int64_t lng; };
+template<> struct fx_int<4> { typedef int32_t raw; typedef int64_t wide; typedef uint64_t uwide; typedef int64_t lng; };
+#ifdef __SIZEOF_INT128__
+template<> struct fx_int<8> {
+    typedef int64_t raw;
+    __extension__ typedef __int128 wide;
+    __extension__ typedef unsigned __int128 uwide;
+    __extension__ typedef __int128 lng;
+};
+#endif
+
+template<unsigned Bits>
+using fx_int_for = fx_int<Bits <= 8 ? 1 : Bits <= 16 ? 2 : Bits <= 32 ? 4 : 8>;
+
+/**
+ * @brief Arithmetic right shift with rounding.
+ *
+ * @tparam R Rounding mode
+ * @param v Signed value
+ * @param s Shift amount, less than bit width of value
+ * @return Rounded quotient v / 2^s
+ */
+template<fx_round R, class T>
+constexpr T fx_shr(T v, unsigned s)
+{
+    if (!s)
+        return v;
+    const T half = T(1) << (s - 1);
+    switch (R) {
+    case fx_round::floor:
+        return v >> s;
+    case fx_round::zero:
+        return v < 0 ? -(-v >> s) : v >> s;
+    case fx_round::nearest:
+        return v < 0 ? -((half - v) >> s) : (v + half) >> s;
+    case fx_round::nearest_even: {
+        const T q = v >> s;
+        const T r = v - q * (T(1) << s);
+        return q + (r > half || (r == half && (q & 1)));
+    }
+    }
+    return v;
+}
+
+/**
+ * @brief Count leading zeros of 64-bit word.
+ *
+ */
+constexpr unsigned fx_cntlz(uint64_t x)
+{
+    return x >> 32 ? u32_cntlz(x >> 32) : 32 + u32_cntlz(x);
+}
+
+/**
+ * @brief Convert magnitude of fixed point number to single precision bits,
+ * rounding to nearest even or to odd. Result is always normal.
+ *
+ * @tparam Odd Round to odd, for exact subsequent rounding to half
+ * @param a Magnitude
+ * @param frac Number of fraction bits
+ * @return Single stored as uint32_t, without sign
+ */
+template<bool Odd>
+constexpr uint32_t fx_to_float(uint64_t a, unsigned frac)
+{
+    if (!a)
+        return 0;
+    const unsigned p = 63 - fx_cntlz(a);
+    const uint32_t e = p + 127 - frac;
+    uint64_t m = a << (p < 23 ? 23 - p : 0);
+
+    if (p > 23) {
+        const unsigned s = p - 23;
+        const uint64_t rem = a & ((uint64_t(1) << s) - 1);
+        const uint64_t half = uint64_t(1) << (s - 1);
+        m = a >> s;
+        if (Odd)
+            m |= rem != 0;
+        else
+            m += rem > half || (rem == half && (m & 1));
+    }
+    return (e << 23) + uint32_t(m - 0x800000);
+}
+
+/**
+ * @brief Multiplier and shift for multiplication of fixed point number
+ * by a constant, chosen for maximal precision without overflow.
+ *
+ */
+template<class L>
+struct fx_const {
+    L mul;
+    unsigned shift;
+};
+
+template<class L, class R>
+constexpr fx_const<L> fx_make_const(double k)
+{
+    const double lim = double(L(1) << (sizeof(L) * 8 - sizeof(R) * 8 - 2));
+    unsigned s = 0;
+    while (k * 2 < lim) {
+        k *= 2;
+        ++s;
+    }
+    return {L(k + 0.5), s};
+}
+
+// CORDIC angles atan(2^-i) and constants, all Q2.29 radians.
+inline constexpr int32_t fx_atan_tab[30] = {
+    0x1921fb54, 0x0ed63383, 0x07d6dd7e, 0x03fab753, 0x01ff55bb, 0x00ffeaae, 0x007ffd55, 0x003fffab,
+    0x001ffff5, 0x000fffff, 0x00080000, 0x00040000, 0x00020000, 0x00010000, 0x00008000, 0x00004000,
+    0x00002000, 0x00001000, 0x00000800, 0x00000400, 0x00000200, 0x00000100, 0x00000080, 0x00000040,
+    0x00000020, 0x00000010, 0x00000008, 0x00000004, 0x00000002, 0x00000001,
+};
+inline constexpr unsigned fx_cordic_frac    = 29;
+inline constexpr int32_t fx_cordic_gain     = 0x136e9db5;   // 1 / prod(sqrt(1 + 2^-2i))
+inline constexpr int32_t fx_cordic_pi       = 0x6487ed51;
+inline constexpr int32_t fx_cordic_pi_2     = 0x3243f6a8;
+inline constexpr int64_t fx_cordic_2pi      = 0xc90fdaa2;
+
+/**
+ * @brief CORDIC in rotation mode, rotates unit vector by given angle.
+ *
+ * @param z Angle within [-pi/2, pi/2]
+ * @param x Output cosine
+ * @param y Output sine
+ * @param n Number of iterations, one bit of precision each
+ */
+constexpr void fx_cordic_rotate(int32_t z, int32_t &x, int32_t &y, unsigned n)
+{
+    int32_t cx = fx_cordic_gain;
+    int32_t cy = 0;
+
+    for (unsigned i = 0; i < n; ++i) {
+        const int32_t d = z >> 31; // Branchless negation if z < 0
+        const int32_t dx = cx >> i;
+        const int32_t dy = cy >> i;
+        cx -= (dy ^ d) - d;
+        cy += (dx ^ d) - d;
+        z -= (fx_atan_tab[i] ^ d) - d;
+    }
+    x = cx;
+    y = cy;
+}
+
+/**
+ * @brief CORDIC in vectoring mode, rotates vector onto positive x axis.
+ *
+ * @param y Ordinate, magnitude below 2^29
+ * @param x Abscissa, magnitude below 2^29
+ * @param n Number of iterations, one bit of precision each
+ * @return Angle of vector within [-pi, pi]
+ */
+constexpr int32_t fx_cordic_vector(int32_t y, int32_t x, unsigned n)
+{
+    int32_t z = 0;
+
+    if (x < 0) {
+        z = y >= 0 ? fx_cordic_pi : -fx_cordic_pi;
+        x = -x;
+        y = -y;
+    }
+    for (unsigned i = 0; i < n; ++i) {
+        const int32_t d = -int32_t(y <= 0);
+        const int32_t dx = x >> i;
+        const int32_t dy = y >> i;
+        x += (dy ^ d) - d;
+        y -= (dx ^ d) - d;
+        z += (fx_atan_tab[i] ^ d) - d;
+    }
+    return z;
+}
+
+}
+
+/**
+ * @brief Signed fixed point number with saturating arithmetic, intended
+ * for targets without FPU. Range is [-2^IntBits, 2^IntBits), resolution
+ * is 2^-FracBits, storage is the smallest integer which fits sign and
+ * both parts. Operators saturate instead of wrapping around, products
+ * and quotients round to nearest.
+ *
+ * @tparam IntBits Number of integer bits, excluding sign
+ * @tparam FracBits Number of fraction bits
+ */
+template<unsigned IntBits, unsigned FracBits>
+struct fixed {
+private:
+    typedef impl::fx_int_for<IntBits + FracBits + 1> types;
+public:
+    static_assert(IntBits + FracBits < 64, "fixed point number is too wide");
+    static_assert(IntBits + FracBits < 32 || sizeof(typename types::raw) == 8, "64-bit fixed point requires __int128");
+
+    typedef typename types::raw raw_type;   // Storage
+    typedef typename types::wide wide_type; // Holds product of two raw values
+    typedef typename types::lng long_type;  // At least 64 bits
+
+    static constexpr unsigned int_bits  = IntBits;
+    static constexpr unsigned frac_bits = FracBits;
+    static constexpr raw_type raw_max   = raw_type((uint64_t(1) << (IntBits + FracBits)) - 1);
+    static constexpr raw_type raw_min   = -raw_max - 1;
+
+    raw_type raw = 0;
+
+    constexpr fixed() = default;
+
+    /**
+     * @brief Construct from floating point value, rounding to nearest and
+     * saturating. Intended for constants evaluated at compile time.
+     *
+     * @param v Value
+     */
+    constexpr explicit fixed(double v) : raw{from_double(v)} {}
+
+    /**
+     * @brief Construct from raw representation, i.e. value * 2^FracBits.
+     *
+     * @param r Raw value
+     * @return Fixed point number
+     */
+    static constexpr fixed from_raw(raw_type r)
+    {
+        fixed x;
+        x.raw = r;
+        return x;
+    }
+
+    /**
+     * @brief Clamp intermediate value to range of raw representation.
+     *
+     * @param v Wider signed integer
+     * @return Raw value
+     */
+    template<class W>
+    static constexpr raw_type saturate(W v)
+    {
+        return v > W(raw_max) ? raw_max : v < W(raw_min) ? raw_min : raw_type(v);
+    }
+
+    static constexpr fixed max()        { return from_raw(raw_max); }
+    static constexpr fixed min()        { return from_raw(raw_min); }
+    static constexpr fixed epsilon()    { return from_raw(1); }
+
+    /**
+     * @brief Construct from integer, saturating.
+     *
+     * @param i Integer value
+     * @return Fixed point number
+     */
+    static constexpr fixed from_int(int64_t i)
+    {
+        return from_raw(i > (raw_max >> FracBits) ? raw_max : i < (raw_min >> FracBits) ? raw_min :
+            raw_type(long_type(i) * (long_type(1) << FracBits)));
+    }
+
+    /**
+     * @brief Get integer part.
+     *
+     * @tparam R Rounding mode
+     * @return Integer
+     */
+    template<fx_round R = fx_round::floor>
+    constexpr raw_type to_int() const
+    {
+        return raw_type(impl::fx_shr<R>(long_type(raw), FracBits));
+    }
+
+    constexpr double to_double() const
+    {
+        return raw / double(long_type(1) << FracBits);
+    }
+
+    /**
+     * @brief Construct from single precision bit pattern, using only integer
+     * arithmetic. NaN gives zero, out of range values saturate.
+     *
+     * @tparam R Rounding mode
+     * @param f Single stored as uint32_t
+     * @return Fixed point number
+     */
+    template<fx_round R = fx_round::nearest>
+    static constexpr fixed from_float_bits(uint32_t f)
+    {
+        const uint32_t e = f >> 23 & 0xff;
+        const uint32_t m = (f & 0x7fffff) | (e ? 0x800000 : 0);
+        const int sh = int(e ? e : 1) - 150 + int(FracBits);
+        long_type v = f >> 31 ? -long_type(m) : long_type(m);
+
+        if (e == 0xff)
+            return from_raw(m & 0x7fffff ? 0 : v < 0 ? raw_min : raw_max);
+        if (sh >= 0)
+            return from_raw(sh >= int(IntBits + FracBits + 1) ? (!m ? 0 : v < 0 ? raw_min : raw_max) : saturate(v * (long_type(1) << sh)));
+        if (-sh > 30) // Far below resolution, only sign matters for rounding
+            return from_raw(saturate(impl::fx_shr<R>((v > 0) - (v < 0), 30)));
+        return from_raw(saturate(impl::fx_shr<R>(v, -sh)));
+    }
+
+    /**
+     * @brief Convert to single precision bit pattern, using only integer
+     * arithmetic. Rounds to nearest even.
+     *
+     * @return Single stored as uint32_t
+     */
+    constexpr uint32_t to_float_bits() const
+    {
+        return sign_bit() | impl::fx_to_float<false>(magnitude(), FracBits);
+    }
+
+    /**
+     * @brief Construct from half precision bit pattern. Conversion to single
+     * is exact, so result is rounded once.
+     *
+     * @tparam R Rounding mode
+     * @param h Half stored as uint16_t
+     * @return Fixed point number
+     */
+    template<fx_round R = fx_round::nearest>
+    static constexpr fixed from_half(uint16_t h)
+    {
+        return from_float_bits<R>(half_to_float(h));
+    }
+
+    /**
+     * @brief Convert to half precision bit pattern, rounding to nearest even
+     * once, through single rounded to odd.
+     *
+     * @tparam Mode Overflow handling
+     * @return Half stored as uint16_t
+     */
+    template<fp_mode Mode = fp_mode::nearest>
+    constexpr uint16_t to_half() const
+    {
+        return float_to_half<Mode>(sign_bit() | impl::fx_to_float<true>(magnitude(), FracBits));
+    }
+
+    static fixed from_float(float f)
+    {
+        uint32_t u;
+        memcpy(&u, &f, sizeof(u));
+        return from_float_bits(u);
+    }
+
+    float to_float() const
+    {
+        const uint32_t u = to_float_bits();
+        float f;
+        memcpy(&f, &u, sizeof(f));
+        return f;
+    }
+
+    /**
+     * @brief Saturating multiplication with given rounding.
+     *
+     * @tparam R Rounding mode
+     * @param a Multiplicand
+     * @param b Multiplier
+     * @return Product
+     */
+    template<fx_round R = fx_round::nearest>
+    static constexpr fixed mul(fixed a, fixed b)
+    {
+        return from_raw(saturate(impl::fx_shr<R>(wide_type(a.raw) * b.raw, FracBits)));
+    }
+
+    /**
+     * @brief Saturating division, rounding to nearest. Division by zero
+     * saturates to the sign of dividend.
+     *
+     * @param a Dividend
+     * @param b Divisor
+     * @return Quotient
+     */
+    static constexpr fixed div(fixed a, fixed b)
+    {
+        if (!b.raw)
+            return a.raw < 0 ? min() : max();
+        const wide_type n = wide_type(a.raw) * (wide_type(1) << FracBits);
+        const wide_type q = n / b.raw;
+        const wide_type r = n % b.raw;
+        const wide_type ar = r < 0 ? -r : r;
+        const wide_type ab = b.raw < 0 ? -wide_type(b.raw) : wide_type(b.raw);
+        return from_raw(saturate(ar >= ab - ar ? ((n < 0) != (b.raw < 0) ? q - 1 : q + 1) : q));
+    }
+
+    constexpr fixed operator-() const                   { return from_raw(saturate(-wide_type(raw))); }
+    constexpr fixed operator+() const                   { return *this; }
+    constexpr fixed& operator+=(fixed b)                { return *this = *this + b; }
+    constexpr fixed& operator-=(fixed b)                { return *this = *this - b; }
+    constexpr fixed& operator*=(fixed b)                { return *this = *this * b; }
+    constexpr fixed& operator/=(fixed b)                { return *this = *this / b; }
+
+    friend constexpr fixed operator+(fixed a, fixed b)  { return from_raw(saturate(wide_type(a.raw) + b.raw)); }
+    friend constexpr fixed operator-(fixed a, fixed b)  { return from_raw(saturate(wide_type(a.raw) - b.raw)); }
+    friend constexpr fixed operator*(fixed a, fixed b)  { return mul(a, b); }
+    friend constexpr fixed operator/(fixed a, fixed b)  { return div(a, b); }
+    friend constexpr bool operator==(fixed a, fixed b)  { return a.raw == b.raw; }
+    friend constexpr bool operator!=(fixed a, fixed b)  { return a.raw != b.raw; }
+    friend constexpr bool operator<(fixed a, fixed b)   { return a.raw < b.raw; }
+    friend constexpr bool operator<=(fixed a, fixed b)  { return a.raw <= b.raw; }
+    friend constexpr bool operator>(fixed a, fixed b)   { return a.raw > b.raw; }
+    friend constexpr bool operator>=(fixed a, fixed b)  { return a.raw >= b.raw; }
+
+    /**
+     * @brief Sine and cosine by CORDIC, one iteration per result bit up to
+     * 30. Error is within 1 ulp up to 16 fraction bits and bottoms out near
+     * 2^-25 due to Q2.29 internal format. Argument is reduced with 2^-30
+     * precise 2pi, so error also grows with its magnitude. Found by
+     * argument-dependent lookup.
+     *
+     * @param a Angle in radians
+     * @param s Output sine
+     * @param c Output cosine
+     */
+    friend constexpr void sincos(fixed a, fixed &s, fixed &c)
+    {
+        long_type z = FracBits > impl::fx_cordic_frac ?
+            impl::fx_shr<fx_round::nearest>(long_type(a.raw), FracBits - impl::fx_cordic_frac) :
+            long_type(a.raw) * (long_type(1) << (impl::fx_cordic_frac - FracBits));
+        bool flip = false;
+        int32_t x = 0;
+        int32_t y = 0;
+
+        if (z > impl::fx_cordic_pi || z < -impl::fx_cordic_pi) { // Avoid 64-bit division if possible
+            z %= impl::fx_cordic_2pi;
+            if (z > impl::fx_cordic_pi)
+                z -= impl::fx_cordic_2pi;
+            else if (z < -impl::fx_cordic_pi)
+                z += impl::fx_cordic_2pi;
+        }
+        if (z > impl::fx_cordic_pi_2) {
+            z = impl::fx_cordic_pi - z;
+            flip = true;
+        } else if (z < -impl::fx_cordic_pi_2) {
+            z = -impl::fx_cordic_pi - z;
+            flip = true;
+        }
+        impl::fx_cordic_rotate(int32_t(z), x, y, cordic_iters);
+        s = from_cordic(y);
+        c = from_cordic(flip ? -x : x);
+    }
+
+    friend constexpr fixed sin(fixed a)
+    {
+        fixed s, c;
+        sincos(a, s, c);
+        return s;
+    }
+
+    friend constexpr fixed cos(fixed a)
+    {
+        fixed s, c;
+        sincos(a, s, c);
+        return c;
+    }
+
+    /**
+     * @brief Angle of vector by CORDIC, same precision as sincos().
+     * Found by argument-dependent lookup.
+     *
+     * @param y Ordinate
+     * @param x Abscissa
+     * @return Angle in radians within [-pi, pi], saturated if IntBits < 2,
+     * zero for zero vector
+     */
+    friend constexpr fixed atan2(fixed y, fixed x)
+    {
+        int64_t ly = y.raw;
+        int64_t lx = x.raw;
+        const uint64_t ay = ly < 0 ? -uint64_t(ly) : ly;
+        const uint64_t ax = lx < 0 ? -uint64_t(lx) : lx;
+
+        if (!(ay | ax))
+            return fixed{};
+
+        const unsigned p = 63 - impl::fx_cntlz(ay | ax);
+
+        if (p > 27) {
+            ly >>= p - 27;
+            lx >>= p - 27;
+        } else {
+            ly *= int64_t(1) << (27 - p);
+            lx *= int64_t(1) << (27 - p);
+        }
+        return from_cordic(impl::fx_cordic_vector(int32_t(ly), int32_t(lx), cordic_iters));
+    }
+private:
+    static constexpr unsigned cordic_iters = FracBits + 2 < 30 ? FracBits + 2 : 30;
+
+    static constexpr raw_type from_double(double v)
+    {
+        v *= double(long_type(1) << FracBits);
+        return v != v ? 0 : v >= double(raw_max) ? raw_max : v <= double(raw_min) ? raw_min :
+            raw_type(v < 0 ? v - 0.5 : v + 0.5);
+    }
+
+    static constexpr fixed from_cordic(int32_t v)
+    {
+        return from_raw(saturate(FracBits > impl::fx_cordic_frac ?
+            long_type(v) * (long_type(1) << (FracBits - impl::fx_cordic_frac)) :
+            impl::fx_shr<fx_round::nearest>(long_type(v), impl::fx_cordic_frac - FracBits)));
+    }
+
+    constexpr uint32_t sign_bit() const
+    {
+        return raw < 0 ? 0x80000000 : 0;
+    }
+
+    constexpr uint64_t magnitude() const
+    {
+        return raw < 0 ? -uint64_t(raw) : uint64_t(raw);
+    }
+};
+
+/**
+ * @brief Convert fixed point number to another format.
+ *
+ * @tparam To Target fixed type
+ * @tparam R Rounding mode, if fraction bits are dropped
+ * @param x Source
+ * @return Converted value, saturated
+ */
+template<class To, fx_round R = fx_round::nearest, unsigned I, unsigned F>
+constexpr To fixed_cast(fixed<I, F> x)
+{
+    if constexpr (To::frac_bits < F) {
+        return To::from_raw(To::saturate(impl::fx_shr<R>(typename fixed<I, F>::long_type(x.raw), F - To::frac_bits)));
+    } else {
+        constexpr unsigned d = To::frac_bits - F;
+        if constexpr (d >= sizeof(typename To::raw_type) * 8)
+            return To::from_raw(x.raw > 0 ? To::raw_max : x.raw < 0 ? To::raw_min : 0);
+        else if (x.raw > (To::raw_max >> d))
+            return To::max();
+        else if (x.raw < (To::raw_min >> d))
+            return To::min();
+        else
+            return To::from_raw(typename To::raw_type(typename To::long_type(x.raw) * (typename To::long_type(1) << d)));
+    }
+}
+
+/**
+ * @brief Map fixed point number from one range to another without
+ * floating point, rounding to nearest and saturating.
+ *
+ * @param val Input value
+ * @param in_min Input minimum
+ * @param in_max Input maximum, must differ from minimum
+ * @param out_min Output range minimum
+ * @param out_max Output range maximum
+ * @return Result
+ */
+template<unsigned I, unsigned F>
+constexpr fixed<I, F> imap(fixed<I, F> val, fixed<I, F> in_min, fixed<I, F> in_max, fixed<I, F> out_min, fixed<I, F> out_max)
+{
+    typedef fixed<I, F> fx;
+    typedef typename fx::wide_type W;
+    typedef typename impl::fx_int_for<I + F + 1>::uwide U;
+
+    const W dv = W(val.raw) - in_min.raw;
+    const W dout = W(out_max.raw) - out_min.raw;
+    const W din = W(in_max.raw) - in_min.raw;
+    if (!din)
+        return out_min;
+
+    const bool neg = ((dv < 0) != (dout < 0)) != (din < 0);
+    const U n = U(dv < 0 ? -dv : dv) * U(dout < 0 ? -dout : dout);
+    const U d = U(din < 0 ? -din : din);
+    const U lim = U(1) << (I + F + 1);
+    U q = n / d + (n % d >= d - n % d);
+    q = q > lim ? lim : q;
+
+    return fx::from_raw(fx::saturate(W(out_min.raw) + (neg ? -W(q) : W(q))));
+}
+
+/**
+ * @brief Convert decimal degrees to radians, multiplying by the
+ * constant in integer arithmetic.
+ *
+ * @param deg Decimal degrees
+ * @return Radians, saturated
+ */
+template<unsigned I, unsigned F>
+constexpr fixed<I, F> radians(fixed<I, F> deg)
+{
+    typedef fixed<I, F> fx;
+    constexpr auto k = impl::fx_make_const<typename fx::long_type, typename fx::raw_type>(impl::pi / 180.0);
+    return fx::from_raw(fx::saturate(impl::fx_shr<fx_round::nearest>(typename fx::long_type(deg.raw) * k.mul, k.shift)));
+}
+
+/**
+ * @brief Convert radians to decimal degrees, multiplying by the
+ * constant in integer arithmetic.
+ *
+ * @param rad Radians
+ * @return Decimal degrees, saturated
+ */
+template<unsigned I, unsigned F>
+constexpr fixed<I, F> degrees(fixed<I, F> rad)
+{
+    typedef fixed<I, F> fx;
+    constexpr auto k = impl::fx_make_const<typename fx::long_type, typename fx::raw_type>(180.0 / impl::pi);
+    return fx::from_raw(fx::saturate(impl::fx_shr<fx_round::nearest>(typename fx::long_type(rad.raw) * k.mul, k.shift)));
+}
+
+}
+
+#endif
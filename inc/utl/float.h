@@ -1,23 +1,29 @@
 #ifndef UTL_FLOAT_H
 #define UTL_FLOAT_H
 
-#include "utl/base.h"
+#include "utl/cpu.h"
+#include <cstring>
+#ifdef UTL_CPU_DISPATCH
+#define UTL_F16C 1
+#endif
 
 namespace utl {
 namespace impl {
 
-constexpr uint32_t u32_dec(uint32_t a)              { return a - 1; }
-constexpr uint32_t u32_inc(uint32_t a)              { return a + 1; }
-constexpr uint32_t u32_not(uint32_t a)              { return ~a; }
-constexpr uint32_t u32_neg(uint32_t a)              { return -a; }
-constexpr uint32_t u32_ext(uint32_t a)              { return ((int32_t) a) >> 31; }
-constexpr uint32_t u32_or(uint32_t a, uint32_t b)   { return a | b; }
-constexpr uint32_t u32_add(uint32_t a, uint32_t b)  { return a + b; }
-constexpr uint32_t u32_sub(uint32_t a, uint32_t b)  { return a - b; }
-constexpr uint32_t u32_and(uint32_t a, uint32_t b)  { return a & b; }
-constexpr uint32_t u32_andc(uint32_t a, uint32_t b) { return a & ~b; }
-constexpr uint32_t u32_srl(uint32_t a, int sa)      { return a >> sa; }
-constexpr uint32_t u32_sll(uint32_t a, int sa)      { return a << sa; }
+// Operations are generic over lane type, so the same chains work on both
+// uint32_t and vectors of it (GCC/Clang vector extensions).
+template<class T> constexpr T u32_dec(T a)                      { return a - 1; }
+template<class T> constexpr T u32_inc(T a)                      { return a + 1; }
+template<class T> constexpr T u32_not(T a)                      { return ~a; }
+template<class T> constexpr T u32_neg(T a)                      { return T{} - a; }
+template<class T> constexpr T u32_ext(T a)                      { return T{} - (a >> 31); }
+template<class T, class U> constexpr auto u32_or(T a, U b)      { return a | b; }
+template<class T, class U> constexpr auto u32_add(T a, U b)     { return a + b; }
+template<class T, class U> constexpr auto u32_sub(T a, U b)     { return a - b; }
+template<class T, class U> constexpr auto u32_and(T a, U b)     { return a & b; }
+template<class T, class U> constexpr auto u32_andc(T a, U b)    { return a & ~b; }
+template<class T, class U> constexpr auto u32_srl(T a, U sa)    { return a >> sa; }
+template<class T, class U> constexpr auto u32_sll(T a, U sa)    { return a << sa; }
 
 /**
  * @brief Select on Sign bit
@@ -27,12 +33,34 @@ constexpr uint32_t u32_sll(uint32_t a, int sa)      { return a << sa; }
  * @param b Select on positive
  * @return Selected value 
  */
-constexpr uint32_t u32_sels(uint32_t test, uint32_t a, uint32_t b)
+template<class T, class A, class B>
+constexpr T u32_sels(T test, A a, B b)
 {
-    const uint32_t mask     = u32_ext(test);
-    const uint32_t sel_a    = u32_and(a, mask);
-    const uint32_t sel_b    = u32_andc(b, mask);
-    const uint32_t result   = u32_or(sel_a, sel_b);
+    const T mask    = u32_ext(test);
+    const T sel_a   = u32_and(a, mask);
+    const T sel_b   = u32_andc(b, mask);
+    const T result  = u32_or(sel_a, sel_b);
+
+    return result;
+}
+
+template<class T> constexpr T u64_ext(T a)                      { return T{} - (a >> 63); }
+
+/**
+ * @brief Select on Sign bit of 64-bit lanes
+ * 
+ * @param test Value to check sign bit
+ * @param a Select on negative
+ * @param b Select on positive
+ * @return Selected value 
+ */
+template<class T, class A, class B>
+constexpr T u64_sels(T test, A a, B b)
+{
+    const T mask    = u64_ext(test);
+    const T sel_a   = u32_and(a, mask);
+    const T sel_b   = u32_andc(b, mask);
+    const T result  = u32_or(sel_a, sel_b);
 
     return result;
 }
@@ -82,144 +110,248 @@ union Float {
     double      f64;
 };
 
+
 /**
- * @brief Convert single precision floating point to half precision.
+ * @brief Rounding of narrowing conversions. Both modes round to nearest,
+ * ties to even, and differ only in handling of values out of range.
  * 
- * @param f Single stored as uint32_t
- * @return Half stored as uint16_t
  */
-constexpr uint16_t float_to_half(uint32_t f)
-{
-    using namespace impl;
+enum class fp_mode {
+    nearest,    // Overflow gives infinity, or NaN for formats without it
+    saturate,   // Overflow and infinity give largest finite value
+};
+
+namespace impl {
 
+/**
+ * @brief Convert single precision floating point to a narrower format with
+ * sign, E exponent and M mantissa bits, rounding to nearest even. Denormal
+ * results are built with constant shifts selected by exponent, as there are
+ * no per-lane variable shifts in SSE2, so the chain vectorizes well.
+ * 
+ * @tparam E Exponent bits
+ * @tparam M Mantissa bits, at most 10
+ * @tparam Inf Format has infinities, otherwise only all ones is NaN
+ * @tparam Mode Overflow handling
+ * @param f Single stored as uint32_t, or vector of them
+ * @return Narrow value in low bits
+ */
+template<unsigned E, unsigned M, bool Inf, fp_mode Mode, class U>
+constexpr U float_to_mini_lanes(U f)
+{
     constexpr uint32_t one                      = 0x00000001;
     constexpr uint32_t f_s_mask                 = 0x80000000;
-    constexpr uint32_t f_e_mask                 = 0x7f800000;
     constexpr uint32_t f_m_mask                 = 0x007fffff;
     constexpr uint32_t f_m_hidden_bit           = 0x00800000;
-    constexpr uint32_t f_m_round_bit            = 0x00001000;
-    constexpr uint32_t f_snan_mask              = 0x7fc00000;
     constexpr uint32_t f_e_pos                  = 0x00000017;
-    constexpr uint32_t h_e_pos                  = 0x0000000a;
-    constexpr uint32_t h_e_mask                 = 0x00007c00;
-    constexpr uint32_t h_snan_mask              = 0x00007e00;
-    constexpr uint32_t h_e_mask_value           = 0x0000001f;
-    constexpr uint32_t f_h_s_pos_offset         = 0x00000010;
-    constexpr uint32_t f_h_bias_offset          = 0x00000070;
-    constexpr uint32_t f_h_m_pos_offset         = 0x0000000d;
-    constexpr uint32_t h_nan_min                = 0x00007c01;
-    constexpr uint32_t f_h_e_biased_flag        = 0x0000008f;
-    const uint32_t f_s                          = u32_and(f, f_s_mask);
-    const uint32_t f_e                          = u32_and(f, f_e_mask);
-    const uint16_t h_s                          = u32_srl(f_s, f_h_s_pos_offset);
-    const uint32_t f_m                          = u32_and(f, f_m_mask);
-    const uint16_t f_e_amount                   = u32_srl(f_e, f_e_pos);
-    const uint32_t f_e_half_bias                = u32_sub(f_e_amount, f_h_bias_offset);
-    const uint32_t f_snan                       = u32_and(f, f_snan_mask);
-    const uint32_t f_m_round_mask               = u32_and(f_m, f_m_round_bit);
-    const uint32_t f_m_round_offset             = u32_sll(f_m_round_mask, one);
-    const uint32_t f_m_rounded                  = u32_add(f_m, f_m_round_offset);
-    const uint32_t f_m_denorm_sa                = u32_sub(one, f_e_half_bias);
-    const uint32_t f_m_with_hidden              = u32_or(f_m_rounded, f_m_hidden_bit);
-    const uint32_t f_m_denorm                   = u32_srl(f_m_with_hidden, f_m_denorm_sa);
-    const uint32_t h_m_denorm                   = u32_srl(f_m_denorm, f_h_m_pos_offset);
-    const uint32_t f_m_rounded_overflow         = u32_and(f_m_rounded, f_m_hidden_bit);
-    const uint32_t m_nan                        = u32_srl(f_m, f_h_m_pos_offset);
-    const uint32_t h_em_nan                     = u32_or(h_e_mask, m_nan);
-    const uint32_t h_e_norm_overflow_offset     = u32_inc(f_e_half_bias);
-    const uint32_t h_e_norm_overflow            = u32_sll(h_e_norm_overflow_offset, h_e_pos);
-    const uint32_t h_e_norm                     = u32_sll(f_e_half_bias, h_e_pos);
-    const uint32_t h_m_norm                     = u32_srl(f_m_rounded, f_h_m_pos_offset);
-    const uint32_t h_em_norm                    = u32_or(h_e_norm, h_m_norm);
-    const uint32_t is_h_ndenorm_msb             = u32_sub(f_h_bias_offset, f_e_amount);
-    const uint32_t is_f_e_flagged_msb           = u32_sub(f_h_e_biased_flag, f_e_half_bias);
-    const uint32_t is_h_denorm_msb              = u32_not(is_h_ndenorm_msb);
-    const uint32_t is_f_m_eqz_msb               = u32_dec(f_m);
-    const uint32_t is_h_nan_eqz_msb             = u32_dec(m_nan);
-    const uint32_t is_f_inf_msb                 = u32_and(is_f_e_flagged_msb, is_f_m_eqz_msb);
-    const uint32_t is_f_nan_underflow_msb       = u32_and(is_f_e_flagged_msb, is_h_nan_eqz_msb);
-    const uint32_t is_e_overflow_msb            = u32_sub(h_e_mask_value, f_e_half_bias);
-    const uint32_t is_h_inf_msb                 = u32_or(is_e_overflow_msb, is_f_inf_msb);
-    const uint32_t is_f_nsnan_msb               = u32_sub(f_snan, f_snan_mask);
-    const uint32_t is_m_norm_overflow_msb       = u32_neg(f_m_rounded_overflow);
-    const uint32_t is_f_snan_msb                = u32_not(is_f_nsnan_msb);
-    const uint32_t h_em_overflow_result         = u32_sels(is_m_norm_overflow_msb, h_e_norm_overflow, h_em_norm);
-    const uint32_t h_em_nan_result              = u32_sels(is_f_e_flagged_msb, h_em_nan, h_em_overflow_result);
-    const uint32_t h_em_nan_underflow_result    = u32_sels(is_f_nan_underflow_msb, h_nan_min, h_em_nan_result);
-    const uint32_t h_em_inf_result              = u32_sels(is_h_inf_msb, h_e_mask, h_em_nan_underflow_result);
-    const uint32_t h_em_denorm_result           = u32_sels(is_h_denorm_msb, h_m_denorm, h_em_inf_result);
-    const uint32_t h_em_snan_result             = u32_sels(is_f_snan_msb, h_snan_mask, h_em_denorm_result);
-    const uint32_t h_result                     = u32_or(h_s, h_em_snan_result);
+    constexpr uint32_t f_inf                    = 0x7f800000;
+    constexpr uint32_t f_m_sticky_mask          = 0x0000000f;
+    constexpr uint32_t f_m_sticky_pos           = 0x00000004;
+    constexpr uint32_t f_h_denorm_round         = 0x000fffff;
+    constexpr uint32_t f_h_denorm_pos           = 0x00000015;
+    constexpr uint32_t h_bias                   = (one << (E - 1)) - 1;
+    constexpr uint32_t h_e_mask                 = ((one << E) - 1) << M;
+    constexpr uint32_t h_m_mask                 = (one << M) - 1;
+    constexpr uint32_t h_max                    = Inf ? h_e_mask - 1 : h_e_mask | (h_m_mask - 1);
+    constexpr uint32_t h_nan                    = Inf ? h_e_mask | (one << (M - 1)) : h_e_mask | h_m_mask;
+    constexpr uint32_t h_overflow               = Mode == fp_mode::saturate ? h_max : Inf ? h_e_mask : h_nan;
+    constexpr uint32_t f_h_s_pos_offset         = 31 - E - M;
+    constexpr uint32_t f_h_m_pos_offset         = 23 - M;
+    constexpr uint32_t f_h_bias_offset          = (127 - h_bias) << f_e_pos;
+    constexpr uint32_t f_h_round                = (one << (f_h_m_pos_offset - 1)) - 1;
+    constexpr uint32_t f_h_overflow_min         = (h_max << f_h_m_pos_offset) + f_h_bias_offset + f_h_round + 1 + (~h_max & one);
+    constexpr uint32_t f_h_norm_min             = (128 - h_bias) << f_e_pos;
+    constexpr uint32_t f_h_denorm_e_bias        = 126 - h_bias - M;
+    const U f_s                                 = u32_and(f, f_s_mask);
+    const U f_em                                = u32_andc(f, f_s_mask);
+    const U h_s                                 = u32_srl(f_s, f_h_s_pos_offset);
+    const U f_m                                 = u32_and(f, f_m_mask);
+    const U f_e_amount                          = u32_srl(f_em, f_e_pos);
+    const U f_m_lsb                             = u32_and(u32_srl(f_em, f_h_m_pos_offset), one);
+    const U f_em_rebiased                       = u32_sub(f_em, f_h_bias_offset);
+    const U f_em_rounded                        = u32_add(u32_add(f_em_rebiased, f_h_round), f_m_lsb);
+    const U h_em_norm                           = u32_srl(f_em_rounded, f_h_m_pos_offset);
+    // Denormal: mantissa with low bits folded into sticky bit is shifted left
+    // by (f_e - f_h_denorm_e_bias) in [0, M + 1], then rounded at bit 21
+    const U f_m_with_hidden                     = u32_or(f_m, f_m_hidden_bit);
+    const U f_m_sticky                          = u32_srl(u32_add(u32_and(f_m_with_hidden, f_m_sticky_mask), f_m_sticky_mask), f_m_sticky_pos);
+    const U f_m_denorm                          = u32_or(u32_srl(f_m_with_hidden, f_m_sticky_pos), f_m_sticky);
+    const U f_m_denorm_sa_raw                   = u32_sub(f_e_amount, f_h_denorm_e_bias);
+    const U f_m_denorm_sa                       = u32_sels(f_m_denorm_sa_raw, 0, f_m_denorm_sa_raw);
+    const U f_m_denorm_8                        = u32_sels(u32_sll(f_m_denorm_sa, 28), u32_sll(f_m_denorm, 8), f_m_denorm);
+    const U f_m_denorm_4                        = u32_sels(u32_sll(f_m_denorm_sa, 29), u32_sll(f_m_denorm_8, 4), f_m_denorm_8);
+    const U f_m_denorm_2                        = u32_sels(u32_sll(f_m_denorm_sa, 30), u32_sll(f_m_denorm_4, 2), f_m_denorm_4);
+    const U f_m_denorm_1                        = u32_sels(u32_sll(f_m_denorm_sa, 31), u32_sll(f_m_denorm_2, 1), f_m_denorm_2);
+    const U f_m_denorm_lsb                      = u32_and(u32_srl(f_m_denorm_1, f_h_denorm_pos), one);
+    const U f_m_denorm_rounded                  = u32_add(u32_add(f_m_denorm_1, f_h_denorm_round), f_m_denorm_lsb);
+    const U h_m_denorm                          = u32_srl(f_m_denorm_rounded, f_h_denorm_pos);
+    const U h_em_nan                            = u32_or(h_nan, u32_srl(f_m, f_h_m_pos_offset));
+    const U is_h_denorm_msb                     = u32_sub(f_em, f_h_norm_min);
+    const U is_h_overflow_msb                   = u32_sub(f_h_overflow_min - 1, f_em);
+    const U is_f_nan_msb                        = u32_sub(f_inf, f_em);
+    // Formats with float exponent range (bfloat16) need no denormal path
+    const U h_em_denorm_result                  = h_bias < 127 ? u32_sels(is_h_denorm_msb, h_m_denorm, h_em_norm) : h_em_norm;
+    const U h_em_overflow_result                = u32_sels(is_h_overflow_msb, h_overflow, h_em_denorm_result);
+    const U h_em_nan_result                     = u32_sels(is_f_nan_msb, h_em_nan, h_em_overflow_result);
+    const U h_result                            = u32_or(h_s, h_em_nan_result);
 
     return h_result;
 }
 
 /**
- * @brief Convert half precision floating point to single precision.
+ * @brief Convert narrow floating point format to single precision. Conversion
+ * is exact, NaN is quieted. Denormals are normalized with constant shifts.
  * 
- * @param h Half stored as uint16_t
+ * @tparam E Exponent bits
+ * @tparam M Mantissa bits, at most 15
+ * @tparam Inf Format has infinities, otherwise only all ones is NaN
+ * @param h Narrow value stored in uint32_t, or vector of them
  * @return Single stored as uint32_t
  */
-constexpr uint32_t half_to_float(uint16_t h)
+template<unsigned E, unsigned M, bool Inf, class U>
+constexpr U mini_to_float_lanes(U h)
 {
-    using namespace impl;
-
-    constexpr uint32_t h_e_mask             = 0x00007c00;
-    constexpr uint32_t h_m_mask             = 0x000003ff;
-    constexpr uint32_t h_s_mask             = 0x00008000;
-    constexpr uint32_t h_f_s_pos_offset     = 0x00000010;
-    constexpr uint32_t h_f_e_pos_offset     = 0x0000000d;
-    constexpr uint32_t h_f_bias_offset      = 0x0001c000;
+    constexpr uint32_t one                  = 0x00000001;
     constexpr uint32_t f_e_mask             = 0x7f800000;
     constexpr uint32_t f_m_mask             = 0x007fffff;
-    constexpr uint32_t h_f_e_denorm_bias    = 0x0000007e;
-    constexpr uint32_t h_f_m_denorm_sa_bias = 0x00000008;
+    constexpr uint32_t f_qnan_bit           = 0x00400000;
     constexpr uint32_t f_e_pos              = 0x00000017;
-    constexpr uint32_t h_e_mask_minus_one   = 0x00007bff;
-    const uint32_t h_e                      = u32_and(h, h_e_mask);
-    const uint32_t h_m                      = u32_and(h, h_m_mask);
-    const uint32_t h_s                      = u32_and(h, h_s_mask);
-    const uint32_t h_e_f_bias               = u32_add(h_e, h_f_bias_offset);
-    const uint32_t h_m_nlz                  = u32_cntlz(h_m);
-    const uint32_t f_s                      = u32_sll(h_s, h_f_s_pos_offset);
-    const uint32_t f_e                      = u32_sll(h_e_f_bias, h_f_e_pos_offset);
-    const uint32_t f_m                      = u32_sll(h_m, h_f_e_pos_offset);
-    const uint32_t f_em                     = u32_or(f_e, f_m);
-    const uint32_t h_f_m_sa                 = u32_sub(h_m_nlz, h_f_m_denorm_sa_bias);
-    const uint32_t f_e_denorm_unpacked      = u32_sub(h_f_e_denorm_bias, h_f_m_sa);
-    const uint32_t h_f_m                    = u32_sll(h_m, h_f_m_sa);
-    const uint32_t f_m_denorm               = u32_and(h_f_m, f_m_mask);
-    const uint32_t f_e_denorm               = u32_sll(f_e_denorm_unpacked, f_e_pos);
-    const uint32_t f_em_denorm              = u32_or(f_e_denorm, f_m_denorm);
-    const uint32_t f_em_nan                 = u32_or(f_e_mask, f_m);
-    const uint32_t is_e_eqz_msb             = u32_dec(h_e);
-    const uint32_t is_m_nez_msb             = u32_neg(h_m);
-    const uint32_t is_e_flagged_msb         = u32_sub(h_e_mask_minus_one, h_e);
-    const uint32_t is_zero_msb              = u32_andc(is_e_eqz_msb, is_m_nez_msb);
-    const uint32_t is_inf_msb               = u32_andc(is_e_flagged_msb, is_m_nez_msb);
-    const uint32_t is_denorm_msb            = u32_and(is_m_nez_msb, is_e_eqz_msb);
-    const uint32_t is_nan_msb               = u32_and(is_e_flagged_msb, is_m_nez_msb); 
-    const uint32_t is_zero                  = u32_ext(is_zero_msb);
-    const uint32_t f_zero_result            = u32_andc(f_em, is_zero);
-    const uint32_t f_denorm_result          = u32_sels(is_denorm_msb, f_em_denorm, f_zero_result);
-    const uint32_t f_inf_result             = u32_sels(is_inf_msb, f_e_mask, f_denorm_result);
-    const uint32_t f_nan_result             = u32_sels(is_nan_msb, f_em_nan, f_inf_result);
-    const uint32_t f_result                 = u32_or(f_s, f_nan_result);
+    constexpr uint32_t h_bias               = (one << (E - 1)) - 1;
+    constexpr uint32_t h_e_mask             = ((one << E) - 1) << M;
+    constexpr uint32_t h_m_mask             = (one << M) - 1;
+    constexpr uint32_t h_s_mask             = one << (E + M);
+    constexpr uint32_t h_nan_min            = Inf ? h_e_mask | one : h_e_mask | h_m_mask;
+    constexpr uint32_t h_f_s_pos_offset     = 31 - E - M;
+    constexpr uint32_t h_f_m_pos_offset     = 23 - M;
+    constexpr uint32_t h_f_bias_offset      = (127 - h_bias) << f_e_pos;
+    constexpr uint32_t h_f_e_denorm_bias    = 128 - h_bias;
+    constexpr uint32_t h_m_top_8            = M >= 8 ? one << (M - 7) : 0;
+    constexpr uint32_t h_m_top_4            = M >= 4 ? one << (M - 3) : 0;
+    constexpr uint32_t h_m_top_2            = M >= 2 ? one << (M - 1) : 0;
+    constexpr uint32_t h_m_top_1            = one << M;
+    const U h_e                             = u32_and(h, h_e_mask);
+    const U h_m                             = u32_and(h, h_m_mask);
+    const U h_s                             = u32_and(h, h_s_mask);
+    const U h_em                            = u32_or(h_e, h_m);
+    const U f_s                             = u32_sll(h_s, h_f_s_pos_offset);
+    const U f_em                            = u32_add(u32_sll(h_em, h_f_m_pos_offset), h_f_bias_offset);
+    // Normalize denormal mantissa by binary search of its top bit
+    const U h_m_test_8                      = u32_sub(h_m, h_m_top_8);
+    const U h_m_norm_8                      = u32_sels(h_m_test_8, u32_sll(h_m, 8), h_m);
+    const U h_m_test_4                      = u32_sub(h_m_norm_8, h_m_top_4);
+    const U h_m_norm_4                      = u32_sels(h_m_test_4, u32_sll(h_m_norm_8, 4), h_m_norm_8);
+    const U h_m_test_2                      = u32_sub(h_m_norm_4, h_m_top_2);
+    const U h_m_norm_2                      = u32_sels(h_m_test_2, u32_sll(h_m_norm_4, 2), h_m_norm_4);
+    const U h_m_test_1                      = u32_sub(h_m_norm_2, h_m_top_1);
+    const U h_m_norm                        = u32_sels(h_m_test_1, u32_sll(h_m_norm_2, 1), h_m_norm_2);
+    const U h_f_m_sa_hi                     = u32_add(u32_and(u32_ext(h_m_test_8), 8), u32_and(u32_ext(h_m_test_4), 4));
+    const U h_f_m_sa_lo                     = u32_add(u32_and(u32_ext(h_m_test_2), 2), u32_and(u32_ext(h_m_test_1), 1));
+    const U h_f_m_sa                        = u32_add(h_f_m_sa_hi, h_f_m_sa_lo);
+    const U f_e_denorm                      = u32_sll(u32_sub(h_f_e_denorm_bias, h_f_m_sa), f_e_pos);
+    const U f_m_denorm                      = u32_and(u32_sll(h_m_norm, h_f_m_pos_offset), f_m_mask);
+    const U f_em_denorm                     = u32_or(f_e_denorm, f_m_denorm);
+    const U f_em_nan                        = u32_or(u32_or(f_e_mask, f_qnan_bit), u32_sll(h_m, h_f_m_pos_offset));
+    const U is_e_eqz_msb                    = u32_dec(h_e);
+    const U is_m_nez_msb                    = u32_neg(h_m);
+    const U is_nan_msb                      = u32_sub(h_nan_min - 1, h_em);
+    const U is_e_flagged_msb                = u32_sub(h_e_mask - 1, h_em);
+    const U is_zero_msb                     = u32_andc(is_e_eqz_msb, is_m_nez_msb);
+    // Formats with float exponent range (bfloat16) map denormals directly
+    const U is_denorm_msb                   = h_bias < 127 ? u32_and(is_m_nez_msb, is_e_eqz_msb) : U{};
+    const U is_inf_msb                      = Inf ? u32_andc(is_e_flagged_msb, is_nan_msb) : U{};
+    const U is_zero                         = u32_ext(is_zero_msb);
+    const U f_zero_result                   = u32_andc(f_em, is_zero);
+    const U f_denorm_result                 = u32_sels(is_denorm_msb, f_em_denorm, f_zero_result);
+    const U f_inf_result                    = u32_sels(is_inf_msb, f_e_mask, f_denorm_result);
+    const U f_nan_result                    = u32_sels(is_nan_msb, f_em_nan, f_inf_result);
+    const U f_result                        = u32_or(f_s, f_nan_result);
+
+    return f_result;
+}
+
+/**
+ * @brief Narrow double precision to single precision rounding to odd, i.e.
+ * truncating and setting lowest bit if any discarded bit was set. Rounding
+ * the result once more to a format at least 2 bits shorter is then the same
+ * as rounding the double directly. Values out of float range are flushed to
+ * zero or infinity, which narrower formats can't distinguish anyway.
+ * 
+ * @param d Double stored as uint64_t, or vector of them
+ * @return Single stored in low bits of uint64_t
+ */
+template<class U>
+constexpr U double_to_float_odd_lanes(U d)
+{
+    constexpr uint64_t d_s_mask             = 0x8000000000000000;
+    constexpr uint64_t d_inf                = 0x7ff0000000000000;
+    constexpr uint64_t d_f_bias_offset      = 0x3800000000000000;
+    constexpr uint64_t d_f_norm_min         = 0x3810000000000000;
+    constexpr uint64_t d_f_inf_min          = 0x47f0000000000000;
+    constexpr uint64_t d_f_sticky_mask      = 0x000000001fffffff;
+    constexpr uint64_t d_f_m_pos_offset     = 0x000000000000001d;
+    constexpr uint64_t d_f_s_pos_offset     = 0x0000000000000020;
+    constexpr uint64_t f_inf                = 0x000000007f800000;
+    constexpr uint64_t f_qnan               = 0x000000007fc00000;
+    constexpr uint64_t f_m_mask             = 0x00000000007fffff;
+    const U d_s                             = u32_and(d, d_s_mask);
+    const U d_em                            = u32_andc(d, d_s_mask);
+    const U f_s                             = u32_srl(d_s, d_f_s_pos_offset);
+    const U f_em_trunc                      = u32_srl(u32_sub(d_em, d_f_bias_offset), d_f_m_pos_offset);
+    const U f_sticky                        = u32_srl(u32_add(u32_and(d_em, d_f_sticky_mask), d_f_sticky_mask), d_f_m_pos_offset);
+    const U f_em_odd                        = u32_or(f_em_trunc, f_sticky);
+    const U f_em_nan                        = u32_or(f_qnan, u32_and(u32_srl(d_em, d_f_m_pos_offset), f_m_mask));
+    const U is_tiny_msb                     = u32_sub(d_em, d_f_norm_min);
+    const U is_inf_msb                      = u32_sub(d_f_inf_min - 1, d_em);
+    const U is_nan_msb                      = u32_sub(d_inf, d_em);
+    const U f_tiny_result                   = u64_sels(is_tiny_msb, 0, f_em_odd);
+    const U f_inf_result                    = u64_sels(is_inf_msb, f_inf, f_tiny_result);
+    const U f_nan_result                    = u64_sels(is_nan_msb, f_em_nan, f_inf_result);
+    const U f_result                        = u32_or(f_s, f_nan_result);
 
     return f_result;
 }
 
+}
+
+/**
+ * @brief Convert single precision floating point to half precision,
+ * rounding to nearest even. NaN is quieted keeping upper bits of payload,
+ * so in nearest mode result is the same as of F16C instructions.
+ * 
+ * @tparam Mode Overflow handling
+ * @param f Single stored as uint32_t
+ * @return Half stored as uint16_t
+ */
+template<fp_mode Mode = fp_mode::nearest>
+constexpr uint16_t float_to_half(uint32_t f)
+{
+    return impl::float_to_mini_lanes<5, 10, true, Mode>(f);
+}
+
 /**
- * @brief Convert double precision floating point to half precision.
+ * @brief Convert half precision floating point to single precision.
+ * Conversion is exact, signaling NaN is quieted, same as F16C instructions.
  * 
+ * @param h Half stored as uint16_t
+ * @return Single stored as uint32_t
+ */
+constexpr uint32_t half_to_float(uint16_t h)
+{
+    return impl::mini_to_float_lanes<5, 10, true>(uint32_t(h));
+}
+
+/**
+ * @brief Convert double precision floating point to half precision,
+ * rounding only once to nearest even.
+ * 
+ * @tparam Mode Overflow handling
  * @param d Double stored as uint64_t
  * @return Half stored as uint16_t
  */
+template<fp_mode Mode = fp_mode::nearest>
 constexpr uint16_t double_to_half(uint64_t d)
 {
-    Float fp = d;
-    fp.f32 = fp.f64;
-    return float_to_half(fp.u32);
+    return float_to_half<Mode>(uint32_t(impl::double_to_float_odd_lanes(d)));
 }
 
 /**
@@ -235,6 +367,326 @@ constexpr uint64_t half_to_double(uint16_t h)
     return fp.u64;
 }
 
+/**
+ * @brief Convert single precision floating point to bfloat16, i.e. upper
+ * half of single precision, rounding to nearest even.
+ * 
+ * @tparam Mode Overflow handling
+ * @param f Single stored as uint32_t
+ * @return Bfloat16 stored as uint16_t
+ */
+template<fp_mode Mode = fp_mode::nearest>
+constexpr uint16_t float_to_bf16(uint32_t f)
+{
+    return impl::float_to_mini_lanes<8, 7, true, Mode>(f);
+}
+
+/**
+ * @brief Convert bfloat16 to single precision floating point.
+ * Conversion is exact, signaling NaN is quieted.
+ * 
+ * @param h Bfloat16 stored as uint16_t
+ * @return Single stored as uint32_t
+ */
+constexpr uint32_t bf16_to_float(uint16_t h)
+{
+    return impl::mini_to_float_lanes<8, 7, true>(uint32_t(h));
+}
+
+/**
+ * @brief Convert single precision floating point to 8-bit E4M3 format,
+ * rounding to nearest even. Format has no infinities, its range is
+ * +-448 and overflow gives NaN unless saturating.
+ * 
+ * @tparam Mode Overflow handling
+ * @param f Single stored as uint32_t
+ * @return E4M3 stored as uint8_t
+ */
+template<fp_mode Mode = fp_mode::nearest>
+constexpr uint8_t float_to_e4m3(uint32_t f)
+{
+    return impl::float_to_mini_lanes<4, 3, false, Mode>(f);
+}
+
+/**
+ * @brief Convert 8-bit E4M3 format to single precision floating point.
+ * 
+ * @param h E4M3 stored as uint8_t
+ * @return Single stored as uint32_t
+ */
+constexpr uint32_t e4m3_to_float(uint8_t h)
+{
+    return impl::mini_to_float_lanes<4, 3, false>(uint32_t(h));
+}
+
+/**
+ * @brief Convert single precision floating point to 8-bit E5M2 format,
+ * rounding to nearest even. Format is IEEE-like, with range +-57344.
+ * 
+ * @tparam Mode Overflow handling
+ * @param f Single stored as uint32_t
+ * @return E5M2 stored as uint8_t
+ */
+template<fp_mode Mode = fp_mode::nearest>
+constexpr uint8_t float_to_e5m2(uint32_t f)
+{
+    return impl::float_to_mini_lanes<5, 2, true, Mode>(f);
+}
+
+/**
+ * @brief Convert 8-bit E5M2 format to single precision floating point.
+ * Conversion is exact, signaling NaN is quieted.
+ * 
+ * @param h E5M2 stored as uint8_t
+ * @return Single stored as uint32_t
+ */
+constexpr uint32_t e5m2_to_float(uint8_t h)
+{
+    return impl::mini_to_float_lanes<5, 2, true>(uint32_t(h));
+}
+
+namespace impl {
+
+#ifdef __GNUC__
+template<class T>
+struct vec4 {
+    typedef T type __attribute__((vector_size(4 * sizeof(T))));
+};
+#endif
+
+/**
+ * @brief Apply lane-generic conversion to an array, four elements at once.
+ * 
+ * @tparam WI Unsigned integer type with bits of input element
+ * @tparam WO Unsigned integer type with bits of output element
+ * @param src Input array
+ * @param dst Output array
+ * @param n Number of elements
+ * @param lanes Generic callable converting uint32_t or vector of them
+ */
+template<class WI, class WO, class In, class Out, class Fn>
+inline void convert_lanes(const In *src, Out *dst, size_t n, Fn &&lanes)
+{
+    static_assert(sizeof(WI) == sizeof(In) && sizeof(WO) == sizeof(Out), "lane width mismatch");
+    size_t i = 0;
+#ifdef __GNUC__
+    typedef typename vec4<WI>::type wi4;
+    typedef typename vec4<WO>::type wo4;
+    typedef typename vec4<uint32_t>::type u32x4;
+    for (const size_t m = n & ~size_t(3); i < m; i += 4) {
+        wi4 x;
+        memcpy(&x, src + i, sizeof(x));
+        const wo4 y = __builtin_convertvector(lanes(__builtin_convertvector(x, u32x4)), wo4);
+        memcpy(dst + i, &y, sizeof(y));
+    }
+#endif
+    for (; i < n; ++i) {
+        WI x;
+        memcpy(&x, src + i, sizeof(x));
+        const WO y = lanes(uint32_t(x));
+        memcpy(dst + i, &y, sizeof(y));
+    }
+}
+
+/**
+ * @brief Portable batch conversions, run scalar chains on vector lanes.
+ * 
+ */
+template<fp_mode Mode = fp_mode::nearest>
+inline void float_to_half_sw(const float *src, uint16_t *dst, size_t n)
+{
+    convert_lanes<uint32_t, uint16_t>(src, dst, n, [](auto f) { return float_to_mini_lanes<5, 10, true, Mode>(f); });
+}
+
+inline void half_to_float_sw(const uint16_t *src, float *dst, size_t n)
+{
+    convert_lanes<uint16_t, uint32_t>(src, dst, n, [](auto h) { return mini_to_float_lanes<5, 10, true>(h); });
+}
+
+template<fp_mode Mode = fp_mode::nearest>
+inline void double_to_half_sw(const double *src, uint16_t *dst, size_t n)
+{
+    size_t i = 0;
+#ifdef __GNUC__
+    typedef uint64_t u64x2 __attribute__((vector_size(16)));
+    typedef uint32_t u32x2 __attribute__((vector_size(8)));
+    typedef typename vec4<uint32_t>::type u32x4;
+    typedef typename vec4<uint16_t>::type u16x4;
+    for (const size_t m = n & ~size_t(3); i < m; i += 4) {
+        u64x2 lo, hi;
+        memcpy(&lo, src + i, sizeof(lo));
+        memcpy(&hi, src + i + 2, sizeof(hi));
+        const u32x2 f_lo = __builtin_convertvector(double_to_float_odd_lanes(lo), u32x2);
+        const u32x2 f_hi = __builtin_convertvector(double_to_float_odd_lanes(hi), u32x2);
+        const u32x4 f = __builtin_shufflevector(f_lo, f_hi, 0, 1, 2, 3);
+        const u16x4 h = __builtin_convertvector(float_to_mini_lanes<5, 10, true, Mode>(f), u16x4);
+        memcpy(dst + i, &h, sizeof(h));
+    }
+#endif
+    for (; i < n; ++i)
+        dst[i] = double_to_half<Mode>(Float(src[i]).u64);
+}
+
+#ifdef UTL_F16C
+__attribute__((target("avx,f16c")))
+inline void float_to_half_f16c(const float *src, uint16_t *dst, size_t n)
+{
+    size_t i = 0;
+    for (const size_t m = n & ~size_t(7); i < m; i += 8) {
+        const __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), h);
+    }
+    for (; i < n; ++i)
+        dst[i] = _cvtss_sh(src[i], _MM_FROUND_TO_NEAREST_INT);
+}
+
+__attribute__((target("avx,f16c")))
+inline void half_to_float_f16c(const uint16_t *src, float *dst, size_t n)
+{
+    size_t i = 0;
+    for (const size_t m = n & ~size_t(7); i < m; i += 8) {
+        const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+    }
+    for (; i < n; ++i)
+        dst[i] = _cvtsh_ss(src[i]);
+}
+
+#endif
+
+}
+
+/**
+ * @brief Convert array of single precision floats to half precision. In
+ * nearest mode uses F16C instructions when CPU has them, otherwise runs
+ * branchless chain on vector lanes. Result is bit-exact with scalar version.
+ * 
+ * @tparam Mode Overflow handling
+ * @param src Input array
+ * @param dst Output array
+ * @param n Number of elements
+ */
+template<fp_mode Mode = fp_mode::nearest>
+inline void float_to_half(const float *src, uint16_t *dst, size_t n)
+{
+#ifdef UTL_F16C
+    if (Mode == fp_mode::nearest && cpu_has(cpu_f16c))
+        return impl::float_to_half_f16c(src, dst, n);
+#endif
+    impl::float_to_half_sw<Mode>(src, dst, n);
+}
+
+/**
+ * @brief Convert array of half precision floats to single precision. Uses
+ * F16C instructions when CPU has them, otherwise vectorized branchless chain.
+ * Result is bit-exact with scalar half_to_float() in both cases.
+ * 
+ * @param src Input array
+ * @param dst Output array
+ * @param n Number of elements
+ */
+inline void half_to_float(const uint16_t *src, float *dst, size_t n)
+{
+#ifdef UTL_F16C
+    if (cpu_has(cpu_f16c))
+        return impl::half_to_float_f16c(src, dst, n);
+#endif
+    impl::half_to_float_sw(src, dst, n);
+}
+
+/**
+ * @brief Convert array of double precision floats to half precision,
+ * rounding once, bit-exact with scalar version.
+ * 
+ * @tparam Mode Overflow handling
+ * @param src Input array
+ * @param dst Output array
+ * @param n Number of elements
+ */
+template<fp_mode Mode = fp_mode::nearest>
+inline void double_to_half(const double *src, uint16_t *dst, size_t n)
+{
+    impl::double_to_half_sw<Mode>(src, dst, n);
 }
 
-#endif
\ No newline at end of file
+/**
+ * @brief Convert array of single precision floats to bfloat16.
+ * 
+ * @tparam Mode Overflow handling
+ * @param src Input array
+ * @param dst Output array
+ * @param n Number of elements
+ */
+template<fp_mode Mode = fp_mode::nearest>
+inline void float_to_bf16(const float *src, uint16_t *dst, size_t n)
+{
+    impl::convert_lanes<uint32_t, uint16_t>(src, dst, n, [](auto f) { return impl::float_to_mini_lanes<8, 7, true, Mode>(f); });
+}
+
+/**
+ * @brief Convert array of bfloat16 to single precision floats.
+ * 
+ * @param src Input array
+ * @param dst Output array
+ * @param n Number of elements
+ */
+inline void bf16_to_float(const uint16_t *src, float *dst, size_t n)
+{
+    impl::convert_lanes<uint16_t, uint32_t>(src, dst, n, [](auto h) { return impl::mini_to_float_lanes<8, 7, true>(h); });
+}
+
+/**
+ * @brief Convert array of single precision floats to E4M3.
+ * 
+ * @tparam Mode Overflow handling
+ * @param src Input array
+ * @param dst Output array
+ * @param n Number of elements
+ */
+template<fp_mode Mode = fp_mode::nearest>
+inline void float_to_e4m3(const float *src, uint8_t *dst, size_t n)
+{
+    impl::convert_lanes<uint32_t, uint8_t>(src, dst, n, [](auto f) { return impl::float_to_mini_lanes<4, 3, false, Mode>(f); });
+}
+
+/**
+ * @brief Convert array of E4M3 to single precision floats.
+ * 
+ * @param src Input array
+ * @param dst Output array
+ * @param n Number of elements
+ */
+inline void e4m3_to_float(const uint8_t *src, float *dst, size_t n)
+{
+    impl::convert_lanes<uint8_t, uint32_t>(src, dst, n, [](auto h) { return impl::mini_to_float_lanes<4, 3, false>(h); });
+}
+
+/**
+ * @brief Convert array of single precision floats to E5M2.
+ * 
+ * @tparam Mode Overflow handling
+ * @param src Input array
+ * @param dst Output array
+ * @param n Number of elements
+ */
+template<fp_mode Mode = fp_mode::nearest>
+inline void float_to_e5m2(const float *src, uint8_t *dst, size_t n)
+{
+    impl::convert_lanes<uint32_t, uint8_t>(src, dst, n, [](auto f) { return impl::float_to_mini_lanes<5, 2, true, Mode>(f); });
+}
+
+/**
+ * @brief Convert array of E5M2 to single precision floats.
+ * 
+ * @param src Input array
+ * @param dst Output array
+ * @param n Number of elements
+ */
+inline void e5m2_to_float(const uint8_t *src, float *dst, size_t n)
+{
+    impl::convert_lanes<uint8_t, uint32_t>(src, dst, n, [](auto h) { return impl::mini_to_float_lanes<5, 2, true>(h); });
+}
+
+}
+
+#endif
@@ -0,0 +1,332 @@
+#ifndef UTL_GF_H
+#define UTL_GF_H
+
+#include "utl/cpu.h"
+#include "utl/math.h"
+#ifdef UTL_CPU_DISPATCH
+#define UTL_GF_SIMD 1
+#endif
+
+namespace utl {
+namespace impl {
+
+/**
+ * @brief Products of a constant with every low and every high nibble,
+ * so that c * x = lo[x & 15] ^ hi[x >> 4]. Both fit into single 16-byte
+ * register and serve as pshufb lookup tables.
+ *
+ */
+struct gf_nibbles {
+    alignas(16) uint8_t lo[16];
+    alignas(16) uint8_t hi[16];
+};
+
+constexpr gf_nibbles gf_make_nibbles(uint8_t c)
+{
+    gf_nibbles n = {};
+    for (unsigned i = 0; i < 16; ++i) {
+        n.lo[i] = gf_mul(c, i);
+        n.hi[i] = gf_mul(c, i << 4);
+    }
+    return n;
+}
+
+template<bool Add>
+inline void gf_region_sw(const gf_nibbles &n, const uint8_t *src, uint8_t *dst, size_t i, size_t len)
+{
+    for (; i < len; ++i) {
+        uint8_t p = n.lo[src[i] & 0x0f] ^ n.hi[src[i] >> 4];
+        dst[i] = Add ? dst[i] ^ p : p;
+    }
+}
+
+#ifdef UTL_GF_SIMD
+template<bool Add>
+__attribute__((target("ssse3")))
+inline void gf_region_ssse3(const gf_nibbles &n, const uint8_t *src, uint8_t *dst, size_t len)
+{
+    const __m128i lo = _mm_load_si128(reinterpret_cast<const __m128i*>(n.lo));
+    const __m128i hi = _mm_load_si128(reinterpret_cast<const __m128i*>(n.hi));
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    size_t i = 0;
+
+    for (const size_t m = len & ~size_t(15); i < m; i += 16) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i x_lo = _mm_and_si128(x, mask);
+        const __m128i x_hi = _mm_and_si128(_mm_srli_epi64(x, 4), mask);
+        __m128i p = _mm_xor_si128(_mm_shuffle_epi8(lo, x_lo), _mm_shuffle_epi8(hi, x_hi));
+        if (Add)
+            p = _mm_xor_si128(p, _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), p);
+    }
+    gf_region_sw<Add>(n, src, dst, i, len);
+}
+
+template<bool Add>
+__attribute__((target("avx2")))
+inline void gf_region_avx2(const gf_nibbles &n, const uint8_t *src, uint8_t *dst, size_t len)
+{
+    const __m256i lo = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(n.lo)));
+    const __m256i hi = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(n.hi)));
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    size_t i = 0;
+
+    for (const size_t m = len & ~size_t(31); i < m; i += 32) {
+        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        const __m256i x_lo = _mm256_and_si256(x, mask);
+        const __m256i x_hi = _mm256_and_si256(_mm256_srli_epi64(x, 4), mask);
+        __m256i p = _mm256_xor_si256(_mm256_shuffle_epi8(lo, x_lo), _mm256_shuffle_epi8(hi, x_hi));
+        if (Add)
+            p = _mm256_xor_si256(p, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), p);
+    }
+    gf_region_sw<Add>(n, src, dst, i, len);
+}
+
+inline int gf_simd_level()
+{
+    return cpu_has(cpu_avx2) ? 2 : cpu_has(cpu_ssse3) ? 1 : 0;
+}
+#endif
+
+template<bool Add>
+inline void gf_region(uint8_t c, const uint8_t *src, uint8_t *dst, size_t len)
+{
+    const gf_nibbles n = gf_make_nibbles(c);
+#ifdef UTL_GF_SIMD
+    switch (gf_simd_level()) {
+    case 2:
+        return gf_region_avx2<Add>(n, src, dst, len);
+    case 1:
+        return gf_region_ssse3<Add>(n, src, dst, len);
+    }
+#endif
+    gf_region_sw<Add>(n, src, dst, 0, len);
+}
+
+}
+
+/**
+ * @brief Multiply byte buffer by a constant in Galois 2^8 field. Uses
+ * split-nibble pshufb lookups with AVX2 or SSSE3 when CPU has them.
+ *
+ * @param c Constant multiplier
+ * @param src Input buffer
+ * @param dst Output buffer, may be the same as input
+ * @param len Buffer length
+ */
+inline void gf_mul(uint8_t c, const uint8_t *src, uint8_t *dst, size_t len)
+{
+    impl::gf_region<false>(c, src, dst, len);
+}
+
+/**
+ * @brief Multiply byte buffer by a constant and add (xor) it to another
+ * buffer in Galois 2^8 field, i.e. dst += c * src.
+ *
+ * @param c Constant multiplier
+ * @param src Input buffer
+ * @param dst Accumulator buffer
+ * @param len Buffer length
+ */
+inline void gf_mul_add(uint8_t c, const uint8_t *src, uint8_t *dst, size_t len)
+{
+    if (c)
+        impl::gf_region<true>(c, src, dst, len);
+}
+
+namespace impl {
+
+/**
+ * @brief Invert square matrix in Galois 2^8 field by Gauss-Jordan elimination.
+ *
+ * @param a Row-major N x N matrix, destroyed
+ * @param inv Row-major N x N output
+ * @param n Matrix size
+ * @return false if matrix is singular
+ */
+constexpr bool gf_invert(uint8_t *a, uint8_t *inv, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j < n; ++j)
+            inv[i * n + j] = i == j;
+
+    for (size_t c = 0; c < n; ++c) {
+        size_t p = c;
+        while (p < n && !a[p * n + c])
+            ++p;
+        if (p == n)
+            return false;
+        for (size_t j = 0; j < n && p != c; ++j) {
+            uint8_t t = a[p * n + j];
+            a[p * n + j] = a[c * n + j];
+            a[c * n + j] = t;
+            t = inv[p * n + j];
+            inv[p * n + j] = inv[c * n + j];
+            inv[c * n + j] = t;
+        }
+        const uint8_t k = gf_inv(a[c * n + c]);
+        for (size_t j = 0; j < n; ++j) {
+            a[c * n + j] = gf_mul(a[c * n + j], k);
+            inv[c * n + j] = gf_mul(inv[c * n + j], k);
+        }
+        for (size_t r = 0; r < n; ++r) {
+            const uint8_t f = a[r * n + c];
+            if (r == c || !f)
+                continue;
+            for (size_t j = 0; j < n; ++j) {
+                a[r * n + j] ^= gf_mul(f, a[c * n + j]);
+                inv[r * n + j] ^= gf_mul(f, inv[c * n + j]);
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Parity rows of systematic coding matrix. Vandermonde matrix of
+ * K + M distinct points is multiplied by inverse of its top K rows, so the
+ * top becomes identity while any K rows stay linearly independent.
+ *
+ */
+template<size_t K, size_t M>
+struct rs_matrix {
+    uint8_t m[M][K];
+};
+
+template<size_t K, size_t M>
+constexpr rs_matrix<K, M> rs_make_matrix()
+{
+    uint8_t top[K * K] = {};
+    uint8_t inv[K * K] = {};
+    rs_matrix<K, M> r = {};
+
+    for (size_t i = 0; i < K; ++i)
+        for (size_t j = 0; j < K; ++j)
+            top[i * K + j] = gf_pow(i, j);
+    gf_invert(top, inv, K);
+
+    for (size_t i = 0; i < M; ++i) {
+        for (size_t j = 0; j < K; ++j) {
+            uint8_t s = 0;
+            for (size_t k = 0; k < K; ++k)
+                s ^= gf_mul(gf_pow(K + i, k), inv[k * K + j]);
+            r.m[i][j] = s;
+        }
+    }
+    return r;
+}
+
+}
+
+/**
+ * @brief Systematic Reed-Solomon erasure codec over Galois 2^8 field with
+ * polynomial 0x11d. K data shards are extended with M parity shards, and
+ * any K of all K + M shards are enough to restore the rest. Shards are
+ * processed in blocks which stay in L1 cache while all coefficients are
+ * applied to them.
+ *
+ * @tparam K Number of data shards
+ * @tparam M Number of parity shards
+ */
+template<size_t K, size_t M>
+struct rs_codec {
+private:
+    static_assert(K > 0 && M > 0 && K + M <= 256, "invalid shard counts");
+    static constexpr size_t block = 4096;
+    static constexpr impl::rs_matrix<K, M> matrix = impl::rs_make_matrix<K, M>();
+public:
+    // Total number of shards.
+    static constexpr size_t shards = K + M;
+
+    /**
+     * @brief Get coefficient of data shard in parity shard.
+     *
+     * @param p Parity shard index - [0, M)
+     * @param d Data shard index - [0, K)
+     * @return Coefficient
+     */
+    static constexpr uint8_t coef(size_t p, size_t d)
+    {
+        return matrix.m[p][d];
+    }
+
+    /**
+     * @brief Compute parity shards.
+     *
+     * @param data K data shards
+     * @param parity M output parity shards
+     * @param len Length of each shard
+     */
+    static void encode(const uint8_t *const *data, uint8_t *const *parity, size_t len)
+    {
+        for (size_t off = 0; off < len; off += block) {
+            const size_t n = len - off < block ? len - off : block;
+            for (size_t p = 0; p < M; ++p) {
+                gf_mul(matrix.m[p][0], data[0] + off, parity[p] + off, n);
+                for (size_t d = 1; d < K; ++d)
+                    gf_mul_add(matrix.m[p][d], data[d] + off, parity[p] + off, n);
+            }
+        }
+    }
+
+    /**
+     * @brief Restore missing shards in place.
+     *
+     * @param shard K data shards followed by M parity shards, missing ones
+     * must still point to writable buffers
+     * @param present Flags of available shards
+     * @param len Length of each shard
+     * @return false if less than K shards are present
+     */
+    static bool reconstruct(uint8_t *const *shard, const bool *present, size_t len)
+    {
+        size_t rows[K] = {};
+        size_t cnt = 0;
+        bool data_ok = true;
+
+        for (size_t i = 0; i < shards && cnt < K; ++i)
+            if (present[i])
+                rows[cnt++] = i;
+        if (cnt < K)
+            return false;
+        for (size_t i = 0; i < K; ++i)
+            data_ok &= present[i];
+
+        if (!data_ok) {
+            thread_local uint8_t a[K * K], inv[K * K];
+            for (size_t i = 0; i < K; ++i)
+                for (size_t j = 0; j < K; ++j)
+                    a[i * K + j] = rows[i] < K ? rows[i] == j : matrix.m[rows[i] - K][j];
+            if (!impl::gf_invert(a, inv, K))
+                return false;
+
+            for (size_t off = 0; off < len; off += block) {
+                const size_t n = len - off < block ? len - off : block;
+                for (size_t d = 0; d < K; ++d) {
+                    if (present[d])
+                        continue;
+                    gf_mul(inv[d * K], shard[rows[0]] + off, shard[d] + off, n);
+                    for (size_t i = 1; i < K; ++i)
+                        gf_mul_add(inv[d * K + i], shard[rows[i]] + off, shard[d] + off, n);
+                }
+            }
+        }
+
+        for (size_t off = 0; off < len; off += block) {
+            const size_t n = len - off < block ? len - off : block;
+            for (size_t p = 0; p < M; ++p) {
+                if (present[K + p])
+                    continue;
+                gf_mul(matrix.m[p][0], shard[0] + off, shard[K + p] + off, n);
+                for (size_t d = 1; d < K; ++d)
+                    gf_mul_add(matrix.m[p][d], shard[d] + off, shard[K + p] + off, n);
+            }
+        }
+        return true;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,301 @@
+#ifndef UTL_HISTOGRAM_H
+#define UTL_HISTOGRAM_H
+
+#include "utl/base.h"
+#include <atomic>
+
+namespace utl {
+namespace impl {
+
+/**
+ * @brief Floor of base 2 logarithm.
+ *
+ * @param x Argument, must be non-zero
+ * @return Position of most significant set bit
+ */
+constexpr unsigned u64_log2(uint64_t x)
+{
+#ifdef __GNUC__
+    return 63 - __builtin_clzll(x);
+#else
+    unsigned l = 0;
+    while (x >>= 1)
+        ++l;
+    return l;
+#endif
+}
+
+/**
+ * @brief Write unsigned LEB128 variable length integer.
+ *
+ * @param x Value
+ * @param buf Output buffer
+ * @param pos Position in buffer, advanced on success
+ * @param len Buffer size
+ * @return true if value fit
+ */
+constexpr bool varint_put(uint64_t x, uint8_t *buf, size_t &pos, size_t len)
+{
+    do {
+        if (pos >= len)
+            return false;
+        buf[pos++] = (x & 0x7f) | (x > 0x7f ? 0x80 : 0);
+        x >>= 7;
+    } while (x);
+    return true;
+}
+
+/**
+ * @brief Read unsigned LEB128 variable length integer.
+ *
+ * @param x Output value
+ * @param buf Input buffer
+ * @param pos Position in buffer, advanced on success
+ * @param len Buffer size
+ * @return true if complete value was read
+ */
+constexpr bool varint_get(uint64_t &x, const uint8_t *buf, size_t &pos, size_t len)
+{
+    x = 0;
+    for (unsigned shift = 0; pos < len && shift < 64; shift += 7) {
+        uint8_t b = buf[pos++];
+        x |= uint64_t(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+}
+
+/**
+ * @brief Log-linear latency histogram with fixed memory. Values below 2^Bits
+ * are counted exactly, larger values go to one of 2^Bits linear sub-buckets
+ * of their power of 2 range, so relative error is at most 2^-Bits. Recording
+ * is a single relaxed atomic increment, so one instance can be shared between
+ * threads, or per-thread instances can be merged later.
+ *
+ * @tparam Max Largest trackable value, larger values are clamped
+ * @tparam Bits Sub-bucket precision, e.g. 7 gives < 1% relative error
+ */
+template<uint64_t Max, unsigned Bits = 7>
+struct histogram {
+private:
+    static_assert(Max > 0 && Bits > 0 && Bits < 32, "invalid histogram parameters");
+    static constexpr uint64_t sub = uint64_t(1) << Bits;
+    static constexpr unsigned top = impl::u64_log2(Max) < Bits ? Bits : impl::u64_log2(Max);
+    static constexpr uint8_t magic = 0xd7;
+public:
+    // Number of buckets.
+    static constexpr size_t buckets = (top - Bits + 2) * sub;
+
+    /**
+     * @brief Get bucket index of a value.
+     *
+     * @param v Value, must not exceed Max
+     * @return Bucket index
+     */
+    static constexpr size_t index(uint64_t v)
+    {
+        if (v < sub)
+            return v;
+        unsigned e = impl::u64_log2(v);
+        return (e - Bits + 1) * sub + ((v >> (e - Bits)) - sub);
+    }
+
+    /**
+     * @brief Get smallest value which falls into a bucket.
+     *
+     * @param i Bucket index
+     * @return Value
+     */
+    static constexpr uint64_t lowest(size_t i)
+    {
+        if (i < sub)
+            return i;
+        size_t g = i >> Bits;
+        return (sub + (i & (sub - 1))) << (g - 1);
+    }
+
+    /**
+     * @brief Get largest value which falls into a bucket.
+     *
+     * @param i Bucket index
+     * @return Value
+     */
+    static constexpr uint64_t highest(size_t i)
+    {
+        uint64_t hi = i < sub ? i : lowest(i) + (uint64_t(1) << ((i >> Bits) - 1)) - 1;
+        return hi < Max ? hi : Max;
+    }
+
+    /**
+     * @brief Record a value.
+     *
+     * @param v Value, clamped to Max
+     * @param n Number of occurrences
+     */
+    void record(uint64_t v, uint64_t n = 1)
+    {
+        counts[index(v < Max ? v : Max)].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Add counts of another histogram of the same layout.
+     *
+     * @param other Histogram to merge
+     */
+    void merge(const histogram &other)
+    {
+        for (size_t i = 0; i < buckets; ++i) {
+            auto n = other.counts[i].load(std::memory_order_relaxed);
+            if (n)
+                counts[i].fetch_add(n, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Clear all counts.
+     *
+     */
+    void reset()
+    {
+        for (auto &c : counts)
+            c.store(0, std::memory_order_relaxed);
+    }
+
+    // Get count of a bucket.
+    uint64_t count(size_t i) const { return counts[i].load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Get total number of recorded values.
+     *
+     * @return Count
+     */
+    uint64_t count() const
+    {
+        uint64_t total = 0;
+        for (auto &c : counts)
+            total += c.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    /**
+     * @brief Get value at given percentile, as the highest value
+     * equivalent to the bucket where it falls.
+     *
+     * @param p Percentile - [0, 100]
+     * @return Value, 0 if empty
+     */
+    uint64_t percentile(double p) const
+    {
+        uint64_t total = count();
+        if (!total)
+            return 0;
+        uint64_t rank = p <= 0 ? 1 : p >= 100 ? total : uint64_t(p / 100 * total + 0.5);
+        if (!rank)
+            rank = 1;
+        uint64_t acc = 0;
+        for (size_t i = 0; i < buckets; ++i) {
+            acc += counts[i].load(std::memory_order_relaxed);
+            if (acc >= rank)
+                return highest(i);
+        }
+        return Max;
+    }
+
+    /**
+     * @brief Get approximate arithmetic mean, using bucket midpoints.
+     *
+     * @return Mean, 0 if empty
+     */
+    double mean() const
+    {
+        double sum = 0;
+        uint64_t total = 0;
+        for (size_t i = 0; i < buckets; ++i) {
+            uint64_t n = counts[i].load(std::memory_order_relaxed);
+            sum += n * ((lowest(i) + highest(i)) / 2.0);
+            total += n;
+        }
+        return total ? sum / total : 0;
+    }
+
+    /**
+     * @brief Serialize counts into compact form. Each bucket is written as
+     * zigzag LEB128 varint, where negative values encode runs of empty buckets.
+     *
+     * @param buf Output buffer
+     * @param len Output buffer size
+     * @return Number of written bytes, 0 if buffer is too small
+     */
+    size_t serialize(uint8_t *buf, size_t len) const
+    {
+        size_t pos = 0;
+
+        if (!buf || len < 2)
+            return 0;
+        buf[pos++] = magic;
+        buf[pos++] = Bits;
+
+        if (!impl::varint_put(buckets, buf, pos, len))
+            return 0;
+
+        for (size_t i = 0; i < buckets;) {
+            uint64_t n = counts[i].load(std::memory_order_relaxed);
+            if (n) {
+                if (!impl::varint_put(n << 1, buf, pos, len))
+                    return 0;
+                ++i;
+            } else {
+                size_t run = 0;
+                while (i < buckets && !counts[i].load(std::memory_order_relaxed)) {
+                    ++run;
+                    ++i;
+                }
+                if (!impl::varint_put(((run - 1) << 1) | 1, buf, pos, len))
+                    return 0;
+            }
+        }
+        return pos;
+    }
+
+    /**
+     * @brief Replace counts with serialized ones. Layout must match.
+     *
+     * @param buf Input buffer
+     * @param len Input buffer size
+     * @return true on success, on failure histogram is cleared
+     */
+    bool deserialize(const uint8_t *buf, size_t len)
+    {
+        size_t pos = 2;
+        uint64_t n = 0;
+
+        reset();
+
+        if (!buf || len < 2 || buf[0] != magic || buf[1] != Bits ||
+            !impl::varint_get(n, buf, pos, len) || n != buckets)
+            return false;
+
+        for (size_t i = 0; i < buckets;) {
+            if (!impl::varint_get(n, buf, pos, len))
+                break;
+            if (n & 1) {
+                i += (n >> 1) + 1;
+            } else {
+                counts[i++].store(n >> 1, std::memory_order_relaxed);
+            }
+            if (i == buckets && pos == len)
+                return true;
+        }
+        reset();
+        return false;
+    }
+private:
+    std::atomic<uint64_t> counts[buckets] = {};
+};
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,428 @@
+#ifndef UTL_IMU_H
+#define UTL_IMU_H
+
+#include "utl/physics.h"
+#include "utl/ring.h"
+
+namespace utl {
+
+/**
+ * @brief Three axis sensor reading.
+ *
+ */
+struct imu_vec {
+    double x;
+    double y;
+    double z;
+};
+
+/**
+ * @brief Accelerometer reading in any units and gyroscope reading in rad/s.
+ *
+ */
+struct imu_sample {
+    imu_vec accel;
+    imu_vec gyro;
+};
+
+/**
+ * @brief Orientation in degrees, same conventions as roll(), pitch()
+ * and inclination() of "physics.h".
+ *
+ */
+struct imu_angles {
+    double roll;
+    double pitch;
+    double inclination;
+};
+
+namespace impl {
+
+inline constexpr size_t imu_chunk = 64; // Samples per pass, buffers stay on stack
+
+enum class imu_op {
+    tilt,   // Accelerometer x, y, z
+    euler,  // Roll and pitch in radians
+    quat,   // Unit quaternion w, x, y, z
+};
+
+template<class T>
+UTL_FM_INLINE void imu_clamp(T &x)
+{
+    const T one = T{} + 1.0;
+    x = x > 1.0 ? one : x;
+    x = x < -1.0 ? -one : x;
+}
+
+/**
+ * @brief Roll, pitch and inclination in radians from one of the inputs.
+ *
+ * @param in Input lanes
+ * @param out Output lanes
+ */
+template<imu_op Op, class T>
+UTL_FM_INLINE void imu_lanes(const T *in, T *out)
+{
+    if constexpr (Op == imu_op::tilt) {
+        T yz, xy;
+        fm_sqrt(T(in[1] * in[1] + in[2] * in[2]), yz);
+        fm_sqrt(T(in[0] * in[0] + in[1] * in[1]), xy);
+        fm_atan2_lanes(in[1], in[2], out[0]);
+        fm_atan2_lanes(T(-in[0]), yz, out[1]);
+        fm_atan2_lanes(xy, in[2], out[2]);
+    } else if constexpr (Op == imu_op::euler) {
+        T cr, cp;
+        fm_sincos_lanes(in[0], cr, 1);
+        fm_sincos_lanes(in[1], cp, 1);
+        T c = cr * cp;
+        imu_clamp(c);
+        out[0] = in[0];
+        out[1] = in[1];
+        fm_asin_lanes(c, out[2], true);
+    } else {
+        const T &w = in[0], &x = in[1], &y = in[2], &z = in[3];
+        const T c = 1.0 - 2.0 * (x * x + y * y);
+        T s = 2.0 * (w * y - x * z);
+        T ci = c;
+        imu_clamp(s);
+        imu_clamp(ci);
+        fm_atan2_lanes(T(2.0 * (w * x + y * z)), c, out[0]);
+        fm_asin_lanes(s, out[1], false);
+        fm_asin_lanes(ci, out[2], true);
+    }
+}
+
+/**
+ * @brief Apply kernel to structure-of-arrays chunk with vectors of type T,
+ * remainder is processed with scalars. Outputs are converted to degrees.
+ *
+ * @param in Input arrays
+ * @param out Output arrays
+ * @param n Number of elements
+ */
+template<imu_op Op, class T>
+UTL_FM_INLINE void imu_batch(const double *const *in, double *const *out, size_t n)
+{
+    constexpr size_t ins = Op == imu_op::quat ? 4 : Op == imu_op::tilt ? 3 : 2;
+    constexpr size_t w = sizeof(T) / sizeof(double);
+    constexpr double deg = 180 / pi;
+    size_t i = 0;
+
+    for (const size_t m = n & ~(w - 1); i < m; i += w) {
+        T a[4] = {}, r[3];
+        for (size_t k = 0; k < ins; ++k)
+            memcpy(&a[k], in[k] + i, sizeof(T));
+        imu_lanes<Op>(a, r);
+        for (size_t k = 0; k < 3; ++k) {
+            r[k] = r[k] * deg;
+            memcpy(out[k] + i, &r[k], sizeof(T));
+        }
+    }
+    for (; i < n; ++i) {
+        double a[4] = {}, r[3];
+        for (size_t k = 0; k < ins; ++k)
+            a[k] = in[k][i];
+        imu_lanes<Op>(a, r);
+        for (size_t k = 0; k < 3; ++k)
+            out[k][i] = r[k] * deg;
+    }
+}
+
+#ifdef UTL_FASTMATH_SIMD
+template<imu_op Op>
+__attribute__((target("avx2,fma")))
+inline void imu_batch_avx2(const double *const *in, double *const *out, size_t n)
+{
+    imu_batch<Op, __m256d>(in, out, n);
+}
+
+template<imu_op Op>
+__attribute__((target("avx512f")))
+inline void imu_batch_avx512(const double *const *in, double *const *out, size_t n)
+{
+    imu_batch<Op, __m512d>(in, out, n);
+}
+#endif
+
+template<imu_op Op>
+inline void imu_dispatch(const double *const *in, double *const *out, size_t n)
+{
+#ifdef UTL_FASTMATH_SIMD
+    switch (fm_simd_level()) {
+    case 2:
+        return imu_batch_avx512<Op>(in, out, n);
+    case 1:
+        return imu_batch_avx2<Op>(in, out, n);
+    case 0:
+        return imu_batch<Op, __m128d>(in, out, n);
+    }
+#endif
+    imu_batch<Op, double>(in, out, n);
+}
+
+/**
+ * @brief Move samples from input ring to output ring in chunks, until input
+ * is empty or output is full. Rings discarding old items never get full.
+ *
+ * @param in Input ring
+ * @param out Output ring
+ * @param fn Chunk processor with (const In *, imu_angles *, size_t) signature
+ * @return Number of processed samples
+ */
+template<class In, size_t N, bool D1, size_t M, bool D2, class Fn>
+size_t imu_run(ring<In, N, D1> &in, ring<imu_angles, M, D2> &out, Fn &&fn)
+{
+    size_t done = 0;
+    for (;;) {
+        size_t n = in.size() < imu_chunk ? in.size() : imu_chunk;
+        if (!D2)
+            n = n < M - out.size() ? n : M - out.size();
+        if (!n)
+            return done;
+        In src[imu_chunk];
+        imu_angles dst[imu_chunk];
+        in.read(src, n);
+        fn(src, dst, n);
+        out.write(dst, n);
+        done += n;
+    }
+}
+
+/**
+ * @brief Interleave chunk of angles from separate arrays.
+ *
+ */
+inline void imu_store(const double *r, const double *p, const double *i, imu_angles *dst, size_t n)
+{
+    for (size_t k = 0; k < n; ++k)
+        dst[k] = {r[k], p[k], i[k]};
+}
+
+}
+
+/**
+ * @brief Tilt of accelerometer samples, vectorized equivalent of roll(),
+ * pitch() and inclination() with fast elementary functions. Stops when input
+ * is empty or output is full, without allocation.
+ *
+ * @param in Accelerometer samples
+ * @param out Angles
+ * @return Number of processed samples
+ */
+template<size_t N, bool D1, size_t M, bool D2>
+size_t imu_tilt(ring<imu_vec, N, D1> &in, ring<imu_angles, M, D2> &out)
+{
+    return impl::imu_run(in, out, [](const imu_vec *src, imu_angles *dst, size_t n) {
+        double x[impl::imu_chunk], y[impl::imu_chunk], z[impl::imu_chunk];
+        double r[impl::imu_chunk], p[impl::imu_chunk], i[impl::imu_chunk];
+        for (size_t k = 0; k < n; ++k) {
+            x[k] = src[k].x;
+            y[k] = src[k].y;
+            z[k] = src[k].z;
+        }
+        const double *ins[] = {x, y, z};
+        double *const outs[] = {r, p, i};
+        impl::imu_dispatch<impl::imu_op::tilt>(ins, outs, n);
+        impl::imu_store(r, p, i, dst, n);
+    });
+}
+
+/**
+ * @brief Complementary filter: integrates gyroscope rates and pulls result
+ * toward accelerometer tilt, which cancels gyroscope drift and accelerometer
+ * noise. Tilt and output angles are vectorized, only the recurrence is scalar.
+ * Gyroscope x and y rates are used as roll and pitch rates, which holds
+ * for small pitch.
+ *
+ */
+class imu_complementary {
+public:
+    /**
+     * @brief Construct filter.
+     *
+     * @param dt Sample period in seconds
+     * @param alpha Gyroscope weight, e.g. 0.98
+     */
+    imu_complementary(double dt, double alpha = 0.98) : dt{dt}, alpha{alpha} {}
+
+    void reset() { init = false; }
+
+    /**
+     * @brief Filter samples from input ring to output ring, stops when input
+     * is empty or output is full, without allocation.
+     *
+     * @param in Samples
+     * @param out Angles
+     * @return Number of processed samples
+     */
+    template<size_t N, bool D1, size_t M, bool D2>
+    size_t process(ring<imu_sample, N, D1> &in, ring<imu_angles, M, D2> &out)
+    {
+        return impl::imu_run(in, out, [this](const imu_sample *src, imu_angles *dst, size_t n) {
+            chunk(src, dst, n);
+        });
+    }
+private:
+    void chunk(const imu_sample *src, imu_angles *dst, size_t n)
+    {
+        constexpr double rad = impl::pi / 180;
+        double x[impl::imu_chunk], y[impl::imu_chunk], z[impl::imu_chunk];
+        double r[impl::imu_chunk], p[impl::imu_chunk], i[impl::imu_chunk];
+        for (size_t k = 0; k < n; ++k) {
+            x[k] = src[k].accel.x;
+            y[k] = src[k].accel.y;
+            z[k] = src[k].accel.z;
+        }
+        const double *ins[] = {x, y, z};
+        double *const outs[] = {r, p, i};
+        impl::imu_dispatch<impl::imu_op::tilt>(ins, outs, n);
+
+        if (!init) {
+            rl = r[0] * rad;
+            pt = p[0] * rad;
+            init = true;
+        }
+        for (size_t k = 0; k < n; ++k) {
+            double dr = r[k] * rad - (rl += src[k].gyro.x * dt);
+            dr -= dr > impl::pi ? 2 * impl::pi : dr < -impl::pi ? -2 * impl::pi : 0;  // Shortest way across +-180
+            rl += (1 - alpha) * dr;
+            rl -= rl > impl::pi ? 2 * impl::pi : rl < -impl::pi ? -2 * impl::pi : 0;
+            pt += src[k].gyro.y * dt;
+            pt += (1 - alpha) * (p[k] * rad - pt);
+            x[k] = rl;
+            y[k] = pt;
+        }
+        const double *eul[] = {x, y};
+        impl::imu_dispatch<impl::imu_op::euler>(eul, outs, n);
+        impl::imu_store(r, p, i, dst, n);
+    }
+
+    double dt;
+    double alpha;
+    double rl = 0;      // Roll estimate in radians
+    double pt = 0;      // Pitch estimate in radians
+    bool init = false;
+};
+
+/**
+ * @brief Madgwick gradient descent orientation filter for gyroscope and
+ * accelerometer, see S. Madgwick, "An efficient orientation filter for
+ * inertial and inertial/magnetic sensor arrays". Quaternion recurrence is
+ * scalar, conversion to angles is vectorized.
+ *
+ */
+class imu_madgwick {
+public:
+    /**
+     * @brief Construct filter.
+     *
+     * @param dt Sample period in seconds
+     * @param beta Gradient step, larger converges faster to accelerometer
+     */
+    imu_madgwick(double dt, double beta = 0.1) : dt{dt}, beta{beta} {}
+
+    void reset() { init = false; }
+
+    /**
+     * @brief Current orientation quaternion w, x, y, z.
+     *
+     */
+    const double *quaternion() const { return q; }
+
+    /**
+     * @brief Filter samples from input ring to output ring, stops when input
+     * is empty or output is full, without allocation.
+     *
+     * @param in Samples
+     * @param out Angles
+     * @return Number of processed samples
+     */
+    template<size_t N, bool D1, size_t M, bool D2>
+    size_t process(ring<imu_sample, N, D1> &in, ring<imu_angles, M, D2> &out)
+    {
+        return impl::imu_run(in, out, [this](const imu_sample *src, imu_angles *dst, size_t n) {
+            chunk(src, dst, n);
+        });
+    }
+private:
+    /**
+     * @brief Start from accelerometer tilt with zero yaw, so output doesn't
+     * need to converge from identity.
+     *
+     */
+    void start(const imu_vec &a)
+    {
+        const double hr = std::atan2(a.y, a.z) / 2;
+        const double hp = std::atan2(-a.x, std::sqrt(a.y * a.y + a.z * a.z)) / 2;
+        const double cr = std::cos(hr), sr = std::sin(hr), cp = std::cos(hp), sp = std::sin(hp);
+        q[0] = cr * cp;
+        q[1] = sr * cp;
+        q[2] = cr * sp;
+        q[3] = -sr * sp;
+        init = true;
+    }
+
+    void update(const imu_sample &s)
+    {
+        double &q0 = q[0], &q1 = q[1], &q2 = q[2], &q3 = q[3];
+        const double gx = s.gyro.x, gy = s.gyro.y, gz = s.gyro.z;
+        double d0 = 0.5 * (-q1 * gx - q2 * gy - q3 * gz);
+        double d1 = 0.5 * (q0 * gx + q2 * gz - q3 * gy);
+        double d2 = 0.5 * (q0 * gy - q1 * gz + q3 * gx);
+        double d3 = 0.5 * (q0 * gz + q1 * gy - q2 * gx);
+
+        const double an = s.accel.x * s.accel.x + s.accel.y * s.accel.y + s.accel.z * s.accel.z;
+        if (an > 0) {
+            const double inv = 1 / std::sqrt(an);
+            const double ax = s.accel.x * inv, ay = s.accel.y * inv, az = s.accel.z * inv;
+            const double q00 = q0 * q0, q11 = q1 * q1, q22 = q2 * q2, q33 = q3 * q3;
+            double s0 = 4 * q0 * q22 + 2 * q2 * ax + 4 * q0 * q11 - 2 * q1 * ay;
+            double s1 = 4 * q1 * q33 - 2 * q3 * ax + 4 * q00 * q1 - 2 * q0 * ay - 4 * q1 + 8 * q1 * q11 + 8 * q1 * q22 + 4 * q1 * az;
+            double s2 = 4 * q00 * q2 + 2 * q0 * ax + 4 * q2 * q33 - 2 * q3 * ay - 4 * q2 + 8 * q2 * q11 + 8 * q2 * q22 + 4 * q2 * az;
+            double s3 = 4 * q11 * q3 - 2 * q1 * ax + 4 * q22 * q3 - 2 * q2 * ay;
+            const double sn = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+            const double k = sn > 0 ? beta / std::sqrt(sn) : 0;
+            d0 -= k * s0;
+            d1 -= k * s1;
+            d2 -= k * s2;
+            d3 -= k * s3;
+        }
+        q0 += d0 * dt;
+        q1 += d1 * dt;
+        q2 += d2 * dt;
+        q3 += d3 * dt;
+        const double inv = 1 / std::sqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+        q0 *= inv;
+        q1 *= inv;
+        q2 *= inv;
+        q3 *= inv;
+    }
+
+    void chunk(const imu_sample *src, imu_angles *dst, size_t n)
+    {
+        double w[impl::imu_chunk], x[impl::imu_chunk], y[impl::imu_chunk], z[impl::imu_chunk];
+        double r[impl::imu_chunk], p[impl::imu_chunk], i[impl::imu_chunk];
+        if (!init)
+            start(src[0].accel);
+        for (size_t k = 0; k < n; ++k) {
+            update(src[k]);
+            w[k] = q[0];
+            x[k] = q[1];
+            y[k] = q[2];
+            z[k] = q[3];
+        }
+        const double *ins[] = {w, x, y, z};
+        double *const outs[] = {r, p, i};
+        impl::imu_dispatch<impl::imu_op::quat>(ins, outs, n);
+        impl::imu_store(r, p, i, dst, n);
+    }
+
+    double dt;
+    double beta;
+    double q[4] = {1, 0, 0, 0};
+    bool init = false;
+};
+
+}
+
+#endif
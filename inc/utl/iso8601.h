@@ -0,0 +1,416 @@
+#ifndef UTL_ISO8601_H
+#define UTL_ISO8601_H
+
+#include "utl/time.h"
+
+namespace utl {
+
+/**
+ * @brief Point in time as seconds since epoch and nanoseconds fraction.
+ *
+ */
+struct timestamp {
+    int64_t sec;    // UTC seconds since epoch
+    uint32_t nsec;  // Nanoseconds – [0, 999999999]
+};
+
+namespace impl {
+
+// Pairs of decimal digits for every value in [0, 99].
+inline constexpr char digits2[] =
+    "00010203040506070809" "10111213141516171819" "20212223242526272829" "30313233343536373839" "40414243444546474849"
+    "50515253545556575859" "60616263646566676869" "70717273747576777879" "80818283848586878889" "90919293949596979899";
+
+/**
+ * @brief Load 1 to 8 bytes as little-endian integer. Compiler merges
+ * this into a single load for constant len.
+ *
+ * @param str Input
+ * @param len Number of bytes to load
+ * @return Loaded word
+ */
+constexpr uint64_t swar_load(const char *str, size_t len = 8)
+{
+    uint64_t x = 0;
+    for (size_t i = 0; i < len; ++i)
+        x |= uint64_t(uint8_t(str[i])) << (i * 8);
+    return x;
+}
+
+/**
+ * @brief Build mask with 0xff bytes where layout has '0' placeholder.
+ *
+ * @param layout Layout string of at least 8 characters
+ * @return Digit mask
+ */
+constexpr uint64_t swar_digit_mask(const char *layout)
+{
+    uint64_t x = 0;
+    for (size_t i = 0; i < 8; ++i)
+        x |= uint64_t(layout[i] == '0' ? 0xff : 0) << (i * 8);
+    return x;
+}
+
+/**
+ * @brief Replace non-digit positions by '0' and check that remaining
+ * bytes are all ASCII digits.
+ *
+ * @param x Loaded word
+ * @param mask Digit mask
+ * @return true if all masked bytes are digits
+ */
+constexpr bool swar_digits(uint64_t x, uint64_t mask)
+{
+    constexpr uint64_t ones = 0x0101010101010101;
+    const uint64_t d = (x & mask) | (ones * '0' & ~mask);
+    return ((d & ones * 0xf0) | (((d + ones * 0x06) & ones * 0xf0) >> 4)) == ones * 0x33;
+}
+
+/**
+ * @brief Convert each pair of adjacent ASCII digits at once. Byte i of
+ * result holds 10 * digit[i] + digit[i + 1], for every i.
+ *
+ * @param x Loaded word with digits validated
+ * @param mask Digit mask
+ * @return Word of two-digit values
+ */
+constexpr uint64_t swar_pairs(uint64_t x, uint64_t mask)
+{
+    const uint64_t v = (x & mask) - (0x3030303030303030 & mask);
+    return v * 10 + (v >> 8);
+}
+
+/**
+ * @brief Convert up to 8 leading ASCII digits of a word.
+ *
+ * @param x Loaded word
+ * @param n Number of digits - [1, 8]
+ * @return Integer value
+ */
+constexpr uint32_t swar_parse8(uint64_t x, size_t n)
+{
+    uint64_t v = (x - 0x3030303030303030) << (64 - n * 8);
+    v = (v * 10 + (v >> 8)) & 0x00ff00ff00ff00ff;
+    v = (v * 100 + (v >> 16)) & 0x0000ffff0000ffff;
+    v = (v * 10000 + (v >> 32)) & 0x00000000ffffffff;
+    return v;
+}
+
+/**
+ * @brief Count leading ASCII digits of a word.
+ *
+ * @param x Loaded word
+ * @return Number of digits - [0, 8]
+ */
+constexpr size_t swar_count_digits(uint64_t x)
+{
+    constexpr uint64_t ones = 0x0101010101010101;
+    // Zero bytes where digit, carry of +6 only spreads past a non-digit
+    const uint64_t t = ((x & ones * 0xf0) | (((x + ones * 0x06) & ones * 0xf0) >> 4)) ^ ones * 0x33;
+    const uint64_t y = (((t & ones * 0x7f) + ones * 0x7f) | t) & ones * 0x80;
+    if (!y)
+        return 8;
+#ifdef __GNUC__
+    return __builtin_ctzll(y) >> 3;
+#else
+    size_t n = 0;
+    while (!(y >> (n * 8 + 7) & 1))
+        ++n;
+    return n;
+#endif
+}
+
+/**
+ * @brief Write two decimal digits.
+ *
+ * @param dst Output
+ * @param v Value - [0, 99]
+ */
+constexpr void put2(char *dst, uint32_t v)
+{
+    dst[0] = digits2[v * 2];
+    dst[1] = digits2[v * 2 + 1];
+}
+
+/**
+ * @brief Write date prefix "YYYY-MM-DDT" of a day.
+ *
+ * @param dst Output of at least 11 characters
+ * @param days Days since epoch
+ */
+constexpr void put_date(char *dst, int32_t days)
+{
+    const civil d = days_to_civil(days);
+    put2(dst, d.year / 100 % 100);
+    put2(dst + 2, d.year % 100);
+    dst[4] = '-';
+    put2(dst + 5, d.month);
+    dst[7] = '-';
+    put2(dst + 8, d.day);
+    dst[10] = 'T';
+}
+
+/**
+ * @brief Write time of day "HH:MM:SS".
+ *
+ * @param dst Output of at least 8 characters
+ * @param sod Seconds since midnight
+ */
+constexpr void put_time(char *dst, uint32_t sod)
+{
+    put2(dst, sod / 3600);
+    dst[2] = ':';
+    put2(dst + 3, sod / 60 % 60);
+    dst[5] = ':';
+    put2(dst + 6, sod % 60);
+}
+
+/**
+ * @brief Write fraction and zone designator.
+ *
+ * @param dst Output
+ * @param nsec Nanoseconds
+ * @param frac Number of fraction digits - 0, 3, 6 or 9
+ * @param offset Zone offset in minutes, 0 writes 'Z'
+ * @return Number of written characters
+ */
+constexpr size_t put_tail(char *dst, uint32_t nsec, unsigned frac, int32_t offset)
+{
+    size_t pos = 0;
+    if (frac) {
+        dst[pos++] = '.';
+        uint32_t v = nsec / ipow<uint32_t>(10, 9 - frac);
+        unsigned i = frac;
+        for (; i >= 2; i -= 2, v /= 100)
+            put2(dst + pos + i - 2, v % 100);
+        if (i)
+            dst[pos] = '0' + v;
+        pos += frac;
+    }
+    if (!offset) {
+        dst[pos++] = 'Z';
+    } else {
+        uint32_t abs = offset < 0 ? -offset : offset;
+        dst[pos++] = offset < 0 ? '-' : '+';
+        put2(dst + pos, abs / 60);
+        dst[pos + 2] = ':';
+        put2(dst + pos + 3, abs % 60);
+        pos += 5;
+    }
+    return pos;
+}
+
+}
+
+// Maximum length of formatted timestamp: "YYYY-MM-DDTHH:MM:SS.fffffffff+HH:MM".
+inline constexpr size_t iso8601_max_len = 35;
+
+/**
+ * @brief Parse RFC 3339 timestamp "YYYY-MM-DDTHH:MM:SS[.f...](Z|+HH:MM|-HH:MM)".
+ * Separator 'T' can also be 't' or space, zone designator 'Z' can also be 'z'.
+ * Fixed part is validated and converted with a few word operations, fraction
+ * is converted 8 digits at a time and truncated to nanoseconds.
+ *
+ * @param str Input string
+ * @param len String length
+ * @param ts Output UTC timestamp
+ * @param offset Optional output zone offset in minutes
+ * @return Number of parsed characters, 0 if malformed
+ */
+constexpr size_t iso8601_parse(const char *str, size_t len, timestamp &ts, int32_t *offset = nullptr)
+{
+    using namespace impl;
+
+    if (!str || len < 20)
+        return 0;
+
+    // Digits are '0' in layouts, separators are compared as is, except 'T'
+    constexpr uint64_t mask_a = swar_digit_mask("0000-00-");
+    constexpr uint64_t mask_b = swar_digit_mask("00T00:00");
+    constexpr uint64_t mask_c = swar_digit_mask(":00-----") & 0xffffff;
+    constexpr uint64_t mask_t = 0xff0000;
+    constexpr uint64_t sep_a  = swar_load("0000-00-") & ~mask_a;
+    constexpr uint64_t sep_b  = swar_load("00T00:00") & ~mask_b & ~mask_t;
+    constexpr uint64_t sep_c  = swar_load(":00", 3) & ~mask_c;
+
+    const uint64_t a = swar_load(str);
+    const uint64_t b = swar_load(str + 8);
+    const uint64_t c = swar_load(str + 16, 3);
+    const uint8_t t = str[10];
+
+    if (!swar_digits(a, mask_a) ||
+        !swar_digits(b, mask_b) ||
+        !swar_digits(c, mask_c) ||
+        (a & ~mask_a) != sep_a ||
+        (b & ~mask_b & ~mask_t) != sep_b ||
+        (c & ~mask_c) != sep_c ||
+        ((t | 0x20) != 't' && t != ' '))
+        return 0;
+
+    const uint64_t pa = swar_pairs(a, mask_a);
+    const uint64_t pb = swar_pairs(b, mask_b);
+    const uint64_t pc = swar_pairs(c, mask_c);
+
+    const uint32_t year = uint8_t(pa) * 100 + uint8_t(pa >> 16);
+    const uint32_t mon  = uint8_t(pa >> 40);
+    const uint32_t day  = uint8_t(pb);
+    const uint32_t hour = uint8_t(pb >> 24);
+    const uint32_t min  = uint8_t(pb >> 48);
+    const uint32_t sec  = uint8_t(pc >> 8);
+
+    if (mon - 1 > 11 || day - 1 >= days_in_month(int32_t(year), mon) || hour > 23 || min > 59 || sec > 60)
+        return 0;
+
+    size_t pos = 19;
+    uint32_t nsec = 0;
+
+    if (str[pos] == '.') {
+        size_t digits = 0;
+        uint32_t scale = 1;
+        ++pos;
+        while (pos < len) {
+            size_t n = len - pos >= 8 ? swar_count_digits(swar_load(str + pos)) :
+                        uint8_t(str[pos] - '0') < 10;
+            if (!n)
+                break;
+            if (digits < 9) {
+                size_t take = n < 9 - digits ? n : 9 - digits;
+                uint32_t v = swar_parse8(swar_load(str + pos, take), take);
+                nsec = nsec * ipow<uint32_t>(10, take) + v;
+                digits += take;
+            }
+            pos += n;
+        }
+        if (!digits)
+            return 0;
+        for (size_t i = digits; i < 9; ++i)
+            scale *= 10;
+        nsec *= scale;
+    }
+    if (pos >= len)
+        return 0;
+
+    int32_t off = 0;
+
+    if ((str[pos] | 0x20) == 'z') {
+        pos += 1;
+    } else if (str[pos] == '+' || str[pos] == '-') {
+        if (len - pos < 6)
+            return 0;
+        const uint64_t o = swar_load(str + pos + 1, 5);
+        constexpr uint64_t mask_o = 0xffff00ffff;
+        if (!swar_digits(o, mask_o) || (o & ~mask_o) != uint64_t(':') << 16)
+            return 0;
+        const uint64_t po = swar_pairs(o, mask_o);
+        if (uint8_t(po) > 23 || uint8_t(po >> 24) > 59)
+            return 0;
+        off = uint8_t(po) * 60 + uint8_t(po >> 24);
+        off = str[pos] == '-' ? -off : off;
+        pos += 6;
+    } else {
+        return 0;
+    }
+
+    ts.sec  = int64_t(civil_to_days(year, mon, day)) * 86400 +
+              hour * 3600 + min * 60 + sec - off * 60;
+    ts.nsec = nsec;
+
+    if (offset)
+        *offset = off;
+
+    return pos;
+}
+
+/**
+ * @brief Parse RFC 3339 timestamp from string view.
+ *
+ * @param sv Input string view
+ * @param ts Output UTC timestamp
+ * @param offset Optional output zone offset in minutes
+ * @return Number of parsed characters, 0 if malformed
+ */
+constexpr size_t iso8601_parse(std::string_view sv, timestamp &ts, int32_t *offset = nullptr)
+{
+    return iso8601_parse(sv.data(), sv.size(), ts, offset);
+}
+
+/**
+ * @brief Format timestamp as RFC 3339 "YYYY-MM-DDTHH:MM:SS[.f](Z|+HH:MM)",
+ * without null-terminator. Years must be within [0, 9999].
+ *
+ * @param ts UTC timestamp
+ * @param str Output string
+ * @param max_len Output string maximum length
+ * @param frac Number of fraction digits - [0, 9]
+ * @param offset Zone offset in minutes to present local time in, 0 writes 'Z'
+ * @return Resulting string length, 0 if it doesn't fit
+ */
+constexpr size_t iso8601_format(timestamp ts, char *str, size_t max_len, unsigned frac = 0, int32_t offset = 0)
+{
+    if (!str || frac > 9 || max_len < 19 + (frac ? frac + 1 : 0) + (offset ? 6 : 1))
+        return 0;
+
+    const int64_t t     = ts.sec + offset * 60;
+    const int64_t days  = t / 86400 - (t % 86400 < 0);
+
+    impl::put_date(str, days);
+    impl::put_time(str + 11, t - days * 86400);
+
+    return 19 + impl::put_tail(str + 19, ts.nsec, frac, offset);
+}
+
+/**
+ * @brief Formatter for streams of mostly increasing timestamps. Keeps
+ * "YYYY-MM-DDTHH:MM:SS" of the last second and date part of the last day,
+ * so consecutive timestamps only render changed parts.
+ *
+ */
+struct iso8601_formatter {
+
+    /**
+     * @brief Construct formatter.
+     *
+     * @param frac Number of fraction digits - [0, 9]
+     * @param offset Zone offset in minutes, 0 writes 'Z'
+     */
+    constexpr iso8601_formatter(unsigned frac = 0, int32_t offset = 0) : frac{frac > 9 ? 9 : frac}, offset{offset} {}
+
+    /**
+     * @brief Format timestamp, same output as iso8601_format().
+     *
+     * @param ts UTC timestamp
+     * @param str Output string
+     * @param max_len Output string maximum length
+     * @return Resulting string length, 0 if it doesn't fit
+     */
+    constexpr size_t format(timestamp ts, char *str, size_t max_len)
+    {
+        if (!str || max_len < 19 + (frac ? frac + 1 : 0) + (offset ? 6 : 1))
+            return 0;
+
+        if (ts.sec != sec) {
+            const int64_t t     = ts.sec + offset * 60;
+            const int64_t days  = t / 86400 - (t % 86400 < 0);
+            if (days != day) {
+                impl::put_date(prefix, days);
+                day = days;
+            }
+            impl::put_time(prefix + 11, t - days * 86400);
+            sec = ts.sec;
+        }
+        for (size_t i = 0; i < sizeof(prefix); ++i)
+            str[i] = prefix[i];
+
+        return 19 + impl::put_tail(str + 19, ts.nsec, frac, offset);
+    }
+private:
+    unsigned frac;
+    int32_t offset;
+    int64_t sec = INT64_MIN;
+    int64_t day = INT64_MIN;
+    char prefix[19] = {};
+};
+
+}
+
+#endif
\ No newline at end of file
@@ -1,11 +1,79 @@
 #ifndef UTL_MATH_H
 #define UTL_MATH_H
 
-#include "utl/base.h"
+#include "utl/divide.h"
+#include "utl/table.h"
 
 namespace utl {
 namespace impl {
 inline constexpr double pi = 3.14159265358979323846; // M_PI isn't always defined
+
+inline constexpr auto gf_exp = gf_exp_table(); // Galois 2^8 field with polynomial 0x11d
+inline constexpr auto gf_log = gf_log_table();
+
+inline constexpr auto pow10_u64 = pow10_table<uint64_t, 20>();
+
+template<size_t Bytes>
+struct imap_wide {
+    typedef int64_t S;
+    typedef uint64_t U;
+};
+
+#ifdef __SIZEOF_INT128__
+template<>
+struct imap_wide<8> {
+    __extension__ typedef __int128 S;
+    __extension__ typedef unsigned __int128 U;
+};
+#endif
+
+/**
+ * @brief Integer range mapping. Result scaled by input span is computed
+ * exactly in double-width type and divided once, so it's truncated toward
+ * zero as if slope was infinitely precise. Unsigned results are never
+ * negative, so offset from out_min is floored instead.
+ *
+ * @tparam T Integer type
+ */
+template<class T>
+struct imap_range {
+    static_assert(sizeof(T) <= 4 || sizeof(typename imap_wide<sizeof(T)>::U) > 8, "64-bit imap needs 128-bit integers");
+    typedef typename imap_wide<sizeof(T)>::S S;
+    typedef typename imap_wide<sizeof(T)>::U U;
+
+    S in_min;
+    S out_min;
+    U in_span;
+    U out_span;
+    bool neg;
+
+    constexpr imap_range(T in_min, T in_max, T out_min, T out_max) :
+        in_min{S(in_min)}, out_min{S(out_min)},
+        in_span{mag(S(in_max) - S(in_min))}, out_span{mag(S(out_max) - S(out_min))},
+        neg{(in_max < in_min) != (out_max < out_min)} {}
+
+    static constexpr U mag(S x)
+    {
+        return x < 0 ? U(0) - U(x) : U(x);
+    }
+
+    template<class Div>
+    constexpr T operator()(T val, const Div &div) const
+    {
+        if (!in_span)
+            return T(out_min);
+        const S dv = S(val) - in_min;
+        const U num = mag(dv) * out_span;
+        const bool n = (dv < 0) != neg;
+        if constexpr (std::is_signed_v<T>) {
+            const U x = U(out_min) * in_span + (n ? U(0) - num : num); // Fits if result fits
+            return T(div(S(x)));
+        } else {
+            const U q = div(num);
+            return T(U(out_min) + (n ? U(0) - q - (q * in_span != num) : q));
+        }
+    }
+};
 }
 
 /**
@@ -23,7 +91,24 @@ constexpr T uceil(T dividend, T divisor)
 }
 
 /**
- * @brief Map integer from one range to another.
+ * @brief Unsigned integer division with round up by precomputed divisor.
+ * Unlike plain version, dividend near maximum doesn't overflow.
+ *
+ * @tparam T Unsigned integer type
+ * @param dividend Unsigned
+ * @param divisor Precomputed divider
+ * @return Quotient
+ */
+template<class T>
+constexpr T uceil(T dividend, const divider<T> &divisor)
+{
+    const T q = divisor.divide(dividend);
+    return q + (T(q * divisor.divisor()) != dividend);
+}
+
+/**
+ * @brief Map integer from one range to another. Integers are mapped
+ * without floating point, result is truncated toward zero.
  * 
  * @tparam T Integer type
  * @param val Input value
@@ -31,13 +116,47 @@ constexpr T uceil(T dividend, T divisor)
  * @param in_max Input maximum
  * @param out_min Output range minimum 
  * @param out_max Output range maximum
- * @return Result
+ * @return Result, out_min if input range is empty
  */
 template<class T>
 constexpr T imap(T val, T in_min, T in_max, T out_min, T out_max)
 {
-    double slope = 1.0 * (out_max - out_min) / (in_max - in_min);
-    return out_min + slope * (val - in_min);
+    if constexpr (std::is_integral_v<T>) {
+        const impl::imap_range<T> r(in_min, in_max, out_min, out_max);
+        return r(val, [&](auto x) { return x / decltype(x)(r.in_span); });
+    } else {
+        double slope = 1.0 * (out_max - out_min) / (in_max - in_min);
+        return out_min + slope * (val - in_min);
+    }
+}
+
+/**
+ * @brief Map array of integers from one range to another. Divisor is
+ * precomputed once, so each element costs a few multiplications.
+ * Output may be the same array as input.
+ *
+ * @tparam T Integer type
+ * @param src Input values
+ * @param dst Results
+ * @param n Number of elements
+ * @param in_min Input minimum
+ * @param in_max Input maximum
+ * @param out_min Output range minimum
+ * @param out_max Output range maximum
+ */
+template<class T>
+void imap(const T *src, T *dst, size_t n, T in_min, T in_max, T out_min, T out_max)
+{
+    const impl::imap_range<T> r(in_min, in_max, out_min, out_max);
+    if constexpr (sizeof(T) <= 4) {
+        typedef std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t> W;
+        const divider<W> div(W(r.in_span | !r.in_span));
+        for (size_t i = 0; i < n; ++i)
+            dst[i] = r(src[i], [&](W x) { return div.divide(x); });
+    } else {
+        for (size_t i = 0; i < n; ++i)
+            dst[i] = r(src[i], [&](auto x) { return x / decltype(x)(r.in_span); });
+    }
 }
 
 /**
@@ -63,6 +182,7 @@ constexpr T ipow(T base, T exp)
 
 /**
  * @brief Get length of integer in symbols. 10 => 2, 100 => 3, etc.
+ * Sign isn't counted. Estimated from bit length, corrected by table lookup.
  * 
  * @tparam T Integer type
  * @param val Integer value
@@ -71,12 +191,12 @@ constexpr T ipow(T base, T exp)
 template<class T>
 constexpr T ilen(T val)
 {
-    T l = !val;
-    while (val) { 
-        ++l; 
-        val /= 10; 
-    }
-    return l;
+    uint64_t u = uint64_t(val);
+    if constexpr (std::is_signed_v<T>)
+        u = val < 0 ? 0 - u : u;
+    u |= 1;
+    const unsigned t = (64 - impl::clz(u)) * 1233 >> 12;   // 1233 / 4096 ~ log10(2)
+    return T(t + (u >= impl::pow10_u64[t]));
 }
 
 /**
@@ -96,8 +216,8 @@ constexpr T fact(T x)
 }
 
 /**
- * @brief Galois 2^8 field multiplication using Russian 
- * Peasant Multiplication algorithm.
+ * @brief Galois 2^8 field multiplication with polynomial 0x11d,
+ * using logarithm tables.
  * 
  * @param x Multiplicand
  * @param y Multiplier
@@ -105,15 +225,42 @@ constexpr T fact(T x)
  */
 constexpr uint8_t gf_mul(uint8_t x, uint8_t y) 
 {
-    uint8_t r = 0; 
+    return x && y ? impl::gf_exp[impl::gf_log[x] + impl::gf_log[y]] : 0;
+}
 
-    while (y) {
-        if (y & 1)
-            r ^= x; 
-        x = (x << 1) ^ ((x >> 7) * 0x11d);
-        y >>= 1;
-    }
-    return r;
+/**
+ * @brief Galois 2^8 field multiplicative inverse.
+ * 
+ * @param x Argument, must be non-zero
+ * @return Inverse
+ */
+constexpr uint8_t gf_inv(uint8_t x)
+{
+    return impl::gf_exp[255 - impl::gf_log[x]];
+}
+
+/**
+ * @brief Galois 2^8 field division.
+ * 
+ * @param x Dividend
+ * @param y Divisor, must be non-zero
+ * @return Quotient
+ */
+constexpr uint8_t gf_div(uint8_t x, uint8_t y)
+{
+    return x ? impl::gf_exp[impl::gf_log[x] + 255 - impl::gf_log[y]] : 0;
+}
+
+/**
+ * @brief Galois 2^8 field power.
+ * 
+ * @param x Base
+ * @param n Exponent
+ * @return 'x' to the power 'n', 0^0 is 1
+ */
+constexpr uint8_t gf_pow(uint8_t x, unsigned n)
+{
+    return !n ? 1 : x ? impl::gf_exp[impl::gf_log[x] * (n % 255) % 255] : 0;
 }
 
 /**
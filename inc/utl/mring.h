@@ -0,0 +1,300 @@
+#ifndef UTL_MRING_H
+#define UTL_MRING_H
+
+#include "utl/base.h"
+#include <atomic>
+#include <cstring>
+#include <new>
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace utl {
+namespace impl {
+
+/**
+ * @brief First page of ring file. Indices are unmasked and only grow, so
+ * tail - head is the number of stored bytes, same as in utl::ring.
+ *
+ */
+struct mring_header {
+    static constexpr uint64_t signature = 0x31474e49524c5455;  // "UTLRING1"
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "indices are shared between processes");
+
+    uint64_t magic;
+    uint64_t capacity;
+    alignas(64) std::atomic<uint64_t> head;     // Written by consumer only
+    alignas(64) std::atomic<uint64_t> tail;     // Written by producer only
+};
+
+}
+
+/**
+ * @brief Byte ring buffer for single producer and single consumer, which
+ * may live in different processes. Data pages are mapped twice back to
+ * back, so any readable or writable region is contiguous in memory and
+ * wrap-around needs neither copies nor split messages. Indices live in a
+ * header page of the same memory file, so ring backed by regular file
+ * keeps its contents across restarts and crashes of either side. Linux
+ * only, elsewhere or when mapping fails the object is invalid.
+ *
+ */
+class mring {
+public:
+    struct from_fd_t {};
+    static constexpr from_fd_t from_fd{};
+
+    /**
+     * @brief Create anonymous ring in memfd, other processes can map
+     * it through fd() passed over Unix socket or inherited by fork().
+     *
+     * @param size Capacity in bytes, rounded up to power of 2 multiple of page size,
+     * ring is invalid above a quarter of address space
+     */
+    explicit mring(size_t size)
+    {
+#ifdef __linux__
+        open(memfd_create("utl_mring", MFD_CLOEXEC), size, true);
+#else
+        (void) size;
+#endif
+    }
+
+    /**
+     * @brief Map existing ring from its memory file descriptor, e.g. fd()
+     * of another process received over Unix socket. Descriptor is
+     * duplicated, so caller still owns and should close it. Ring is
+     * invalid if file doesn't contain initialized ring. Tagged, so
+     * integer sizes never pick this overload.
+     *
+     * @param fd Memory file descriptor
+     */
+    mring(from_fd_t, int fd)
+    {
+#ifdef __linux__
+        open(fd < 0 ? -1 : fcntl(fd, F_DUPFD_CLOEXEC, 0), 0, false);
+#else
+        (void) fd;
+#endif
+    }
+
+    /**
+     * @brief Open ring file or create it if it doesn't exist. Existing file
+     * keeps its capacity and contents. File should be created by one process
+     * before others open it.
+     *
+     * @param path File path
+     * @param size Capacity in bytes of new file, rounded same as above
+     */
+    mring(const char *path, size_t size)
+    {
+#ifdef __linux__
+        open(::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644), size, true);
+#else
+        (void) path, (void) size;
+#endif
+    }
+
+    mring(const mring&) = delete;
+    mring& operator=(const mring&) = delete;
+
+    ~mring()
+    {
+        close();
+    }
+
+    // Check if ring is mapped. Invalid ring is always empty and full.
+    bool valid() const                  { return hdr; }
+    // Memory file descriptor, -1 if invalid.
+    int fd() const                      { return file; }
+    size_t capacity() const             { return cap; }
+    size_t size() const                 { return hdr ? hdr->tail.load(std::memory_order_acquire) - hdr->head.load(std::memory_order_acquire) : 0; }
+    size_t space() const                { return cap - size(); }
+    bool empty() const                  { return !size(); }
+
+    /**
+     * @brief Get contiguous region to write into, publish it with commit().
+     * Producer only.
+     *
+     * @param len Number of bytes, at most capacity
+     * @return Region start, nullptr if there's less free space than len
+     */
+    uint8_t* prepare(size_t len)
+    {
+        if (!hdr)
+            return nullptr;
+        const uint64_t t = hdr->tail.load(std::memory_order_relaxed);
+        const uint64_t h = hdr->head.load(std::memory_order_acquire);
+        return len <= cap - (t - h) ? buf + (t & (cap - 1)) : nullptr;
+    }
+
+    /**
+     * @brief Make prepared bytes visible to consumer. Producer only.
+     *
+     * @param len Number of bytes, at most prepared length
+     */
+    void commit(size_t len)
+    {
+        if (hdr)
+            hdr->tail.store(hdr->tail.load(std::memory_order_relaxed) + len, std::memory_order_release);
+    }
+
+    /**
+     * @brief Get contiguous region of all readable bytes, release them
+     * with consume(). Consumer only.
+     *
+     * @param len Output number of readable bytes
+     * @return Region start, nullptr if ring is invalid
+     */
+    const uint8_t* peek(size_t &len) const
+    {
+        len = 0;
+        if (!hdr)
+            return nullptr;
+        const uint64_t h = hdr->head.load(std::memory_order_relaxed);
+        len = hdr->tail.load(std::memory_order_acquire) - h;
+        return buf + (h & (cap - 1));
+    }
+
+    /**
+     * @brief Release oldest bytes to producer. Consumer only.
+     *
+     * @param len Number of bytes, at most peeked length
+     */
+    void consume(size_t len)
+    {
+        if (hdr)
+            hdr->head.store(hdr->head.load(std::memory_order_relaxed) + len, std::memory_order_release);
+    }
+
+    /**
+     * @brief Copy bytes in, as many as fit. Producer only.
+     *
+     * @param src Input array
+     * @param len Input array length
+     * @return Number of bytes written
+     */
+    size_t write(const void *src, size_t len)
+    {
+        const size_t free = space();
+        len = len < free ? len : free;
+        if (!len)
+            return 0;
+        memcpy(prepare(len), src, len);
+        commit(len);
+        return len;
+    }
+
+    /**
+     * @brief Copy out up to len oldest bytes. Consumer only.
+     *
+     * @param dst Output array
+     * @param len Output array size
+     * @return Number of bytes read
+     */
+    size_t read(void *dst, size_t len)
+    {
+        size_t avail;
+        const uint8_t *src = peek(avail);
+        len = len < avail ? len : avail;
+        if (!len)
+            return 0;
+        memcpy(dst, src, len);
+        consume(len);
+        return len;
+    }
+
+    /**
+     * @brief Flush ring to its file, so contents survive system crash
+     * too, not only crash of the process.
+     *
+     * @return true on success
+     */
+    bool sync()
+    {
+#ifdef __linux__
+        return valid() && !msync(buf, cap, MS_SYNC) && !msync(hdr, page, MS_SYNC);
+#else
+        return false;
+#endif
+    }
+private:
+#ifdef __linux__
+    void open(int f, size_t size, bool create)
+    {
+        file = f;
+        if (file < 0)
+            return;
+        page = size_t(sysconf(_SC_PAGESIZE));
+        struct stat st;
+        if (fstat(file, &st))
+            return close();
+        const bool init = size_t(st.st_size) < page;
+        if (init && !create)
+            return close();
+        if (init) {
+            if (size > max_cap)
+                return close();
+            cap = page;
+            while (cap < size)
+                cap <<= 1;
+            if (ftruncate(file, off_t(page + cap)))
+                return close();
+        }
+        void *h = mmap(nullptr, page, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        if (h == MAP_FAILED)
+            return close();
+        hdr = static_cast<impl::mring_header*>(h);
+        if (init) {
+            new (&hdr->head) std::atomic<uint64_t>{0};
+            new (&hdr->tail) std::atomic<uint64_t>{0};
+            hdr->capacity = cap;
+            hdr->magic = impl::mring_header::signature;
+        } else {
+            cap = hdr->capacity;
+            if (hdr->magic != impl::mring_header::signature || cap < page || cap > max_cap || (cap & (cap - 1)) ||
+                (cap & (page - 1)) || size_t(st.st_size) < page + cap)
+                return close();
+        }
+        // Reserve address range, then put both views of data pages into it
+        void *base = mmap(nullptr, cap * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED)
+            return close();
+        buf = static_cast<uint8_t*>(base);
+        for (size_t i = 0; i < 2; ++i)
+            if (mmap(buf + i * cap, cap, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, file, off_t(page)) == MAP_FAILED)
+                return close();
+    }
+#endif
+
+    void close()
+    {
+#ifdef __linux__
+        if (buf)
+            munmap(buf, cap * 2);
+        if (hdr)
+            munmap(hdr, page);
+        if (file >= 0)
+            ::close(file);
+#endif
+        buf = nullptr;
+        hdr = nullptr;
+        file = -1;
+        cap = 0;
+    }
+
+    static constexpr size_t max_cap = SIZE_MAX / 4 + 1;   // Both views and file size still fit
+
+    impl::mring_header *hdr = nullptr;
+    uint8_t *buf = nullptr;
+    size_t cap = 0;
+    size_t page = 0;
+    int file = -1;
+};
+
+}
+
+#endif
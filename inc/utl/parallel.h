@@ -0,0 +1,429 @@
+#ifndef UTL_PARALLEL_H
+#define UTL_PARALLEL_H
+
+#include "utl/float.h"
+#include "utl/geo.h"
+#include "utl/str.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace utl {
+namespace impl {
+
+inline constexpr size_t par_max_chunks = size_t(1) << 31;   // Chunk index must fit 32 bits of task
+
+// Input bytes per chunk of bulk conversions. Chunks are also kept multiple
+// of widest vector, so results match serial calls bit-exactly.
+inline constexpr size_t par_grain_bytes = 64 * 1024;
+
+/**
+ * @brief Set while calling thread executes a parallel job, nested
+ * parallel calls then run serially instead of waiting for themselves.
+ *
+ */
+inline bool& par_inside()
+{
+    thread_local bool inside = false;
+    return inside;
+}
+
+/**
+ * @brief Chase-Lev work-stealing deque, see Lê et al. "Correct and Efficient
+ * Work-Stealing for Weak Memory Models". Owner pushes and pops at bottom,
+ * thieves steal from top. Task is a range of chunk indices packed into 64 bits,
+ * begin in high half, end in low half, 0 means empty. Ranges are split in
+ * halves before running, so deque holds at most log2(chunks) + 1 tasks and
+ * fixed capacity never overflows.
+ *
+ */
+class par_deque {
+public:
+    static constexpr int64_t capacity = 64;
+
+    void push(uint64_t task)
+    {
+        const int64_t b = bottom.load(std::memory_order_relaxed);
+        buf[b & (capacity - 1)].store(task, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    uint64_t pop()
+    {
+        const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        uint64_t task = 0;
+        if (t <= b) {
+            task = buf[b & (capacity - 1)].load(std::memory_order_relaxed);
+            if (t != b)
+                return task;
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                task = 0;   // Lost last task to thief
+        }
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return task;
+    }
+
+    uint64_t steal()
+    {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b)
+            return 0;
+        const uint64_t task = buf[t & (capacity - 1)].load(std::memory_order_relaxed);
+        return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed) ? task : 0;
+    }
+private:
+    alignas(64) std::atomic<int64_t> top{0};
+    alignas(64) std::atomic<int64_t> bottom{0};
+    alignas(64) std::atomic<uint64_t> buf[capacity] = {};
+};
+
+}
+
+/**
+ * @brief Work-stealing thread pool. Calling thread takes part in each job
+ * as worker 0. Range is cut into chunks of grain elements, each worker
+ * splits its range in halves, keeps running the lower half and leaves upper
+ * halves in its deque, where idle workers steal the largest ones. So load
+ * balances itself even if chunks take different time, and the only shared
+ * write per chunk is a single atomic decrement. Jobs from different
+ * threads are serialized, parallel calls from inside a job run serially.
+ * Functions passed to the pool must not throw.
+ *
+ */
+class thread_pool {
+public:
+    /**
+     * @brief Start worker threads.
+     *
+     * @param threads Number of workers including calling thread
+     */
+    explicit thread_pool(unsigned threads = std::thread::hardware_concurrency()) :
+        count{threads ? threads : 1}, deques{new impl::par_deque[count]}
+    {
+        workers.reserve(count - 1);
+        for (unsigned i = 1; i < count; ++i)
+            workers.emplace_back([this, i] { loop(i); });
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    ~thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock{mtx};
+            stop = true;
+        }
+        cv.notify_all();
+        for (auto &t : workers)
+            t.join();
+    }
+
+    /**
+     * @brief Pool shared by free parallel functions, one worker per hardware thread.
+     *
+     * @return Global pool
+     */
+    static thread_pool& global()
+    {
+        static thread_pool pool;
+        return pool;
+    }
+
+    /**
+     * @brief Number of workers including calling thread.
+     *
+     */
+    unsigned size() const
+    {
+        return count;
+    }
+
+    /**
+     * @brief Call fn(first, last) for consecutive subranges covering [begin, end),
+     * each grain elements long except the last one, in parallel. Returns when
+     * all are done.
+     *
+     * @param begin Range begin
+     * @param end Range end
+     * @param grain Subrange size, large enough to hide scheduling cost of about a microsecond
+     * @param fn Function of subrange
+     */
+    template<class Fn>
+    void parallel_for(size_t begin, size_t end, size_t grain, Fn &&fn)
+    {
+        run(begin, end, grain, [&](size_t b, size_t e, unsigned) { fn(b, e); });
+    }
+
+    /**
+     * @brief Reduce range in parallel. Each worker folds results of
+     * map(first, last) for its subranges, then worker results are folded in
+     * calling thread. Order of folding isn't fixed, so reduce must be
+     * associative and commutative.
+     *
+     * @param begin Range begin
+     * @param end Range end
+     * @param grain Subrange size
+     * @param identity Identity value of reduce, e.g. 0 for sum
+     * @param map Function of subrange returning T
+     * @param reduce Function of two T returning T
+     * @return Reduced value
+     */
+    template<class T, class Map, class Reduce>
+    T parallel_reduce(size_t begin, size_t end, size_t grain, T identity, Map &&map, Reduce &&reduce)
+    {
+        struct alignas(64) slot {
+            T val;
+        };
+        std::unique_ptr<slot[]> part{new slot[count]};
+        for (unsigned i = 0; i < count; ++i)
+            part[i].val = identity;
+        run(begin, end, grain, [&](size_t b, size_t e, unsigned w) { part[w].val = reduce(part[w].val, map(b, e)); });
+        for (unsigned i = 0; i < count; ++i)
+            identity = reduce(identity, part[i].val);
+        return identity;
+    }
+private:
+    struct job_t {
+        void (*fn)(void *ctx, size_t chunk, unsigned worker);
+        void *ctx;
+    };
+
+    template<class Fn>
+    void run(size_t begin, size_t end, size_t grain, Fn &&fn)
+    {
+        if (end <= begin)
+            return;
+        const size_t n = end - begin;
+        if (grain < (n - 1) / impl::par_max_chunks + 1)
+            grain = (n - 1) / impl::par_max_chunks + 1;
+        const size_t chunks = (n - 1) / grain + 1;
+        if (chunks == 1 || count == 1 || impl::par_inside()) {
+            for (; end - begin > grain; begin += grain)
+                fn(begin, begin + grain, 0);
+            return fn(begin, end, 0);
+        }
+
+        struct ctx_t {
+            Fn &fn;
+            size_t begin, end, grain;
+        } ctx{fn, begin, end, grain};
+        auto call = [](void *p, size_t c, unsigned w) {
+            auto &x = *static_cast<ctx_t*>(p);
+            const size_t b = x.begin + c * x.grain;
+            x.fn(b, x.end - b < x.grain ? x.end : b + x.grain, w);
+        };
+
+        std::lock_guard<std::mutex> serial{run_mtx};
+        remaining.store(chunks, std::memory_order_relaxed);
+        deques[0].push(chunks);     // [0, chunks)
+        {
+            std::lock_guard<std::mutex> lock{mtx};
+            job = {call, &ctx};
+            ++gen;
+        }
+        cv.notify_all();
+        impl::par_inside() = true;
+        work(0);
+        impl::par_inside() = false;
+        {
+            std::lock_guard<std::mutex> lock{mtx};
+            job.fn = nullptr;
+        }
+        while (busy.load(std::memory_order_acquire))    // Late workers may still probe deques
+            std::this_thread::yield();
+    }
+
+    void loop(unsigned w)
+    {
+        impl::par_inside() = true;
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock{mtx};
+        for (;;) {
+            cv.wait(lock, [&] { return stop || gen != seen; });
+            if (stop)
+                return;
+            seen = gen;
+            if (!job.fn)
+                continue;
+            busy.fetch_add(1, std::memory_order_relaxed);
+            lock.unlock();
+            work(w);
+            busy.fetch_sub(1, std::memory_order_release);
+            lock.lock();
+        }
+    }
+
+    void work(unsigned w)
+    {
+        uint32_t rnd = w * 0x9e3779b9 | 1;
+        while (remaining.load(std::memory_order_acquire)) {
+            uint64_t task = deques[w].pop();
+            if (!task) {
+                rnd ^= rnd << 13;
+                rnd ^= rnd >> 17;
+                rnd ^= rnd << 5;
+                const unsigned v = rnd % count;
+                if (v == w || !(task = deques[v].steal())) {
+                    std::this_thread::yield();
+                    continue;
+                }
+            }
+            uint32_t b = uint32_t(task >> 32), e = uint32_t(task);
+            while (e - b > 1) {
+                const uint32_t m = b + (e - b) / 2;
+                deques[w].push(uint64_t(m) << 32 | e);
+                e = m;
+            }
+            job.fn(job.ctx, b, w);
+            remaining.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+
+    const unsigned count;
+    std::unique_ptr<impl::par_deque[]> deques;
+    std::vector<std::thread> workers;
+    job_t job = {};
+    alignas(64) std::atomic<size_t> remaining{0};
+    std::atomic<unsigned> busy{0};
+    std::mutex run_mtx;
+    std::mutex mtx;
+    std::condition_variable cv;
+    uint64_t gen = 0;
+    bool stop = false;
+};
+
+/**
+ * @brief Parallel for on global pool, see thread_pool::parallel_for().
+ *
+ * @param begin Range begin
+ * @param end Range end
+ * @param grain Subrange size
+ * @param fn Function of subrange
+ */
+template<class Fn>
+inline void parallel_for(size_t begin, size_t end, size_t grain, Fn &&fn)
+{
+    thread_pool::global().parallel_for(begin, end, grain, std::forward<Fn>(fn));
+}
+
+/**
+ * @brief Parallel reduce on global pool, see thread_pool::parallel_reduce().
+ *
+ * @param begin Range begin
+ * @param end Range end
+ * @param grain Subrange size
+ * @param identity Identity value of reduce
+ * @param map Function of subrange returning T
+ * @param reduce Function of two T returning T
+ * @return Reduced value
+ */
+template<class T, class Map, class Reduce>
+inline T parallel_reduce(size_t begin, size_t end, size_t grain, T identity, Map &&map, Reduce &&reduce)
+{
+    return thread_pool::global().parallel_reduce(begin, end, grain, identity, std::forward<Map>(map), std::forward<Reduce>(reduce));
+}
+
+/**
+ * @brief Convert byte array to hexadecimal string on thread pool,
+ * result is the same as of serial bin_to_str().
+ *
+ * @param pool Thread pool
+ * @param bin Input array
+ * @param bin_len Input array length
+ * @param str Output string
+ * @param max_str_len Output string maximum length, including 0-terminator
+ * @return Resulting string length, 0 if failed
+ */
+inline size_t bin_to_str(thread_pool &pool, const uint8_t *bin, size_t bin_len, char *str, size_t max_str_len)
+{
+    if (!str || !bin || !bin_len || !max_str_len)
+        return 0;
+    if (bin_len >= max_str_len >> 1)
+        bin_len = (max_str_len - 1) >> 1;
+    pool.parallel_for(0, bin_len, impl::par_grain_bytes, [=](size_t b, size_t e) {
+        impl::hex_encode(bin + b, e - b, str + b * 2);
+    });
+    str[bin_len * 2] = 0;
+    return bin_len * 2;
+}
+
+/**
+ * @brief Convert array of floats to half precision on thread pool.
+ *
+ * @tparam Mode Overflow handling
+ * @param pool Thread pool
+ * @param src Input array
+ * @param dst Output array
+ * @param n Number of elements
+ */
+template<fp_mode Mode = fp_mode::nearest>
+inline void float_to_half(thread_pool &pool, const float *src, uint16_t *dst, size_t n)
+{
+    pool.parallel_for(0, n, impl::par_grain_bytes / sizeof(float), [=](size_t b, size_t e) {
+        float_to_half<Mode>(src + b, dst + b, e - b);
+    });
+}
+
+/**
+ * @brief Convert array of half precision floats to single precision on thread pool.
+ *
+ * @param pool Thread pool
+ * @param src Input array
+ * @param dst Output array
+ * @param n Number of elements
+ */
+inline void half_to_float(thread_pool &pool, const uint16_t *src, float *dst, size_t n)
+{
+    pool.parallel_for(0, n, impl::par_grain_bytes / sizeof(uint16_t), [=](size_t b, size_t e) {
+        half_to_float(src + b, dst + b, e - b);
+    });
+}
+
+/**
+ * @brief Distances in meters from one point to many on thread pool.
+ *
+ * @param pool Thread pool
+ * @param lat Latitude of first point
+ * @param lng Longitude of first point
+ * @param to Second points
+ * @param dst Output array of to.size() distances
+ * @param radius Sphere radius in meters
+ */
+inline void haversine(thread_pool &pool, double lat, double lng, const geo_points &to, double *dst, double radius = earth_radius)
+{
+    const double r_lat = radians(lat), r_lng = radians(lng), c_lat = fast_cos(r_lat);
+    pool.parallel_for(0, to.size(), impl::par_grain_bytes / (3 * sizeof(double)) & ~size_t(7), [&](size_t b, size_t e) {
+        impl::geo_dispatch<false>(&r_lat, &r_lng, &c_lat, to.lat() + b, to.lng() + b, to.cos_lat() + b, dst + b, e - b, radius);
+    });
+}
+
+/**
+ * @brief Distances in meters between pairs of points on thread pool.
+ *
+ * @param pool Thread pool
+ * @param from First points
+ * @param to Second points
+ * @param dst Output array of min(from.size(), to.size()) distances
+ * @param radius Sphere radius in meters
+ */
+inline void haversine(thread_pool &pool, const geo_points &from, const geo_points &to, double *dst, double radius = earth_radius)
+{
+    const size_t n = from.size() < to.size() ? from.size() : to.size();
+    pool.parallel_for(0, n, impl::par_grain_bytes / (6 * sizeof(double)) & ~size_t(7), [&](size_t b, size_t e) {
+        impl::geo_dispatch<true>(from.lat() + b, from.lng() + b, from.cos_lat() + b,
+                                 to.lat() + b, to.lng() + b, to.cos_lat() + b, dst + b, e - b, radius);
+    });
+}
+
+}
+
+#endif
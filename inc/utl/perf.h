@@ -0,0 +1,145 @@
+#ifndef UTL_PERF_H
+#define UTL_PERF_H
+
+#include "utl/base.h"
+#include <limits>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace utl {
+
+/**
+ * @brief Hardware counter values, either totals or per call. Counters
+ * which couldn't be opened (e.g. inside a container or on a CPU without
+ * PMU support) are NaN.
+ *
+ */
+struct perf_sample {
+    static constexpr double na = std::numeric_limits<double>::quiet_NaN();
+
+    double cycles           = na;
+    double instructions     = na;
+    double l1d_misses       = na;
+    double llc_misses       = na;
+    double branch_misses    = na;
+
+    // Instructions per cycle.
+    double ipc() const      { return instructions / cycles; }
+    // Check if at least cycle counter is available.
+    bool valid() const      { return cycles == cycles; }
+};
+
+/**
+ * @brief Group of hardware performance counters for calling thread, opened
+ * via Linux perf_event_open(). All counters are scheduled together, so their
+ * ratios are consistent. Values are scaled if kernel had to multiplex the
+ * group. On other systems, or when perf events are restricted, the object
+ * is simply invalid and produces NaN samples.
+ *
+ */
+struct perf_counters {
+    perf_counters()
+    {
+#ifdef __linux__
+        constexpr uint64_t l1d_miss =
+            PERF_COUNT_HW_CACHE_L1D |
+            PERF_COUNT_HW_CACHE_OP_READ << 8 |
+            PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+        const struct {
+            uint32_t type;
+            uint64_t config;
+        } events[cnt] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HW_CACHE, l1d_miss},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        };
+        for (size_t i = 0; i < cnt; ++i) {
+            perf_event_attr attr = {};
+            attr.size           = sizeof(attr);
+            attr.type           = events[i].type;
+            attr.config         = events[i].config;
+            attr.disabled       = !i;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv     = 1;
+            attr.read_format    =
+                PERF_FORMAT_GROUP |
+                PERF_FORMAT_TOTAL_TIME_ENABLED |
+                PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fd[i] = syscall(SYS_perf_event_open, &attr, 0, -1, i ? fd[0] : -1, 0);
+            if (fd[0] < 0)
+                return;
+        }
+#endif
+    }
+    ~perf_counters()
+    {
+#ifdef __linux__
+        for (int f : fd)
+            if (f >= 0)
+                close(f);
+#endif
+    }
+    perf_counters(const perf_counters&) = delete;
+    perf_counters& operator=(const perf_counters&) = delete;
+
+    // Check if counters are available.
+    bool valid() const { return fd[0] >= 0; }
+
+    /**
+     * @brief Reset and enable counting.
+     *
+     */
+    void start()
+    {
+#ifdef __linux__
+        if (!valid())
+            return;
+        ioctl(fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    /**
+     * @brief Disable counting and read values.
+     *
+     * @param calls Number of calls performed since start(), result is divided by it
+     * @return Counter values per call
+     */
+    perf_sample stop(size_t calls = 1)
+    {
+        perf_sample s;
+#ifdef __linux__
+        if (!valid())
+            return s;
+        ioctl(fd[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+        uint64_t buf[3 + cnt] = {}; // nr, time_enabled, time_running, values...
+
+        if (read(fd[0], buf, sizeof(buf)) < 0 || !buf[2] || !calls)
+            return s;
+
+        double scale = double(buf[1]) / buf[2] / calls;
+        double *dst[cnt] = {&s.cycles, &s.instructions, &s.l1d_misses, &s.llc_misses, &s.branch_misses};
+
+        for (size_t i = 0, j = 3; i < cnt && j < 3 + buf[0]; ++i)
+            if (fd[i] >= 0)
+                *dst[i] = buf[j++] * scale;
+#else
+        (void) calls;
+#endif
+        return s;
+    }
+private:
+    static constexpr size_t cnt = 5;
+    int fd[cnt] = {-1, -1, -1, -1, -1};
+};
+
+}
+
+#endif
\ No newline at end of file
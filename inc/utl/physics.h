@@ -1,11 +1,56 @@
 #ifndef UTL_PHYSICS_H
 #define UTL_PHYSICS_H
 
+#include "utl/fastmath.h"
 #include "utl/math.h"
 #include <cmath>
 
 namespace utl {
 
+inline constexpr double earth_radius = 6371000; // Mean radius in meters
+
+namespace impl {
+
+/**
+ * @brief Functions below are shared by precise and fast modes, public
+ * wrappers are plain functions, so their addresses can be taken.
+ *
+ * @tparam M Implementation of elementary functions
+ */
+template<math_mode M>
+inline double phys_haversine(double lat_1, double lng_1, double lat_2, double lng_2, double radius)
+{
+    typedef math_ops<M> op;
+    double s_lat = op::sin(radians(lat_2 - lat_1) / 2);
+    double s_lng = op::sin(radians(lng_2 - lng_1) / 2);
+    double a =  s_lat * s_lat +
+                s_lng * s_lng *
+                op::cos(radians(lat_1)) * 
+                op::cos(radians(lat_2));
+    double c = 2 * op::asin(std::sqrt(a));
+    return c * radius;
+}
+
+template<math_mode M>
+inline double phys_inclination(double x, double y, double z)
+{
+    return degrees(math_ops<M>::acos(z / std::sqrt(x * x + y * y + z * z)));
+}
+
+template<math_mode M>
+inline double phys_roll(double y, double z)
+{
+    return degrees(math_ops<M>::atan2(y, z));
+}
+
+template<math_mode M>
+inline double phys_pitch(double x, double y, double z)
+{
+    return degrees(math_ops<M>::atan2(-x, std::sqrt(y * y + z * z)));
+}
+
+}
+
 /**
  * @brief Calculate distance in meters on a sphere surface between 
  * two decimal degree points.
@@ -19,12 +64,7 @@ namespace utl {
  */
 inline double haversine(double lat_1, double lng_1, double lat_2, double lng_2, double radius)
 {
-    double a =  pow(sin(radians(lat_2 - lat_1) / 2), 2) +
-                pow(sin(radians(lng_2 - lng_1) / 2), 2) *
-                cos(radians(lat_1)) * 
-                cos(radians(lat_2));
-    double c = 2 * asin(sqrt(a));
-    return c * radius;
+    return impl::phys_haversine<math_mode::precise>(lat_1, lng_1, lat_2, lng_2, radius);
 }
 
 /**
@@ -39,7 +79,7 @@ inline double haversine(double lat_1, double lng_1, double lat_2, double lng_2,
  */
 inline double gcs_distance(double lat_1, double lng_1, double lat_2, double lng_2)
 {
-    return haversine(lat_1, lng_1, lat_2, lng_2, 6371000);
+    return haversine(lat_1, lng_1, lat_2, lng_2, earth_radius);
 }
 
 /**
@@ -52,7 +92,7 @@ inline double gcs_distance(double lat_1, double lng_1, double lat_2, double lng_
  */
 inline double inclination(double x, double y, double z)
 {
-    return degrees(acos(z / sqrt(x * x + y * y + z * z)));
+    return impl::phys_inclination<math_mode::precise>(x, y, z);
 }
 
 /**
@@ -64,7 +104,7 @@ inline double inclination(double x, double y, double z)
  */
 inline double roll(double y, double z)
 {
-    return degrees(atan2(y, z));
+    return impl::phys_roll<math_mode::precise>(y, z);
 }
 
 /**
@@ -77,9 +117,43 @@ inline double roll(double y, double z)
  */
 inline double pitch(double x, double y, double z)
 {
-    return degrees(atan2(-x, sqrt(y * y + z * z)));
+    return impl::phys_pitch<math_mode::precise>(x, y, z);
+}
+
+/**
+ * @brief Same as haversine() with polynomial approximations from
+ * "fastmath.h", which are within 2 ulp of libm.
+ *
+ */
+inline double fast_haversine(double lat_1, double lng_1, double lat_2, double lng_2, double radius)
+{
+    return impl::phys_haversine<math_mode::fast>(lat_1, lng_1, lat_2, lng_2, radius);
+}
+
+// Same as gcs_distance() with fast elementary functions.
+inline double fast_gcs_distance(double lat_1, double lng_1, double lat_2, double lng_2)
+{
+    return fast_haversine(lat_1, lng_1, lat_2, lng_2, earth_radius);
+}
+
+// Same as inclination() with fast elementary functions.
+inline double fast_inclination(double x, double y, double z)
+{
+    return impl::phys_inclination<math_mode::fast>(x, y, z);
+}
+
+// Same as roll() with fast elementary functions.
+inline double fast_roll(double y, double z)
+{
+    return impl::phys_roll<math_mode::fast>(y, z);
+}
+
+// Same as pitch() with fast elementary functions.
+inline double fast_pitch(double x, double y, double z)
+{
+    return impl::phys_pitch<math_mode::fast>(x, y, z);
 }
 
 }
 
-#endif
\ No newline at end of file
+#endif
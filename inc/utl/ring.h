@@ -18,20 +18,21 @@ struct ring {
 private:
     static constexpr size_t mask = N - 1;
     static_assert(N > 1 && !(mask & N), "ring_buf size must be > 1 and power of 2"); 
+    template<class U>
     struct iter {
-        iter(T *buf, size_t pos) : buf{buf}, pos{pos} {}
+        iter(U *buf, size_t pos) : buf{buf}, pos{pos} {}
         void operator++()                       { ++pos; }
         bool operator!=(const iter &rhs) const  { return pos != rhs.pos; }
-        T&   operator*()                        { return buf[pos & mask]; }
+        U&   operator*()                        { return buf[pos & mask]; }
     private:
-        T *buf;
+        U *buf;
         size_t pos;
     };
 public:
-    const iter begin() const            { return {buf, head}; }
-    const iter end() const              { return {buf, tail}; }
-    iter begin()                        { return {buf, head}; }
-    iter end()                          { return {buf, tail}; }
+    iter<const T> begin() const         { return {buf, head}; }
+    iter<const T> end() const           { return {buf, tail}; }
+    iter<T> begin()                     { return {buf, head}; }
+    iter<T> end()                       { return {buf, tail}; }
     const T& front() const              { return buf[head & mask]; }
     const T& back() const               { return buf[tail & mask]; }
     T& front()                          { return buf[head & mask]; }
@@ -65,6 +66,40 @@ public:
         pop(); 
         return true; 
     }
+    /**
+     * @brief Move up to len oldest items to array.
+     * 
+     * @param dst Output array
+     * @param len Output array size
+     * @return Number of items read
+     */
+    size_t read(T *dst, size_t len)
+    {
+        len = len < size() ? len : size();
+        for (size_t i = 0; i < len; ++i)
+            dst[i] = buf[(head + i) & mask];
+        head += len;
+        return len;
+    }
+    /**
+     * @brief Put array of items. When full, either oldest items are
+     * discarded or writing stops, same as put().
+     * 
+     * @param src Input array
+     * @param len Number of items
+     * @return Number of items written
+     */
+    size_t write(const T *src, size_t len)
+    {
+        if constexpr (!Discard)
+            len = len < N - size() ? len : N - size();
+        for (size_t i = 0; i < len; ++i)
+            buf[(tail + i) & mask] = src[i];
+        tail += len;
+        if (size() > N)
+            head = tail - N;
+        return len;
+    }
 private:
     storage<T, N> buf;
     size_t head = 0;   // First item index / beginning of the buffer.
@@ -0,0 +1,330 @@
+#ifndef UTL_SSTRING_H
+#define UTL_SSTRING_H
+
+#include "utl/str.h"
+#include <type_traits>
+
+namespace utl {
+namespace impl {
+
+/**
+ * @brief Power of 10 by squaring in long double, which keeps error far
+ * below double precision where long double is wider.
+ *
+ * @param k Exponent
+ * @return 10^k
+ */
+constexpr long double ld_pow10(unsigned k)
+{
+    long double r = 1, b = 10;
+    for (; k; k >>= 1, b *= b)
+        if (k & 1)
+            r *= b;
+    return r;
+}
+
+/**
+ * @brief Check sign bit, so -0.0 is negative, constant expression with GNU
+ * builtin, where 1 / x for zero isn't.
+ *
+ * @param x Value
+ * @return true if sign bit is set
+ */
+constexpr bool str_signbit(double x)
+{
+#ifdef __GNUC__
+    return __builtin_signbit(x);
+#else
+    return x < 0 || (x == 0 && 1 / x < 0);
+#endif
+}
+
+}
+
+/**
+ * @brief What to do with text that doesn't fit into fixed capacity string.
+ *
+ */
+enum class str_overflow {
+    truncate,   // Append as much as fits
+    reject,     // Append nothing, e.g. to keep numbers and keys whole
+};
+
+/**
+ * @brief Fixed capacity string with inline null-terminated buffer, usable
+ * in constexpr context. Trivially copyable, so can be stored in utl::ring
+ * and other raw containers, and building text never allocates. Text that
+ * doesn't fit is handled by Policy and sets truncated() flag.
+ *
+ * @tparam N Maximum length, without terminator
+ * @tparam Policy Overflow handling
+ */
+template<size_t N, str_overflow Policy = str_overflow::truncate>
+struct sstring : private impl::svector_base<char, N, ce_storage<char, N + 1>> {
+private:
+    typedef impl::svector_base<char, N, ce_storage<char, N + 1>> base;
+public:
+    constexpr sstring() = default;
+    constexpr sstring(std::string_view s)       { append(s); }
+    constexpr sstring(const char *s)            { append(std::string_view(s)); }
+
+    // Only read access, so terminator and truncated() flag stay right.
+    using base::capacity;
+    using base::size;
+    using base::empty;
+    using base::full;
+    constexpr const char* data() const          { return base::data(); }
+    constexpr const char& operator[](size_t i) const { return base::operator[](i); }
+    constexpr const char* begin() const         { return base::begin(); }
+    constexpr const char* end() const           { return base::end(); }
+
+    // Get contents as string view.
+    constexpr std::string_view view() const     { return {data(), size()}; }
+    constexpr operator std::string_view() const { return view(); }
+    // Get null-terminated contents.
+    constexpr const char* c_str() const         { return data(); }
+    // Check if some appended text didn't fit.
+    constexpr bool truncated() const            { return cut; }
+    // Get number of characters that can still be appended.
+    constexpr size_t space() const              { return N - size(); }
+
+    constexpr void clear()                      { base::clear(); cut = false; terminate(); }
+    constexpr void resize(size_t len)           { base::resize(len); terminate(); }
+    constexpr void pop_back()                   { base::pop_back(); terminate(); }
+    constexpr void push_back(char c)            { append(c); }
+
+    /**
+     * @brief Erase characters, keeping order of the rest.
+     *
+     * @param pos Index of first character
+     * @param count Number of characters, clamped to end of string
+     * @return This string
+     */
+    constexpr sstring& erase(size_t pos, size_t count = 1)
+    {
+        if (pos >= size())
+            return *this;
+        count = count < size() - pos ? count : size() - pos;
+        char *p = base::data();
+        for (size_t i = pos + count; i < size(); ++i)
+            p[i - count] = p[i];
+        base::resize(size() - count);
+        return terminate();
+    }
+
+    /**
+     * @brief Append character.
+     *
+     * @param c Character
+     * @return This string
+     */
+    constexpr sstring& append(char c)
+    {
+        if (!space())
+            return cut = true, *this;
+        base::push_back(c);
+        return terminate();
+    }
+
+    /**
+     * @brief Append text according to overflow policy.
+     *
+     * @param s Text
+     * @return This string
+     */
+    constexpr sstring& append(std::string_view s)
+    {
+        size_t len = s.size();
+        if (len > space()) {
+            cut = true;
+            len = Policy == str_overflow::truncate ? space() : 0;
+        }
+        char *p = base::data() + size();
+        for (size_t i = 0; i < len; ++i)
+            p[i] = s[i];
+        base::resize(size() + len);
+        return terminate();
+    }
+
+    /**
+     * @brief Append integer in decimal.
+     *
+     * @param x Integer
+     * @return This string
+     */
+    template<class T, class = std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, char> && !std::is_same_v<T, bool>>>
+    constexpr sstring& append(T x)
+    {
+        char buf[21] = {};
+        const bool neg = x < 0;
+        uint64_t u = neg ? 0 - uint64_t(x) : uint64_t(x);
+        size_t i = sizeof(buf);
+        do
+            buf[--i] = char('0' + u % 10);
+        while (u /= 10);
+        if (neg)
+            buf[--i] = '-';
+        return append(std::string_view(buf + i, sizeof(buf) - i));
+    }
+
+    /**
+     * @brief Append floating point value in fixed notation rounded to given
+     * digits after point, values of 1e18 and above in normalized exponent
+     * notation d.ddde+NN, like printf() %f and %e. Fixed notation keeps value
+     * with digits after point in 64 bits, so large values get fewer of them,
+     * e.g. 100000.0 keeps at most 14 digits after point. Large values
+     * are scaled once in long double, so with 17 significant digits the last
+     * one may be off by one. Meant for logs and keys, not for exact round trip.
+     *
+     * @param x Value
+     * @param prec Digits after point, at most 17 in fixed notation, fewer for
+     * large values, and 16 in exponent notation
+     * @return This string
+     */
+    constexpr sstring& append(double x, unsigned prec = 6)
+    {
+        if (x != x)
+            return append(std::string_view("nan"));
+        sstring<32, str_overflow::truncate> s;
+        if (impl::str_signbit(x)) {
+            s.append('-');
+            x = -x;
+        }
+        if (x > 1.7976931348623157e308)
+            return s.append(std::string_view("inf")), append(s.view());
+        if (x >= 1e18) {
+            prec = prec < 16 ? prec : 16;
+            // Scale once, so mantissa has prec + 1 digits, exponent estimate is corrected after rounding
+            int exp = 18;
+            double t = x / 1e18;
+            for (; t >= 1e10; t /= 1e10)
+                exp += 10;
+            for (; t >= 10; t /= 10)
+                ++exp;
+            const uint64_t lo = uint64_t(impl::pow10[prec]), hi = lo * 10;
+            uint64_t m = 0;
+            for (int i = 0; i < 2; ++i) {
+                m = uint64_t(x / impl::ld_pow10(unsigned(exp) - prec) + 0.5L);
+                if (m >= lo && m < hi)
+                    break;
+                exp += m >= hi ? 1 : -1;
+            }
+            s.append(char('0' + m / lo));
+            fraction(s, m % lo, prec);
+            s.append(std::string_view("e+")).append(exp);
+            return append(s.view());
+        }
+        prec = prec < 17 ? prec : 17;
+        while (prec && x * impl::pow10[prec] + 0.5 >= 18446744073709551616.0)  // Drop digits that don't fit
+            --prec;
+        const uint64_t scale = uint64_t(impl::pow10[prec]);
+        const uint64_t v = uint64_t(x * impl::pow10[prec] + 0.5);
+        s.append(v / scale);
+        fraction(s, v % scale, prec);
+        return append(s.view());
+    }
+
+    /**
+     * @brief Append integer in lowercase hexadecimal, padded to full width.
+     *
+     * @param x Unsigned integer
+     * @return This string
+     */
+    template<class T>
+    constexpr sstring& append_hex(T x)
+    {
+        static_assert(std::is_unsigned_v<T>, "T must be unsigned integer");
+        char buf[sizeof(T) * 2] = {};
+        for (size_t i = sizeof(buf); i--; x >>= 4)
+            buf[i] = bin_to_char(uint8_t(x));
+        return append(std::string_view(buf, sizeof(buf)));
+    }
+
+    /**
+     * @brief Append bytes in lowercase hexadecimal.
+     *
+     * @param bin Input array
+     * @param len Input array length
+     * @return This string
+     */
+    constexpr sstring& append_hex(const uint8_t *bin, size_t len)
+    {
+        if (len > space() / 2) {
+            cut = true;
+            if (Policy == str_overflow::reject)
+                return *this;
+        }
+        base::resize(size() + bin_to_str(bin, len, base::data() + size(), space() + 1));
+        return *this;
+    }
+
+    template<class T>
+    constexpr sstring& operator+=(const T &x)   { return append(x); }
+
+    template<size_t M, str_overflow P>
+    constexpr sstring& operator+=(const sstring<M, P> &s) { return append(s.view()); }
+private:
+    // Append point and digits after it with leading zeros.
+    template<class S>
+    static constexpr void fraction(S &s, uint64_t frac, unsigned prec)
+    {
+        if (!prec)
+            return;
+        s.append('.');
+        for (size_t i = size_t(ilen(frac | 1)); i < prec; ++i)
+            s.append('0');
+        s.append(frac);
+    }
+
+    constexpr sstring& terminate()
+    {
+        base::data()[size()] = 0;
+        return *this;
+    }
+
+    bool cut = false;
+};
+
+template<size_t L>
+sstring(const char (&)[L]) -> sstring<L - 1>;
+
+/**
+ * @brief Concatenate, capacity of result is sum of capacities,
+ * so nothing is truncated.
+ *
+ * @return New string
+ */
+template<size_t N, size_t M, str_overflow P, str_overflow Q>
+constexpr auto operator+(const sstring<N, P> &a, const sstring<M, Q> &b)
+{
+    sstring<N + M, P> s = a.view();
+    return s.append(b.view()), s;
+}
+
+/**
+ * @brief Append text to copy of string, according to its overflow policy.
+ *
+ * @return New string
+ */
+template<size_t N, str_overflow P>
+constexpr auto operator+(sstring<N, P> a, std::string_view b)
+{
+    return a.append(b), a;
+}
+
+template<size_t N, str_overflow P, size_t M, str_overflow Q>
+constexpr bool operator==(const sstring<N, P> &a, const sstring<M, Q> &b) { return a.view() == b.view(); }
+template<size_t N, str_overflow P>
+constexpr bool operator==(const sstring<N, P> &a, std::string_view b)   { return a.view() == b; }
+template<size_t N, str_overflow P>
+constexpr bool operator==(std::string_view a, const sstring<N, P> &b)   { return a == b.view(); }
+template<size_t N, str_overflow P, size_t M, str_overflow Q>
+constexpr bool operator!=(const sstring<N, P> &a, const sstring<M, Q> &b) { return !(a == b); }
+template<size_t N, str_overflow P>
+constexpr bool operator!=(const sstring<N, P> &a, std::string_view b)   { return !(a == b); }
+template<size_t N, str_overflow P>
+constexpr bool operator!=(std::string_view a, const sstring<N, P> &b)   { return !(a == b); }
+
+}
+
+#endif
@@ -1,11 +1,17 @@
 #ifndef UTL_STR_H
 #define UTL_STR_H
 
+#include "utl/cpu.h"
 #include "utl/math.h"
 #include "utl/svector.h"
 #include <string_view>
 
 namespace utl {
+namespace impl {
+inline constexpr auto hex_values = hex_value_table();
+inline constexpr auto hex_pairs = hex_pair_table();
+inline constexpr auto pow10 = pow10_table<double, 23>(); // Exact in double
+}
 
 /**
  * @brief Convert integer to hexadecimal character.
@@ -49,7 +55,9 @@ constexpr double str_to_dbl(const char *str, size_t len)
             dot = end - str - 1;
         }
     }
-    return res * neg / ipow(10, dot);
+    for (; dot > 22; dot -= 22)
+        res /= impl::pow10[22];
+    return res * neg / impl::pow10[dot];
 }
 
 /**
@@ -121,25 +129,6 @@ constexpr size_t str_to_bin(const char *str, size_t str_len, uint8_t *bin, size_
     if (!str || !bin)
         return 0;
 
-    // Mapping of ASCII characters to bin values
-    const uint8_t map[256] = {
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // ................
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // ................
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, //  !"#$%&'()*+,-./
-        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0123456789:;<=>?
-        0x00, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // @ABCDEFGHIJKLMNO
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // PQRSTUVWXYZ[\]^_
-        0x00, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // `abcdefghijklmno
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // pqrstuvwxyz{|}~.
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // ................
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // ................
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // ................
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // ................
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // ................
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // ................
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // ................
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // ................
-    };
     size_t i = 0; 
     size_t j = 0;
     size_t bin_len = (str_len + 1) >> 1; // The output array size is half the str length (rounded up)
@@ -149,18 +138,91 @@ constexpr size_t str_to_bin(const char *str, size_t str_len, uint8_t *bin, size_
         str_len = max_bin_len << 1; // return 0;
     }
     if (str_len & 1) {
-        int idx = str[0];
-        bin[0] = map[idx];
+        uint8_t idx = str[0];
+        bin[0] = impl::hex_values[idx];
         i = j = 1;
     }
     for (; i < str_len; i += 2, j++) {
-        int i0 = str[i];
-        int i1 = str[i + 1];
-        bin[j] = (map[i0] << 4) | map[i1];
+        uint8_t i0 = str[i];
+        uint8_t i1 = str[i + 1];
+        bin[j] = (impl::hex_values[i0] << 4) | impl::hex_values[i1];
     }
     return bin_len;
 }
 
+namespace impl {
+
+#ifdef UTL_CPU_DISPATCH
+/**
+ * @brief Vector hex encoding, nibbles index 16-byte digit table with pshufb,
+ * then high and low digits are interleaved.
+ *
+ * @return Number of bytes encoded, multiple of vector width
+ */
+__attribute__((target("ssse3")))
+inline size_t hex_encode_ssse3(const uint8_t *bin, size_t n, char *str)
+{
+    const __m128i digits = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    size_t i = 0;
+    for (const size_t m = n & ~size_t(15); i < m; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bin + i));
+        const __m128i hi = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(v, 4), mask));
+        const __m128i lo = _mm_shuffle_epi8(digits, _mm_and_si128(v, mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(str + i * 2), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(str + i * 2 + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+inline size_t hex_encode_avx2(const uint8_t *bin, size_t n, char *str)
+{
+    const __m256i digits = _mm256_broadcastsi128_si256(
+        _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'));
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    size_t i = 0;
+    for (const size_t m = n & ~size_t(31); i < m; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bin + i));
+        const __m256i hi = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(v, 4), mask));
+        const __m256i lo = _mm256_shuffle_epi8(digits, _mm256_and_si256(v, mask));
+        const __m256i a = _mm256_unpacklo_epi8(hi, lo);    // Bytes 0-7, 16-23
+        const __m256i b = _mm256_unpackhi_epi8(hi, lo);    // Bytes 8-15, 24-31
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(str + i * 2), _mm256_permute2x128_si256(a, b, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(str + i * 2 + 32), _mm256_permute2x128_si256(a, b, 0x31));
+    }
+    return i;
+}
+#endif
+
+/**
+ * @brief Encode bytes as lowercase hex digits without terminator,
+ * with SSSE3 or AVX2 when CPU has them.
+ *
+ * @param bin Input array
+ * @param n Input array length
+ * @param str Output of 2 * n characters
+ */
+constexpr void hex_encode(const uint8_t *bin, size_t n, char *str)
+{
+    size_t i = 0;
+#ifdef UTL_CPU_DISPATCH
+    if (!__builtin_is_constant_evaluated()) {
+        const uint32_t f = cpu_features();
+        if (f & cpu_avx2)
+            i = hex_encode_avx2(bin, n, str);
+        if (f & cpu_ssse3)
+            i += hex_encode_ssse3(bin + i, n - i, str + i * 2);
+    }
+#endif
+    for (; i < n; ++i) {
+        str[i * 2] = hex_pairs[bin[i]][0];
+        str[i * 2 + 1] = hex_pairs[bin[i]][1];
+    }
+}
+
+}
+
 /**
  * @brief Convert byte array to hexadecimal null-terminated string (lowercase).
  * If input is too large for output, as much bytes as possible will be processed.
@@ -183,11 +245,8 @@ constexpr size_t bin_to_str(const uint8_t *bin, size_t bin_len, char *str, size_
         bin_len = str_len >> 1;
     }
 
-    for (size_t i = 0; i < bin_len; ++i) {
-        *str++ = bin_to_char(bin[i] >> 4);
-        *str++ = bin_to_char(bin[i] & 0xf);
-    }
-    *str = 0;
+    impl::hex_encode(bin, bin_len, str);
+    str[str_len] = 0;
 
     return str_len;
 }
@@ -0,0 +1,174 @@
+#ifndef UTL_TABLE_H
+#define UTL_TABLE_H
+
+#include "utl/base.h"
+#include <array>
+#include <limits>
+#include <type_traits>
+
+namespace utl {
+
+/**
+ * @brief std::array aligned to cache line, so lookup tables don't straddle
+ * extra lines and can be loaded with aligned SIMD instructions.
+ *
+ * @tparam T Element type
+ * @tparam N Number of elements
+ */
+template<class T, size_t N>
+struct alignas(64) table : std::array<T, N> {};
+
+/**
+ * @brief Build lookup table at compile time. Generator is called with
+ * indices in ascending order on a single copy, so it may carry state
+ * from previous element, e.g. as mutable lambda.
+ *
+ * @tparam N Number of elements
+ * @param fn Generator with (size_t index) signature
+ * @return Table of generator results
+ */
+template<size_t N, class Fn>
+constexpr auto make_table(Fn fn)
+{
+    table<std::decay_t<decltype(fn(size_t{}))>, N> t = {};
+    for (size_t i = 0; i < N; ++i)
+        t[i] = fn(i);
+    return t;
+}
+
+/**
+ * @brief Exponents of generator 2 in Galois 2^8 field, doubled, so sum
+ * of two logarithms needs no reduction modulo 255.
+ *
+ * @tparam Poly Field polynomial
+ * @return Table of 512 elements
+ */
+template<unsigned Poly = 0x11d>
+constexpr auto gf_exp_table()
+{
+    return make_table<512>([x = 1u](size_t) mutable {
+        const uint8_t r = x;
+        x = (x << 1) ^ ((x >> 7) * Poly);
+        return r;
+    });
+}
+
+/**
+ * @brief Logarithms of generator 2 in Galois 2^8 field, log(0) is 0.
+ *
+ * @tparam Poly Field polynomial
+ * @return Table of 256 elements
+ */
+template<unsigned Poly = 0x11d>
+constexpr auto gf_log_table()
+{
+    const auto exp = gf_exp_table<Poly>();
+    table<uint8_t, 256> t = {};
+    for (unsigned i = 0; i < 255; ++i)
+        t[exp[i]] = i;
+    return t;
+}
+
+/**
+ * @brief Table for bytewise CRC computation.
+ *
+ * @tparam T Unsigned type as wide as CRC
+ * @tparam Poly Polynomial, bit-reversed if reflected
+ * @tparam Reflect Least significant bit first, e.g. CRC-32
+ * @return Table of 256 elements
+ */
+template<class T, T Poly, bool Reflect = true>
+constexpr auto crc_table()
+{
+    constexpr unsigned bits = sizeof(T) * 8;
+
+    return make_table<256>([](size_t i) {
+        T c = Reflect ? T(i) : T(T(i) << (bits - 8));
+        for (int k = 0; k < 8; ++k) {
+            if (Reflect)
+                c = c & 1 ? T(c >> 1) ^ Poly : T(c >> 1);
+            else
+                c = c >> (bits - 1) ? T(c << 1) ^ Poly : T(c << 1);
+        }
+        return c;
+    });
+}
+
+/**
+ * @brief Hexadecimal representation of every byte.
+ *
+ * @tparam Upper Use uppercase letters
+ * @return Table of 256 character pairs
+ */
+template<bool Upper = false>
+constexpr auto hex_pair_table()
+{
+    return make_table<256>([](size_t i) {
+        const char *digits = Upper ? "0123456789ABCDEF" : "0123456789abcdef";
+        return std::array<char, 2>{digits[i >> 4], digits[i & 0xf]};
+    });
+}
+
+/**
+ * @brief Values of ASCII hexadecimal digits of both cases, other
+ * characters map to 0.
+ *
+ * @return Table of 256 elements
+ */
+constexpr auto hex_value_table()
+{
+    return make_table<256>([](size_t c) {
+        return uint8_t(c >= '0' && c <= '9' ? c - '0' :
+            c >= 'a' && c <= 'f' ? c - 'a' + 10 :
+            c >= 'A' && c <= 'F' ? c - 'A' + 10 : 0);
+    });
+}
+
+/**
+ * @brief Powers of ten. Floating point entries are exact up to 1e22,
+ * larger accumulate rounding of repeated multiplication.
+ *
+ * @tparam T Arithmetic type
+ * @tparam N Number of elements, must not overflow T
+ * @return Table 10^0 ... 10^(N - 1)
+ */
+template<class T, size_t N>
+constexpr auto pow10_table()
+{
+    return make_table<N>([p = T(1)](size_t i) mutable {
+        if (i)
+            p *= 10;
+        return p;
+    });
+}
+
+/**
+ * @brief Quarter-wave sine table, sin(i * pi / 2N) for i in [0, N]. Cosine
+ * is the same table read backwards. Integer elements are scaled to largest
+ * value of the type, e.g. Q15 for int16_t.
+ *
+ * @tparam N Number of steps in quarter period
+ * @tparam T Floating point or integer type
+ * @return Table of N + 1 elements
+ */
+template<size_t N, class T = double>
+constexpr auto sin_table()
+{
+    return make_table<N + 1>([](size_t i) {
+        const double x = 1.57079632679489661923 * i / N;
+        double term = x;
+        double sum = x;
+        for (int k = 2; k < 40; k += 2) {
+            term *= -x * x / (k * (k + 1));
+            sum += term;
+        }
+        if constexpr (std::is_integral_v<T>)
+            return T(sum * std::numeric_limits<T>::max() + 0.5);
+        else
+            return T(sum);
+    });
+}
+
+}
+
+#endif
@@ -1,8 +1,14 @@
 #ifndef UTL_TIME_H
 #define UTL_TIME_H
 
+#include "utl/cpu.h"
 #include "utl/str.h"
+#include <chrono>
 #include <ctime>
+#ifdef UTL_CPU_X86
+#include <x86intrin.h>
+#define UTL_TSC 1
+#endif
 
 namespace utl {
 
@@ -78,6 +84,186 @@ clock_t m_exec_time_avg(Args &&...args)
     return m_exec_time<N>(args...) / N;
 }
 
+namespace impl {
+
+/**
+ * @brief Calibrated relation between ticks and steady clock.
+ * 
+ */
+struct tsc_calib {
+    uint64_t tsc0;  // Ticks at calibration
+    int64_t ns0;    // Steady clock nanoseconds at calibration
+    uint64_t mult;  // Nanoseconds per tick, 32.32 fixed point
+    bool tsc;       // TSC is used as tick source, otherwise ticks are steady clock nanoseconds
+};
+
+/**
+ * @brief Read steady clock.
+ * 
+ * @return Nanoseconds since steady clock epoch
+ */
+inline int64_t steady_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Check CPUID for invariant TSC, which runs at constant rate 
+ * regardless of frequency scaling and sleep states.
+ * 
+ * @return true if TSC is invariant
+ */
+inline bool tsc_invariant()
+{
+    unsigned r[4];
+    return impl::cpuid(0x80000007, 0, r) && (r[3] & (1u << 8));
+}
+
+/**
+ * @brief Measure TSC rate against CLOCK_MONOTONIC over 10 ms. Each end
+ * is sampled several times and the narrowest steady clock window wins,
+ * which keeps rate error within a few ppm.
+ * 
+ * @return Calibration, falls back to steady clock without invariant TSC
+ */
+inline tsc_calib tsc_calibrate()
+{
+    tsc_calib cal = {0, steady_ns(), uint64_t(1) << 32, false};
+#ifdef UTL_TSC
+    if (!tsc_invariant())
+        return cal;
+
+    auto sample = [](uint64_t &tsc, int64_t &ns) {
+        int64_t best = INT64_MAX;
+        for (int i = 0; i < 16; ++i) {
+            int64_t a = steady_ns();
+            uint64_t t = __rdtsc();
+            int64_t b = steady_ns();
+            if (b - a < best) {
+                best = b - a;
+                tsc = t;
+                ns = a + (b - a) / 2;
+            }
+        }
+    };
+    uint64_t t0 = 0, t1 = 0;
+    int64_t n0 = 0, n1 = 0;
+
+    sample(t0, n0);
+    while (steady_ns() - n0 < 10000000);
+    sample(t1, n1);
+
+    if (t1 > t0)
+        cal = {t0, n0, (uint64_t(n1 - n0) << 32) / (t1 - t0), true};
+#endif
+    return cal;
+}
+
+/**
+ * @brief Get process-wide calibration, performed on first use.
+ * 
+ * @return Calibration
+ */
+inline const tsc_calib& tsc()
+{
+    static const tsc_calib cal = tsc_calibrate();
+    return cal;
+}
+
+}
+
+/**
+ * @brief Nanosecond clock based on invariant TSC, calibrated once against 
+ * CLOCK_MONOTONIC and sharing its epoch, so time points are comparable with
+ * std::chrono::steady_clock. Reading costs a single rdtsc and fixed-point 
+ * multiply. Without invariant TSC it falls back to steady clock. Satisfies
+ * std::chrono Clock requirements.
+ * 
+ */
+struct tsc_clock {
+    using rep           = int64_t;
+    using period        = std::nano;
+    using duration      = std::chrono::nanoseconds;
+    using time_point    = std::chrono::time_point<tsc_clock>;
+
+    static constexpr bool is_steady = true;
+
+    // Check if TSC is used, otherwise steady clock is.
+    static bool is_tsc()    { return impl::tsc().tsc; }
+
+    /**
+     * @brief Read raw ticks, cheapest timestamp for measuring intervals.
+     * 
+     * @return TSC value or steady clock nanoseconds
+     */
+    static uint64_t ticks() noexcept
+    {
+#ifdef UTL_TSC
+        if (impl::tsc().tsc)
+            return __rdtsc();
+#endif
+        return impl::steady_ns();
+    }
+
+    /**
+     * @brief Convert tick interval to nanoseconds.
+     * 
+     * @param ticks Difference of two ticks() values
+     * @return Nanoseconds
+     */
+    static int64_t to_ns(uint64_t ticks) noexcept
+    {
+#ifdef UTL_TSC
+        auto &cal = impl::tsc();
+        if (cal.tsc) {
+            __extension__ using u128 = unsigned __int128;
+            return u128(ticks) * cal.mult >> 32;
+        }
+#endif
+        return ticks;
+    }
+
+    /**
+     * @brief Get current time.
+     * 
+     * @return Time point in steady clock epoch
+     */
+    static time_point now() noexcept
+    {
+        auto &cal = impl::tsc();
+        if (!cal.tsc)
+            return time_point(duration(impl::steady_ns()));
+        return time_point(duration(cal.ns0 + to_ns(ticks() - cal.tsc0)));
+    }
+};
+
+/**
+ * @brief Per-thread cached time for timeouts and coarse timestamps. 
+ * Reading is a thread-local load, value changes only on update(),
+ * which event loops should call once per iteration.
+ * 
+ */
+struct coarse_clock {
+    using rep           = tsc_clock::rep;
+    using period        = tsc_clock::period;
+    using duration      = tsc_clock::duration;
+    using time_point    = tsc_clock::time_point;
+
+    static constexpr bool is_steady = true;
+
+    // Get cached time of calling thread.
+    static time_point now() noexcept    { return cached(); }
+    // Refresh cached time of calling thread and return it.
+    static time_point update() noexcept { return cached() = tsc_clock::now(); }
+private:
+    static time_point& cached() noexcept
+    {
+        thread_local time_point t = tsc_clock::now();
+        return t;
+    }
+};
+
 /**
  * @brief Calculate seconds since epoch without timezone correction, 
  * using days since January 1 instead of month and month day.
@@ -96,9 +282,107 @@ constexpr int64_t timeutc(int64_t year, int64_t yday, int64_t hour, int64_t min,
     ((year - 1) / 100) * 86400 + ((year + 299) / 400) * 86400;
 }
 
+namespace impl {
+
+// Neri-Schneider algorithms work on unsigned computational calendar, which starts
+// on March 1 and is shifted by whole 400-year cycles to keep all values positive.
+inline constexpr uint32_t civil_s = 82;                             // Number of shifted 400-year cycles
+inline constexpr uint32_t civil_k = 719468 + 146097 * civil_s;      // Day offset of the epoch
+inline constexpr uint32_t civil_l = 400 * civil_s;                  // Year offset
+inline constexpr uint64_t civil_batch_off = 62135596800;            // Seconds from 0001-01-01 to the epoch
+
+}
+
+/**
+ * @brief Proleptic Gregorian calendar date.
+ * 
+ */
+struct civil {
+    int32_t year;   // Full year, e.g. 2024
+    uint32_t month; // Month – [1, 12]
+    uint32_t day;   // Day of the month – [1, 31]
+};
+
+/**
+ * @brief Convert calendar date to days since epoch, branchless 
+ * Neri-Schneider algorithm. Valid for years [-32800, 1000000].
+ * 
+ * @param year Full year, e.g. 2024
+ * @param month Month – [1, 12]
+ * @param day Day of the month – [1, 31]
+ * @return Days since 1970-01-01, negative before
+ */
+constexpr int32_t civil_to_days(int32_t year, uint32_t month, uint32_t day)
+{
+    using namespace impl;
+
+    const uint32_t j        = month <= 2;
+    const uint32_t y        = uint32_t(year) + civil_l - j;
+    const uint32_t m        = month + 12 * j;
+    const uint32_t c        = y / 100;
+    const uint32_t y_days   = 1461 * y / 4 - c + c / 4;
+    const uint32_t m_days   = (979 * m - 2919) / 32;
+
+    return int32_t(y_days + m_days + day - 1 - civil_k);
+}
+
+/**
+ * @brief Convert days since epoch to calendar date, branchless 
+ * Neri-Schneider algorithm. Valid for years [-32800, 1000000].
+ * 
+ * @param days Days since 1970-01-01, negative before
+ * @return Calendar date
+ */
+constexpr civil days_to_civil(int32_t days)
+{
+    using namespace impl;
+
+    const uint32_t n        = uint32_t(days) + civil_k;
+    const uint32_t n1       = 4 * n + 3;
+    const uint32_t c        = n1 / 146097;
+    const uint32_t nc       = n1 % 146097 / 4;
+    const uint32_t n2       = 4 * nc + 3;
+    const uint64_t p2       = uint64_t(2939745) * n2;
+    const uint32_t z        = uint32_t(p2 >> 32);
+    const uint32_t ny       = uint32_t(p2) / 2939745 / 4;
+    const uint32_t y        = 100 * c + z;
+    const uint32_t n3       = 2141 * ny + 197913;
+    const uint32_t m        = n3 >> 16;
+    const uint32_t d        = (n3 & 0xffff) / 2141;
+    const uint32_t j        = ny >= 306;
+
+    return {int32_t(y - civil_l + j), m - 12 * j, d + 1};
+}
+
+/**
+ * @brief Check if year is leap in proleptic Gregorian calendar.
+ * 
+ * @param year Full year
+ * @return true if leap
+ */
+constexpr bool is_leap(int32_t year)
+{
+    // Divisible by 100 means it's enough to check divisibility of 16 instead of 400
+    return year & (year % 100 ? 3 : 15) ? false : true;
+}
+
+/**
+ * @brief Get number of days in a month of proleptic Gregorian calendar.
+ * 
+ * @param year Full year
+ * @param month Month – [1, 12]
+ * @return Days in month
+ */
+constexpr uint32_t days_in_month(int32_t year, uint32_t month)
+{
+    // Months after February alternate 31 and 30 days, restarting in August
+    return month == 2 ? 28 + is_leap(year) : 30 + ((month ^ (month >> 3)) & 1);
+}
+
 /**
  * @brief Calculate seconds since epoch without timezone correction,
  * using month and month day instead of days since January 1.
+ * Leap years are taken into account.
  * 
  * @param year Years since 1900
  * @param month Months since January – [0, 11]
@@ -112,15 +396,8 @@ constexpr int64_t timeutc(int64_t year, int64_t month, int64_t mday, int64_t hou
 {
     if (month < 0 || month > 11)
         return 0;
-    constexpr int64_t days[] = {
-        31, 28, 31, 30, 
-        31, 30, 31, 31, 
-        30, 31, 30, 31
-    };
-    int64_t yday = mday - 1;
-    for (int i = 0; i < month; ++i)
-        yday += days[i];
-    return timeutc(year, yday, hour, min, sec);
+    return sec + min * 60 + hour * 3600 + 
+        int64_t(civil_to_days(year + 1900, month + 1, mday)) * 86400;
 }
 
 /**
@@ -137,6 +414,98 @@ constexpr int64_t timeutc(const tm &utc)
         timeutc(utc.tm_year, utc.tm_yday, utc.tm_hour, utc.tm_min, utc.tm_sec);
 }
 
+/**
+ * @brief Convert seconds since epoch to broken down UTC time, as gmtime_r()
+ * but without locks, timezone state or errors.
+ * 
+ * @param t UTC timestamp
+ * @return Standard date-time structure
+ */
+constexpr tm utctime(int64_t t)
+{
+    const int64_t days  = t / 86400 - (t % 86400 < 0);
+    const int64_t sod   = t - days * 86400;
+    const civil date    = days_to_civil(days);
+
+    tm utc = {};
+
+    utc.tm_year = date.year - 1900;
+    utc.tm_mon  = date.month - 1;
+    utc.tm_mday = date.day;
+    utc.tm_hour = sod / 3600;
+    utc.tm_min  = sod / 60 % 60;
+    utc.tm_sec  = sod % 60;
+    utc.tm_wday = (uint32_t(days) + impl::civil_k + 3) % 7;
+    utc.tm_yday = days - civil_to_days(date.year, 1, 1);
+
+    return utc;
+}
+
+/**
+ * @brief Convert array of days since epoch to calendar dates. 
+ * Auto-vectorizes with -O3.
+ * 
+ * @param days Input days since 1970-01-01
+ * @param date Output dates
+ * @param n Number of elements
+ */
+inline void days_to_civil(const int32_t *days, civil *date, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        date[i] = days_to_civil(days[i]);
+}
+
+/**
+ * @brief Convert array of calendar dates to days since epoch.
+ * Auto-vectorizes with -O3.
+ * 
+ * @param date Input dates
+ * @param days Output days since 1970-01-01
+ * @param n Number of elements
+ */
+inline void civil_to_days(const civil *date, int32_t *days, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        days[i] = civil_to_days(date[i].year, date[i].month, date[i].day);
+}
+
+/**
+ * @brief Convert array of timestamps to calendar dates and seconds since
+ * midnight. Day split uses 32-bit magic division, so timestamps must be
+ * within years [1, 8700]. Auto-vectorizes with -O3.
+ * 
+ * @param t Input UTC timestamps
+ * @param date Output dates
+ * @param sod Output seconds since midnight
+ * @param n Number of elements
+ */
+inline void utc_to_civil(const int64_t *t, civil *date, uint32_t *sod, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) {
+        // 86400 = 2^7 * 675, shifted value fits 31 bits, so division by 675 is a multiply
+        const uint64_t u    = t[i] + impl::civil_batch_off;
+        const uint64_t d    = ((u >> 7) * 3257812231) >> 41;
+        const int32_t days  = int32_t(d) - int32_t(impl::civil_batch_off / 86400);
+        sod[i]  = uint32_t(u - d * 86400);
+        date[i] = days_to_civil(days);
+    }
+}
+
+/**
+ * @brief Convert array of calendar dates and seconds since midnight to 
+ * timestamps. Auto-vectorizes with -O3.
+ * 
+ * @param date Input dates
+ * @param sod Input seconds since midnight
+ * @param t Output UTC timestamps
+ * @param n Number of elements
+ */
+inline void civil_to_utc(const civil *date, const uint32_t *sod, int64_t *t, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        t[i] = int64_t(civil_to_days(date[i].year, date[i].month, date[i].day)) * 86400 + sod[i];
+}
+
 /**
  * @brief Get date and time when the code was compiled as tm struct.
  * 
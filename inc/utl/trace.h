@@ -0,0 +1,206 @@
+#ifndef UTL_TRACE_H
+#define UTL_TRACE_H
+
+#include "utl/ring.h"
+#include "utl/time.h"
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifndef UTL_TRACE_CAPACITY
+#define UTL_TRACE_CAPACITY 4096 // Events kept per thread, must be power of 2
+#endif
+
+#define UTL_TRACE_CAT_(a, b) a##b
+#define UTL_TRACE_CAT(a, b) UTL_TRACE_CAT_(a, b)
+#ifdef __COUNTER__
+#define UTL_TRACE_ID __COUNTER__    // Unique even for several zones on one line
+#else
+#define UTL_TRACE_ID __LINE__
+#endif
+
+/**
+ * @brief Record duration of enclosing scope under given static name.
+ * Compiles to nothing unless UTL_TRACE is defined.
+ *
+ */
+#ifdef UTL_TRACE
+#define UTL_ZONE(name) UTL_ZONE_(name, UTL_TRACE_ID)
+#define UTL_ZONE_(name, id) \
+    static constexpr ::utl::trace_site UTL_TRACE_CAT(utl_site_, id) = {name, __FILE__, __LINE__}; \
+    const ::utl::trace_zone UTL_TRACE_CAT(utl_zone_, id){UTL_TRACE_CAT(utl_site_, id)}
+#else
+#define UTL_ZONE(name) static_cast<void>(0)
+#endif
+
+namespace utl {
+
+/**
+ * @brief Static description of a trace zone, its address serves as name id.
+ *
+ */
+struct trace_site {
+    const char *name;
+    const char *file;
+    int line;
+};
+
+/**
+ * @brief Single completed zone.
+ *
+ */
+struct trace_event {
+    const trace_site *site;
+    uint64_t begin;     // tsc_clock ticks at zone entry
+    uint64_t end;       // tsc_clock ticks at zone exit
+};
+
+namespace impl {
+
+inline constexpr size_t trace_batch = 64;   // Events copied out per lock while draining
+
+/**
+ * @brief Per-thread event buffer. Lock is taken by owner thread on each
+ * event and by collector only to copy out a small batch, callbacks run
+ * without it, so it's practically uncontended.
+ *
+ */
+struct trace_buffer {
+    void put(const trace_event &ev)
+    {
+        while (lock.test_and_set(std::memory_order_acquire));
+        events.put(ev);
+        lock.clear(std::memory_order_release);
+    }
+    template<class Fn>
+    size_t drain(Fn &&fn)
+    {
+        trace_event batch[trace_batch];
+        size_t cnt = 0, n;
+        do {    // Bounded, so thread recording nonstop can't stall collector
+            while (lock.test_and_set(std::memory_order_acquire));
+            n = events.read(batch, trace_batch);
+            lock.clear(std::memory_order_release);
+            for (size_t i = 0; i < n; ++i)
+                fn(tid, batch[i]);
+            cnt += n;
+        } while (n == trace_batch && cnt < UTL_TRACE_CAPACITY);
+        return cnt;
+    }
+    uint32_t tid = 0;
+private:
+    std::atomic_flag lock = ATOMIC_FLAG_INIT;
+    ring<trace_event, UTL_TRACE_CAPACITY, true> events;
+};
+
+/**
+ * @brief Owner of all thread buffers. Buffers are never released, so
+ * events of finished threads can still be collected.
+ *
+ */
+struct trace_registry {
+    static trace_registry& get()
+    {
+        static trace_registry reg;
+        return reg;
+    }
+    trace_buffer* add()
+    {
+        std::lock_guard<std::mutex> lock{mtx};
+        buffers.push_back(std::make_unique<trace_buffer>());
+        buffers.back()->tid = buffers.size();
+        return buffers.back().get();
+    }
+    template<class Fn>
+    size_t drain(Fn &&fn)
+    {
+        std::lock_guard<std::mutex> lock{mtx};
+        size_t cnt = 0;
+        for (auto &buf : buffers)
+            cnt += buf->drain(fn);
+        return cnt;
+    }
+    const uint64_t origin = tsc_clock::ticks();
+private:
+    std::mutex mtx;
+    std::vector<std::unique_ptr<trace_buffer>> buffers;
+};
+
+/**
+ * @brief Get buffer of calling thread, registering it on first use.
+ *
+ * @return Thread buffer
+ */
+inline trace_buffer& trace_local()
+{
+    thread_local trace_buffer *buf = trace_registry::get().add();
+    return *buf;
+}
+
+}
+
+/**
+ * @brief RAII zone, records entry and exit timestamps into buffer of
+ * the calling thread. Use through UTL_ZONE() macro.
+ *
+ */
+struct trace_zone {
+    explicit trace_zone(const trace_site &site) : buf{&impl::trace_local()}, site{&site}, begin{tsc_clock::ticks()} {}
+    ~trace_zone() { buf->put({site, begin, tsc_clock::ticks()}); }
+    trace_zone(const trace_zone&) = delete;
+    trace_zone& operator=(const trace_zone&) = delete;
+private:
+    impl::trace_buffer *buf;
+    const trace_site *site;
+    uint64_t begin;
+};
+
+/**
+ * @brief Drain events of all threads. Oldest events are dropped if
+ * a thread records more than UTL_TRACE_CAPACITY between drains.
+ *
+ * @tparam Fn Callable with (uint32_t tid, const trace_event &ev) signature
+ * @param fn Callback for each event
+ * @return Number of drained events
+ */
+template<class Fn>
+size_t trace_drain(Fn &&fn)
+{
+    return impl::trace_registry::get().drain(fn);
+}
+
+/**
+ * @brief Drain events of all threads and write them as Chrome trace JSON,
+ * loadable by chrome://tracing and Perfetto UI.
+ *
+ * @param f Output file
+ * @return Number of written events
+ */
+inline size_t trace_export(FILE *f)
+{
+    const uint64_t origin = impl::trace_registry::get().origin;
+    const char *sep = "";
+
+    fprintf(f, "{\"traceEvents\":[");
+
+    size_t cnt = trace_drain([&](uint32_t tid, const trace_event &ev) {
+        fprintf(f, "%s\n{\"name\":\"", sep);
+        for (auto p = ev.site->name; *p; ++p) {
+            if (*p == '"' || *p == '\\')
+                fputc('\\', f);
+            fputc(*p, f);
+        }
+        fprintf(f, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+            tid, tsc_clock::to_ns(ev.begin - origin) / 1e3, tsc_clock::to_ns(ev.end - ev.begin) / 1e3);
+        sep = ",";
+    });
+    fprintf(f, "\n],\"displayTimeUnit\":\"ns\"}\n");
+
+    return cnt;
+}
+
+}
+
+#endif
\ No newline at end of file
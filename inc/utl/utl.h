@@ -1,10 +1,26 @@
 #ifndef UTL_UTL_H
 #define UTL_UTL_H
 
+#include "utl/bench.h"
+#include "utl/cbor.h"
+#include "utl/cpu.h"
+#include "utl/crc.h"
+#include "utl/fastmath.h"
+#include "utl/fixed.h"
 #include "utl/float.h"
+#include "utl/geo.h"
+#include "utl/gf.h"
+#include "utl/histogram.h"
+#include "utl/imu.h"
+#include "utl/iso8601.h"
 #include "utl/log.h"
+#include "utl/mring.h"
+#include "utl/parallel.h"
 #include "utl/physics.h"
 #include "utl/ring.h"
+#include "utl/sstring.h"
 #include "utl/time.h"
+#include "utl/wide.h"
+#include "utl/window.h"
 
 #endif
\ No newline at end of file
@@ -0,0 +1,537 @@
+#ifndef UTL_WIDE_H
+#define UTL_WIDE_H
+
+#include "utl/str.h"
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define UTL_WIDE_X86 1
+#endif
+
+namespace utl {
+namespace impl {
+
+inline constexpr size_t karatsuba_words = 8; // Smaller products are faster with schoolbook
+
+/**
+ * @brief Add with carry, compiles to adc chain at runtime on x86.
+ *
+ * @param a Augend
+ * @param b Addend
+ * @param c Carry in and out
+ * @return Sum
+ */
+constexpr uint64_t wu_addc(uint64_t a, uint64_t b, unsigned char &c)
+{
+#ifdef UTL_WIDE_X86
+    if (!__builtin_is_constant_evaluated()) {
+        unsigned long long r = 0;
+        c = _addcarry_u64(c, a, b, &r);
+        return r;
+    }
+#endif
+    const uint64_t s = a + b;
+    const uint64_t r = s + c;
+    c = (s < a) | (r < s);
+    return r;
+}
+
+/**
+ * @brief Subtract with borrow, compiles to sbb chain at runtime on x86.
+ *
+ * @param a Minuend
+ * @param b Subtrahend
+ * @param c Borrow in and out
+ * @return Difference
+ */
+constexpr uint64_t wu_subb(uint64_t a, uint64_t b, unsigned char &c)
+{
+#ifdef UTL_WIDE_X86
+    if (!__builtin_is_constant_evaluated()) {
+        unsigned long long r = 0;
+        c = _subborrow_u64(c, a, b, &r);
+        return r;
+    }
+#endif
+    const uint64_t d = a - b;
+    const uint64_t r = d - c;
+    c = (a < b) | (d < c);
+    return r;
+}
+
+/**
+ * @brief Full 64x64 multiplication, mulx if compiled with BMI2.
+ *
+ * @param a Multiplicand
+ * @param b Multiplier
+ * @param hi High word of product
+ * @return Low word of product
+ */
+constexpr uint64_t wu_mul(uint64_t a, uint64_t b, uint64_t &hi)
+{
+#if defined(UTL_WIDE_X86) && defined(__BMI2__)
+    if (!__builtin_is_constant_evaluated()) {
+        unsigned long long h = 0;
+        const uint64_t lo = _mulx_u64(a, b, &h);
+        hi = h;
+        return lo;
+    }
+#endif
+    hi = mulhi(a, b);
+    return a * b;
+}
+
+/**
+ * @brief Divide two words by one.
+ *
+ * @param hi High word of dividend, less than divisor
+ * @param lo Low word of dividend
+ * @param d Divisor
+ * @param r Remainder
+ * @return Quotient
+ */
+constexpr uint64_t wu_div(uint64_t hi, uint64_t lo, uint64_t d, uint64_t &r)
+{
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef unsigned __int128 u128;
+    const u128 n = u128(hi) << 64 | lo;
+    r = uint64_t(n % d);
+    return uint64_t(n / d);
+#else
+    uint64_t q = 0;
+    for (int i = 0; i < 64; ++i) {
+        const bool carry = hi >> 63;
+        hi = hi << 1 | lo >> 63;
+        lo <<= 1;
+        q <<= 1;
+        if (carry || hi >= d) {
+            hi -= d;
+            q |= 1;
+        }
+    }
+    r = hi;
+    return q;
+#endif
+}
+
+/**
+ * @brief Full product of N-word numbers into 2N words, Karatsuba recursion
+ * down to schoolbook below karatsuba_words.
+ *
+ */
+template<size_t N>
+constexpr void wu_mul_full(const uint64_t *a, const uint64_t *b, uint64_t *r)
+{
+    if constexpr (N < karatsuba_words || N % 2) {
+        for (size_t i = 0; i < 2 * N; ++i)
+            r[i] = 0;
+        for (size_t i = 0; i < N; ++i) {
+            uint64_t k = 0;
+            for (size_t j = 0; j < N; ++j) {
+                uint64_t hi = 0;
+                const uint64_t lo = wu_mul(a[i], b[j], hi);
+                unsigned char c = 0;
+                r[i + j] = wu_addc(r[i + j], lo, c);
+                hi += c;
+                c = 0;
+                r[i + j] = wu_addc(r[i + j], k, c);
+                k = hi + c;
+            }
+            r[i + N] = k;
+        }
+    } else {
+        constexpr size_t h = N / 2;
+        uint64_t z0[N] = {}, z1[N + 1] = {}, z2[N] = {}, sa[h] = {}, sb[h] = {};
+        wu_mul_full<h>(a, b, z0);
+        wu_mul_full<h>(a + h, b + h, z2);
+
+        unsigned char ca = 0, cb = 0;
+        for (size_t i = 0; i < h; ++i) {
+            sa[i] = wu_addc(a[i], a[i + h], ca);
+            sb[i] = wu_addc(b[i], b[i + h], cb);
+        }
+        // (a0 + a1)(b0 + b1) with carries of both sums
+        wu_mul_full<h>(sa, sb, z1);
+        z1[N] = ca & cb;
+        const uint64_t ma = 0 - uint64_t(ca), mb = 0 - uint64_t(cb);
+        unsigned char c = 0, d = 0;
+        for (size_t i = 0; i < h; ++i) {
+            z1[i + h] = wu_addc(z1[i + h], sb[i] & ma, c);
+            z1[i + h] = wu_addc(z1[i + h], sa[i] & mb, d);
+        }
+        z1[N] += c + d;
+
+        // Middle term a0 * b1 + a1 * b0 fits N + 1 words
+        c = d = 0;
+        for (size_t i = 0; i < N; ++i) {
+            z1[i] = wu_subb(z1[i], z0[i], c);
+            z1[i] = wu_subb(z1[i], z2[i], d);
+        }
+        z1[N] -= c + d;
+
+        for (size_t i = 0; i < N; ++i) {
+            r[i] = z0[i];
+            r[i + N] = z2[i];
+        }
+        c = 0;
+        for (size_t i = 0; i <= N; ++i)
+            r[i + h] = wu_addc(r[i + h], z1[i], c);
+        for (size_t i = N + h + 1; i < 2 * N; ++i)
+            r[i] = wu_addc(r[i], 0, c);
+    }
+}
+
+}
+
+/**
+ * @brief Fixed-width unsigned integer of several 64-bit words, with
+ * wrap-around arithmetic like built-in unsigned types. Words are stored
+ * least significant first, same as array for shift_left().
+ *
+ * @tparam Bits Width, multiple of 64 and at least 128
+ */
+template<unsigned Bits>
+struct wide_uint {
+    static_assert(Bits >= 128 && Bits % 64 == 0, "Bits must be multiple of 64");
+    static constexpr size_t words = Bits / 64;
+
+    uint64_t w[words] = {};
+
+    constexpr wide_uint() = default;
+    constexpr wide_uint(uint64_t x) : w{x} {}
+
+    /**
+     * @brief Convert from other width, truncated or zero-extended.
+     *
+     */
+    template<unsigned B>
+    explicit constexpr wide_uint(const wide_uint<B> &x)
+    {
+        for (size_t i = 0; i < words && i < x.words; ++i)
+            w[i] = x.w[i];
+    }
+
+    /**
+     * @brief Parse hexadecimal string, most significant digit first. Optional
+     * 0x prefix is skipped, excess leading digits are dropped.
+     *
+     * @param sv Hexadecimal string
+     * @return Value modulo 2^Bits
+     */
+    static constexpr wide_uint from_hex(std::string_view sv)
+    {
+        if (sv.size() >= 2 && sv[0] == '0' && (sv[1] | 0x20) == 'x')
+            sv.remove_prefix(2);
+        if (sv.size() > Bits / 4)
+            sv.remove_prefix(sv.size() - Bits / 4);
+
+        uint8_t bin[Bits / 8] = {};
+        const size_t len = str_to_bin(sv.data(), sv.size(), bin, sizeof(bin));
+        wide_uint x;
+        for (size_t i = 0; i < len; ++i) {
+            const size_t b = len - 1 - i;
+            x.w[b / 8] |= uint64_t(bin[i]) << (b % 8 * 8);
+        }
+        return x;
+    }
+
+    /**
+     * @brief Convert to hexadecimal string of full width, with leading zeros.
+     *
+     * @param str Output string
+     * @param max_str_len Output string maximum length, including 0-terminator
+     * @return Resulting string length, 0 if failed
+     */
+    constexpr size_t to_hex(char *str, size_t max_str_len) const
+    {
+        uint8_t bin[Bits / 8] = {};
+        for (size_t i = 0; i < sizeof(bin); ++i) {
+            const size_t b = sizeof(bin) - 1 - i;
+            bin[i] = uint8_t(w[b / 8] >> (b % 8 * 8));
+        }
+        return bin_to_str(bin, sizeof(bin), str, max_str_len);
+    }
+
+    /**
+     * @brief Number of bits required to represent value, 0 for zero.
+     *
+     */
+    constexpr unsigned bit_width() const
+    {
+        for (size_t i = words; i--;) {
+            if (w[i])
+                return unsigned(i * 64 + 64 - impl::clz(w[i]));
+        }
+        return 0;
+    }
+
+    explicit constexpr operator bool() const
+    {
+        uint64_t x = 0;
+        for (size_t i = 0; i < words; ++i)
+            x |= w[i];
+        return x;
+    }
+
+    explicit constexpr operator uint64_t() const
+    {
+        return w[0];
+    }
+
+    /**
+     * @brief Quotient and remainder in one pass, Knuth's algorithm D.
+     *
+     * @param a Dividend
+     * @param b Divisor, division by zero gives zero quotient and remainder a
+     * @param q Quotient, may be the same object as a
+     * @param r Remainder, may be the same object as a
+     */
+    static constexpr void divmod(const wide_uint &a, const wide_uint &b, wide_uint &q, wide_uint &r)
+    {
+        wide_uint quot;
+        size_t n = words;
+        while (n && !b.w[n - 1])
+            --n;
+        if (!n || a < b) {
+            r = a;
+            q = quot;
+            return;
+        }
+        if (n == 1) {
+            uint64_t rem = 0;
+            for (size_t i = words; i--;)
+                quot.w[i] = impl::wu_div(rem, a.w[i], b.w[0], rem);
+            q = quot;
+            r = rem;
+            return;
+        }
+
+        // Normalize, so top divisor word has its top bit set
+        const unsigned s = impl::clz(b.w[n - 1]);
+        uint64_t v[words] = {}, u[words + 1] = {};
+        for (size_t i = n; i--;)
+            v[i] = b.w[i] << s | (s && i ? b.w[i - 1] >> (64 - s) : 0);
+        u[words] = s ? a.w[words - 1] >> (64 - s) : 0;
+        for (size_t i = words; i--;)
+            u[i] = a.w[i] << s | (s && i ? a.w[i - 1] >> (64 - s) : 0);
+
+        size_t m = words; // u[m] is extra top word, so leading n words are less than v
+        while (m > n && !u[m] && !u[m - 1])
+            --m;
+        for (size_t j = m - n + 1; j--;) {
+            uint64_t rhat = 0;
+            uint64_t qhat = 0;
+            bool big = false;
+            if (u[j + n] >= v[n - 1]) {
+                qhat = ~uint64_t(0);
+                unsigned char c = 0;
+                rhat = impl::wu_addc(u[j + n - 1], v[n - 1], c);
+                big = c;
+            } else {
+                qhat = impl::wu_div(u[j + n], u[j + n - 1], v[n - 1], rhat);
+            }
+            while (!big) {
+                uint64_t hi = 0;
+                const uint64_t lo = impl::wu_mul(qhat, v[n - 2], hi);
+                if (hi < rhat || (hi == rhat && lo <= u[j + n - 2]))
+                    break;
+                --qhat;
+                unsigned char c = 0;
+                rhat = impl::wu_addc(rhat, v[n - 1], c);
+                big = c;
+            }
+
+            // u[j .. j + n] -= qhat * v
+            uint64_t k = 0;
+            unsigned char br = 0;
+            for (size_t i = 0; i < n; ++i) {
+                uint64_t hi = 0;
+                uint64_t lo = impl::wu_mul(qhat, v[i], hi);
+                lo += k;
+                hi += lo < k;
+                u[i + j] = impl::wu_subb(u[i + j], lo, br);
+                k = hi;
+            }
+            u[j + n] = impl::wu_subb(u[j + n], k, br);
+            if (br) {
+                --qhat;
+                unsigned char c = 0;
+                for (size_t i = 0; i < n; ++i)
+                    u[i + j] = impl::wu_addc(u[i + j], v[i], c);
+                u[j + n] += c;
+            }
+            quot.w[j] = qhat;
+        }
+
+        q = quot;
+        r = {};
+        for (size_t i = 0; i < n; ++i)
+            r.w[i] = u[i] >> s | (s ? u[i + 1] << (64 - s) : 0);
+    }
+
+    constexpr wide_uint &operator+=(const wide_uint &x)
+    {
+        unsigned char c = 0;
+        for (size_t i = 0; i < words; ++i)
+            w[i] = impl::wu_addc(w[i], x.w[i], c);
+        return *this;
+    }
+
+    constexpr wide_uint &operator-=(const wide_uint &x)
+    {
+        unsigned char c = 0;
+        for (size_t i = 0; i < words; ++i)
+            w[i] = impl::wu_subb(w[i], x.w[i], c);
+        return *this;
+    }
+
+    /**
+     * @brief Truncated schoolbook product, only words below width are computed.
+     *
+     */
+    constexpr wide_uint &operator*=(const wide_uint &x)
+    {
+        wide_uint r;
+        for (size_t i = 0; i < words; ++i) {
+            uint64_t k = 0;
+            for (size_t j = 0; i + j < words; ++j) {
+                uint64_t hi = 0;
+                const uint64_t lo = impl::wu_mul(w[i], x.w[j], hi);
+                unsigned char c = 0;
+                r.w[i + j] = impl::wu_addc(r.w[i + j], lo, c);
+                hi += c;
+                c = 0;
+                r.w[i + j] = impl::wu_addc(r.w[i + j], k, c);
+                k = hi + c;
+            }
+        }
+        return *this = r;
+    }
+
+    constexpr wide_uint &operator/=(const wide_uint &x)
+    {
+        wide_uint r;
+        divmod(*this, x, *this, r);
+        return *this;
+    }
+
+    constexpr wide_uint &operator%=(const wide_uint &x)
+    {
+        wide_uint q;
+        divmod(*this, x, q, *this);
+        return *this;
+    }
+
+    constexpr wide_uint &operator<<=(unsigned n)
+    {
+        const size_t ws = n / 64;
+        const unsigned bs = n % 64;
+        for (size_t i = words; i--;) {
+            const uint64_t hi = i >= ws ? w[i - ws] : 0;
+            const uint64_t lo = i > ws ? w[i - ws - 1] : 0;
+            w[i] = bs ? hi << bs | lo >> (64 - bs) : hi;
+        }
+        return *this;
+    }
+
+    constexpr wide_uint &operator>>=(unsigned n)
+    {
+        const size_t ws = n / 64;
+        const unsigned bs = n % 64;
+        for (size_t i = 0; i < words; ++i) {
+            const uint64_t lo = i + ws < words ? w[i + ws] : 0;
+            const uint64_t hi = i + ws + 1 < words ? w[i + ws + 1] : 0;
+            w[i] = bs ? lo >> bs | hi << (64 - bs) : lo;
+        }
+        return *this;
+    }
+
+    constexpr wide_uint &operator&=(const wide_uint &x)
+    {
+        for (size_t i = 0; i < words; ++i)
+            w[i] &= x.w[i];
+        return *this;
+    }
+
+    constexpr wide_uint &operator|=(const wide_uint &x)
+    {
+        for (size_t i = 0; i < words; ++i)
+            w[i] |= x.w[i];
+        return *this;
+    }
+
+    constexpr wide_uint &operator^=(const wide_uint &x)
+    {
+        for (size_t i = 0; i < words; ++i)
+            w[i] ^= x.w[i];
+        return *this;
+    }
+
+    constexpr wide_uint &operator++() { return *this += 1; }
+    constexpr wide_uint &operator--() { return *this -= 1; }
+
+    constexpr wide_uint operator~() const
+    {
+        wide_uint r;
+        for (size_t i = 0; i < words; ++i)
+            r.w[i] = ~w[i];
+        return r;
+    }
+
+    constexpr wide_uint operator-() const { return wide_uint{} - *this; }
+
+    friend constexpr wide_uint operator+(wide_uint a, const wide_uint &b) { return a += b; }
+    friend constexpr wide_uint operator-(wide_uint a, const wide_uint &b) { return a -= b; }
+    friend constexpr wide_uint operator*(wide_uint a, const wide_uint &b) { return a *= b; }
+    friend constexpr wide_uint operator/(wide_uint a, const wide_uint &b) { return a /= b; }
+    friend constexpr wide_uint operator%(wide_uint a, const wide_uint &b) { return a %= b; }
+    friend constexpr wide_uint operator&(wide_uint a, const wide_uint &b) { return a &= b; }
+    friend constexpr wide_uint operator|(wide_uint a, const wide_uint &b) { return a |= b; }
+    friend constexpr wide_uint operator^(wide_uint a, const wide_uint &b) { return a ^= b; }
+    friend constexpr wide_uint operator<<(wide_uint a, unsigned n) { return a <<= n; }
+    friend constexpr wide_uint operator>>(wide_uint a, unsigned n) { return a >>= n; }
+
+    friend constexpr bool operator==(const wide_uint &a, const wide_uint &b)
+    {
+        uint64_t x = 0;
+        for (size_t i = 0; i < words; ++i)
+            x |= a.w[i] ^ b.w[i];
+        return !x;
+    }
+
+    friend constexpr bool operator<(const wide_uint &a, const wide_uint &b)
+    {
+        unsigned char c = 0;
+        for (size_t i = 0; i < words; ++i)
+            impl::wu_subb(a.w[i], b.w[i], c);
+        return c;
+    }
+
+    friend constexpr bool operator!=(const wide_uint &a, const wide_uint &b) { return !(a == b); }
+    friend constexpr bool operator>(const wide_uint &a, const wide_uint &b) { return b < a; }
+    friend constexpr bool operator<=(const wide_uint &a, const wide_uint &b) { return !(b < a); }
+    friend constexpr bool operator>=(const wide_uint &a, const wide_uint &b) { return !(a < b); }
+};
+
+/**
+ * @brief Full product of two numbers in double width, Karatsuba
+ * multiplication from 512 bits.
+ *
+ * @param a Multiplicand
+ * @param b Multiplier
+ * @return Product
+ */
+template<unsigned Bits>
+constexpr wide_uint<Bits * 2> mul_wide(const wide_uint<Bits> &a, const wide_uint<Bits> &b)
+{
+    wide_uint<Bits * 2> r;
+    impl::wu_mul_full<Bits / 64>(a.w, b.w, r.w);
+    return r;
+}
+
+typedef wide_uint<128> uint128;
+typedef wide_uint<256> uint256;
+typedef wide_uint<512> uint512;
+
+}
+
+#endif
@@ -0,0 +1,332 @@
+#ifndef UTL_WINDOW_H
+#define UTL_WINDOW_H
+
+#include "utl/fastmath.h"
+#include "utl/ring.h"
+
+namespace utl {
+namespace impl {
+
+inline constexpr size_t win_chunk = 64;   // Samples per batch pass, buffers stay on stack
+
+/**
+ * @brief Sums of deviations and squared deviations from a shift, which is
+ * close to the mean, so single pass doesn't lose precision.
+ *
+ * @param x Input array
+ * @param n Input array length
+ * @param c Shift
+ * @param s1 Output sum of x - c
+ * @param s2 Output sum of (x - c)^2
+ */
+template<class V>
+UTL_FM_INLINE void win_sums(const double *x, size_t n, double c, double &s1, double &s2)
+{
+    constexpr size_t w = sizeof(V) / sizeof(double);
+    const V cv = V{} + c;
+    V a = V{}, b = V{};
+    size_t i = 0;
+    for (const size_t m = n & ~(w - 1); i < m; i += w) {
+        V v;
+        memcpy(&v, x + i, sizeof(V));
+        v = v - cv;
+        a = a + v;
+        b = b + v * v;
+    }
+    double la[w], lb[w];
+    memcpy(la, &a, sizeof(V));
+    memcpy(lb, &b, sizeof(V));
+    s1 = s2 = 0;
+    for (size_t k = 0; k < w; ++k) {
+        s1 += la[k];
+        s2 += lb[k];
+    }
+    for (; i < n; ++i) {
+        const double d = x[i] - c;
+        s1 += d;
+        s2 += d * d;
+    }
+}
+
+#ifdef UTL_FASTMATH_SIMD
+__attribute__((target("avx2,fma")))
+inline void win_sums_avx2(const double *x, size_t n, double c, double &s1, double &s2)
+{
+    win_sums<__m256d>(x, n, c, s1, s2);
+}
+
+__attribute__((target("avx512f")))
+inline void win_sums_avx512(const double *x, size_t n, double c, double &s1, double &s2)
+{
+    win_sums<__m512d>(x, n, c, s1, s2);
+}
+#endif
+
+inline void win_dispatch(const double *x, size_t n, double c, double &s1, double &s2)
+{
+#ifdef UTL_FASTMATH_SIMD
+    switch (fm_simd_level()) {
+    case 2:
+        return win_sums_avx512(x, n, c, s1, s2);
+    case 1:
+        return win_sums_avx2(x, n, c, s1, s2);
+    case 0:
+        return win_sums<__m128d>(x, n, c, s1, s2);
+    }
+#endif
+    win_sums<double>(x, n, c, s1, s2);
+}
+
+/**
+ * @brief Monotonic deque of window extremes in fixed storage. Values that
+ * can never become the extreme are dropped on push, so front is always
+ * the extreme of the window and each value is pushed and popped once.
+ *
+ * @tparam T Type of values
+ * @tparam N Window size, power of 2
+ * @tparam Max Track maximum, minimum otherwise
+ */
+template<class T, size_t N, bool Max>
+struct win_deque {
+    const T& front() const          { return items[head & (N - 1)].v; }
+    void clear()                    { head = tail = 0; }
+
+    /**
+     * @brief Add newest value.
+     *
+     * @param x Value
+     * @param seq Sequence number of value
+     */
+    void push(const T &x, size_t seq)
+    {
+        while (tail != head) {
+            const T &b = items[(tail - 1) & (N - 1)].v;
+            if (Max ? x < b : b < x)
+                break;
+            --tail;
+        }
+        items[tail++ & (N - 1)] = {x, seq};
+    }
+
+    /**
+     * @brief Drop values that left the window.
+     *
+     * @param first Sequence number of oldest value in window
+     */
+    void expire(size_t first)
+    {
+        while (tail != head && items[head & (N - 1)].seq < first)
+            ++head;
+    }
+private:
+    struct item {
+        T v;
+        size_t seq;
+    };
+    storage<item, N> items;
+    size_t head = 0;
+    size_t tail = 0;
+};
+
+}
+
+/**
+ * @brief Rolling statistics over last N samples, updated incrementally when
+ * sample is added and when the oldest one is discarded, instead of rescanning
+ * the window. Mean and variance use Welford update and removal in double,
+ * minimum and maximum use monotonic deques (amortized O(1)), percentiles come
+ * from a fixed histogram of Bins equal bins over [lo, hi), so their error is
+ * within one bin width and values outside are clamped. Batch write() updates
+ * moments for whole chunks with SIMD.
+ *
+ * @tparam T Type of samples, arithmetic
+ * @tparam N Window size, must be power of 2
+ * @tparam Bins Number of percentile histogram bins
+ */
+template<class T, size_t N, size_t Bins = 64>
+class window_stats {
+public:
+    /**
+     * @brief Construct empty window.
+     *
+     * @param lo Lower bound of percentile range
+     * @param hi Upper bound of percentile range
+     */
+    window_stats(double lo, double hi) : lo{lo}, scale{Bins / (hi - lo)} {}
+
+    // Samples in window, oldest first.
+    const ring<T, N, true>& samples() const { return buf; }
+    size_t size() const                     { return buf.size(); }
+    bool empty() const                      { return buf.empty(); }
+    bool full() const                       { return buf.full(); }
+    double mean() const                     { return avg; }
+    // Sample variance, 0 if there are less than 2 samples.
+    double variance() const                 { return size() > 1 ? m2 / double(size() - 1) : 0; }
+    double stddev() const                   { return std::sqrt(variance()); }
+    // Smallest sample, window must not be empty.
+    const T& min() const                    { return lows.front(); }
+    // Largest sample, window must not be empty.
+    const T& max() const                    { return highs.front(); }
+
+    void clear()
+    {
+        buf.clear();
+        lows.clear();
+        highs.clear();
+        for (auto &c : bins)
+            c = 0;
+        avg = m2 = 0;
+        seq = 0;
+    }
+
+    /**
+     * @brief Add sample, discarding the oldest one if window is full.
+     *
+     * @param x Sample
+     */
+    void put(const T &x)
+    {
+        if (full()) {
+            const double y = double(buf.front());
+            --bins[bin(y)];
+            const double n = double(N - 1), d = y - avg;
+            avg -= d / n;
+            m2 -= d * (y - avg);
+            m2 = m2 > 0 ? m2 : 0;
+        }
+        buf.put(x);
+        const double v = double(x), d = v - avg;
+        avg += d / double(size());
+        m2 += d * (v - avg);
+        ++bins[bin(v)];
+        push(x, size());
+    }
+
+    /**
+     * @brief Add array of samples, same as put() for each of them.
+     *
+     * @param src Input array
+     * @param len Input array length
+     */
+    void write(const T *src, size_t len)
+    {
+        if (len > N) {
+            clear();
+            src += len - N;
+            len = N;
+        }
+        for (size_t i = 0; i < len; i += impl::win_chunk) {
+            const size_t k = len - i < impl::win_chunk ? len - i : impl::win_chunk;
+            const size_t drop = size() + k > N ? size() + k - N : 0;
+            double in[impl::win_chunk], out[impl::win_chunk];
+            for (size_t j = 0; j < k; ++j)
+                in[j] = double(src[i + j]);
+            size_t j = 0;
+            for (auto it = buf.begin(); j < drop; ++it)
+                out[j++] = double(*it);
+            remove(out, drop, size());
+            add(in, k, size() - drop);
+            for (j = 0; j < drop; ++j)
+                --bins[bin(out[j])];
+            for (j = 0; j < k; ++j)
+                ++bins[bin(in[j])];
+            const size_t n = size();
+            buf.write(src + i, k);
+            for (j = 0; j < k; ++j)
+                push(src[i + j], n + j + 1 < N ? n + j + 1 : N);
+        }
+    }
+
+    /**
+     * @brief Get approximate value at given percentile, interpolated
+     * within histogram bin and limited to window extremes.
+     *
+     * @param p Percentile - [0, 100]
+     * @return Value, 0 if empty
+     */
+    double percentile(double p) const
+    {
+        if (empty())
+            return 0;
+        const double rank = (p < 0 ? 0 : p > 100 ? 100 : p) / 100 * double(size());
+        double acc = 0;
+        size_t i = 0;
+        for (; i < Bins - 1 && (acc + bins[i] < rank || !bins[i]); ++i)
+            acc += bins[i];
+        const double frac = bins[i] ? (rank - acc) / bins[i] : 0;
+        const double v = lo + (double(i) + frac) / scale;
+        const double a = double(min()), b = double(max());
+        return v < a ? a : v > b ? b : v;
+    }
+private:
+    size_t bin(double v) const
+    {
+        const double b = (v - lo) * scale;
+        return !(b >= 1) ? 0 : b >= Bins - 1 ? Bins - 1 : size_t(b);
+    }
+
+    // Add newest sample to extremes, n is window size including it.
+    void push(const T &x, size_t n)
+    {
+        lows.expire(seq + 1 - n);
+        highs.expire(seq + 1 - n);
+        lows.push(x, seq);
+        highs.push(x, seq);
+        ++seq;
+    }
+
+    /**
+     * @brief Merge moments of new samples into window moments.
+     *
+     * @param x New samples
+     * @param k Number of new samples
+     * @param count Number of samples in window before
+     */
+    void add(const double *x, size_t k, size_t count)
+    {
+        const double na = double(count), nb = double(k), n = na + nb;
+        double s1, s2;
+        impl::win_dispatch(x, k, avg, s1, s2);
+        const double d = s1 / nb;   // Mean of new samples minus window mean
+        avg += d * nb / n;
+        m2 += s2 - s1 * d + d * d * na * nb / n;
+    }
+
+    /**
+     * @brief Split moments of the oldest samples out of window moments.
+     *
+     * @param x Oldest samples
+     * @param k Number of oldest samples
+     * @param count Number of samples in window before
+     */
+    void remove(const double *x, size_t k, size_t count)
+    {
+        if (!k)
+            return;
+        const double n = double(count), nb = double(k), na = n - nb;
+        if (!na) {
+            avg = m2 = 0;
+            return;
+        }
+        double s1, s2;
+        impl::win_dispatch(x, k, avg, s1, s2);
+        const double mb = avg + s1 / nb, ma = (n * avg - nb * mb) / na, d = mb - ma;
+        m2 -= s2 - s1 * s1 / nb + d * d * na * nb / n;
+        m2 = m2 > 0 ? m2 : 0;
+        avg = ma;
+    }
+
+    ring<T, N, true> buf;
+    impl::win_deque<T, N, false> lows;
+    impl::win_deque<T, N, true> highs;
+    uint32_t bins[Bins] = {};
+    double lo;
+    double scale;
+    double avg = 0;
+    double m2 = 0;
+    size_t seq = 0;     // Sequence number of next sample
+};
+
+}
+
+#endif
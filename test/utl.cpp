@@ -0,0 +1,1613 @@
+#define UTL_TRACE
+#include "utl/utl.h"
+#include "utl/trace.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <sys/socket.h>
+#include <sys/wait.h>
+#endif
+
+namespace {
+
+struct counter {
+    int add(int x) { return val += x; }
+    int val = 0;
+};
+
+/**
+ * @brief Check narrow floating point format against scalar reference: every
+ * code must round trip, and every midpoint between adjacent codes, as well
+ * as values one float ulp around it, must convert same in batch and scalar.
+ *
+ */
+template<class T, uint32_t Codes, utl::fp_mode Mode, class Enc, class Dec, class EncN, class DecN>
+void check_mini(Enc enc, Dec dec, EncN enc_n, DecN dec_n)
+{
+    std::vector<T> codes(Codes), codes2(Codes);
+    std::vector<float> vals(Codes);
+
+    for (uint32_t c = 0; c < Codes; ++c)
+        codes[c] = c;
+    dec_n(codes.data(), vals.data(), Codes);
+    for (uint32_t c = 0; c < Codes; ++c) {
+        ASSERT_EQ(utl::Float(vals[c]).u32, dec(T(c))) << c;
+        if (std::isfinite(vals[c]) || (Mode == utl::fp_mode::nearest && !std::isnan(vals[c]))) {
+            ASSERT_EQ(enc(utl::Float(vals[c]).u32), T(c)) << c;
+        }
+    }
+    enc_n(vals.data(), codes2.data(), Codes);
+    for (uint32_t c = 0; c < Codes; ++c)
+        ASSERT_EQ(codes2[c], enc(utl::Float(vals[c]).u32)) << c;
+
+    std::vector<float> mids;
+    for (uint32_t c = 0; c + 1 < Codes; ++c) {
+        double a = vals[c], b = vals[c + 1];
+        if (!std::isfinite(a) || !std::isfinite(b))
+            continue;
+        uint32_t mid = utl::Float(float((a + b) / 2)).u32;
+        for (uint32_t m : {mid - 1, mid, mid + 1})
+            mids.push_back(utl::Float(m).f32);
+    }
+    mids.push_back(utl::Float(uint32_t(0x7f800000)).f32);
+    mids.push_back(utl::Float(uint32_t(0xff800000)).f32);
+    std::vector<T> out(mids.size());
+    enc_n(mids.data(), out.data(), mids.size());
+    for (size_t i = 0; i < mids.size(); ++i)
+        ASSERT_EQ(out[i], enc(utl::Float(mids[i]).u32)) << std::hex << utl::Float(mids[i]).u32;
+}
+
+}
+
+TEST(Bench, StatisticsOrdered)
+{
+    utl::bench_cfg cfg;
+    cfg.min_time = std::chrono::microseconds(100);
+    auto r = utl::bench<15>(cfg, [](int x) { return x * x; }, 7);
+    EXPECT_EQ(r.reps, 15u);
+    EXPECT_GT(r.iters, 0u);
+    EXPECT_LE(r.min, r.median);
+    EXPECT_LE(r.median, r.p99);
+    EXPECT_LE(r.min, r.mean);
+    EXPECT_GE(r.mad, 0);
+}
+
+TEST(Bench, MemberFunction)
+{
+    counter c;
+    utl::bench_cfg cfg;
+    cfg.min_time = std::chrono::microseconds(100);
+    cfg.warmup = 0;
+    auto r = utl::m_bench<3>(cfg, &counter::add, &c, 1);
+    EXPECT_GE(size_t(c.val), r.iters * r.reps);
+}
+
+TEST(Perf, GracefulFallback)
+{
+    utl::perf_counters pc;
+    pc.start();
+    auto s = pc.stop();
+    EXPECT_EQ(pc.valid(), s.valid());
+    auto e = utl::exec_counters<100>([](int x) { return x + 1; }, 1);
+    if (e.valid()) {
+        EXPECT_GT(e.instructions, 0);
+    }
+    counter c;
+    utl::m_exec_counters<10>(&counter::add, &c, 2);
+    EXPECT_EQ(c.val, 20);
+}
+
+TEST(Trace, ExportChromeJson)
+{
+    utl::trace_drain([](uint32_t, const utl::trace_event&) {});
+
+    auto work = [] {
+        UTL_ZONE("outer");
+        for (int i = 0; i < 3; ++i) {
+            UTL_ZONE("inner \"quoted\"");
+        }
+    };
+    std::thread t{work};
+    work();
+    t.join();
+
+    FILE *f = tmpfile();
+    ASSERT_NE(f, nullptr);
+    EXPECT_EQ(utl::trace_export(f), 8u);
+
+    std::string s(ftell(f), 0);
+    rewind(f);
+    ASSERT_EQ(fread(s.data(), 1, s.size(), f), s.size());
+    fclose(f);
+
+    EXPECT_EQ(s.rfind("{\"traceEvents\":[", 0), 0u);
+    EXPECT_NE(s.find("\"name\":\"outer\",\"ph\":\"X\""), std::string::npos);
+    EXPECT_NE(s.find("inner \\\"quoted\\\""), std::string::npos);
+    EXPECT_EQ(utl::trace_drain([](uint32_t, const utl::trace_event&) {}), 0u);
+}
+
+TEST(Trace, DrainRunsCallbacksUnlocked)
+{
+    utl::trace_drain([](uint32_t, const utl::trace_event&) {});
+    {
+        UTL_ZONE("a"); UTL_ZONE("b");   // Several zones on one line
+    }
+    size_t seen = 0;
+    utl::trace_drain([&](uint32_t, const utl::trace_event&) {
+        UTL_ZONE("in callback");    // Records into buffer being drained
+        ++seen;
+    });
+    EXPECT_GE(seen, 2u);
+    utl::trace_drain([](uint32_t, const utl::trace_event&) {});
+}
+
+TEST(Histogram, BucketBounds)
+{
+    using hist = utl::histogram<1000000, 4>;
+
+    for (uint64_t v = 0; v <= 1000000; v += 1 + v / 7) {
+        auto i = hist::index(v);
+        EXPECT_LT(i, hist::buckets);
+        EXPECT_LE(hist::lowest(i), v);
+        EXPECT_GE(hist::highest(i), v);
+        EXPECT_LE(hist::highest(i) - hist::lowest(i), v / 16);
+    }
+}
+
+TEST(Histogram, PercentileMergeSerialize)
+{
+    static utl::histogram<3600000000, 7> a, b, c;
+
+    for (uint64_t v = 1; v <= 1000; ++v)
+        a.record(v);
+    b.record(1000000, 10);
+    a.merge(b);
+
+    EXPECT_EQ(a.count(), 1010u);
+    EXPECT_NEAR(a.percentile(50), 505, 505 / 128 + 1);
+    EXPECT_NEAR(a.percentile(99), 1000, 1000 / 128 + 1);
+    EXPECT_NEAR(a.percentile(100), 1000000, 1000000 / 128);
+    EXPECT_EQ(a.percentile(0), 1u);
+
+    uint8_t buf[4096];
+    size_t len = a.serialize(buf, sizeof(buf));
+    ASSERT_GT(len, 0u);
+    EXPECT_LT(len, 1200u);
+    ASSERT_TRUE(c.deserialize(buf, len));
+    for (size_t i = 0; i < c.buckets; ++i)
+        ASSERT_EQ(c.count(i), a.count(i));
+    EXPECT_FALSE(c.deserialize(buf, len - 1));
+    EXPECT_EQ(a.serialize(buf, 16), 0u);
+}
+
+TEST(Histogram, BenchLatency)
+{
+    static utl::histogram<1000000000> h;
+    utl::bench_latency(h, 1000, [](int x) { return x * 3; }, 5);
+    EXPECT_EQ(h.count(), 1000u);
+    EXPECT_LE(h.percentile(50), h.percentile(99));
+}
+
+TEST(Time, CivilRoundTrip)
+{
+    int32_t prev = utl::civil_to_days(-1000, 1, 1) - 1;
+
+    for (int32_t y = -1000; y <= 3000; ++y) {
+        for (uint32_t m = 1; m <= 12; ++m) {
+            uint32_t len = m == 2 ? 28 + utl::is_leap(y) : 30 + ((m + (m >> 3)) & 1);
+            for (uint32_t d = 1; d <= len; ++d) {
+                int32_t days = utl::civil_to_days(y, m, d);
+                ASSERT_EQ(days, prev + 1);
+                auto c = utl::days_to_civil(days);
+                ASSERT_EQ(c.year, y);
+                ASSERT_EQ(c.month, m);
+                ASSERT_EQ(c.day, d);
+                prev = days;
+            }
+        }
+    }
+    static_assert(utl::civil_to_days(1970, 1, 1) == 0);
+    static_assert(utl::civil_to_days(2000, 3, 1) == 11017);
+    static_assert(utl::days_to_civil(-1).year == 1969);
+}
+
+TEST(Time, UtcTimeMatchesGmtime)
+{
+    std::mt19937_64 rng{1};
+
+    for (int i = 0; i < 100000; ++i) {
+        int64_t t = int64_t(rng() % 400000000000) - 62135596800;
+        time_t tt = t;
+        tm ref = {};
+        ASSERT_NE(gmtime_r(&tt, &ref), nullptr);
+        tm res = utl::utctime(t);
+        ASSERT_EQ(res.tm_year, ref.tm_year) << t;
+        ASSERT_EQ(res.tm_mon, ref.tm_mon) << t;
+        ASSERT_EQ(res.tm_mday, ref.tm_mday) << t;
+        ASSERT_EQ(res.tm_hour, ref.tm_hour) << t;
+        ASSERT_EQ(res.tm_min, ref.tm_min) << t;
+        ASSERT_EQ(res.tm_sec, ref.tm_sec) << t;
+        ASSERT_EQ(res.tm_wday, ref.tm_wday) << t;
+        ASSERT_EQ(res.tm_yday, ref.tm_yday) << t;
+        ASSERT_EQ(utl::timeutc(res), t);
+    }
+    // March 1 of a leap year, month table used to ignore February 29
+    EXPECT_EQ(utl::timeutc(124, 2, 1, 0, 0, 0), 1709251200);
+}
+
+TEST(Time, BatchCivil)
+{
+    constexpr size_t n = 1000;
+    int64_t t[n];
+    int64_t back[n];
+    utl::civil date[n];
+    uint32_t sod[n];
+    std::mt19937_64 rng{2};
+
+    for (auto &x : t)
+        x = int64_t(rng() % 270000000000) - 62135596800;
+    t[0] = -62135596800;
+    t[1] = -1;
+    t[2] = 0;
+
+    utl::utc_to_civil(t, date, sod, n);
+    utl::civil_to_utc(date, sod, back, n);
+
+    for (size_t i = 0; i < n; ++i) {
+        tm ref = utl::utctime(t[i]);
+        ASSERT_EQ(date[i].year, ref.tm_year + 1900);
+        ASSERT_EQ(date[i].month, uint32_t(ref.tm_mon + 1));
+        ASSERT_EQ(date[i].day, uint32_t(ref.tm_mday));
+        ASSERT_EQ(sod[i], uint32_t(ref.tm_hour * 3600 + ref.tm_min * 60 + ref.tm_sec));
+        ASSERT_EQ(back[i], t[i]);
+    }
+}
+
+TEST(Iso8601, Parse)
+{
+    utl::timestamp ts = {};
+    int32_t off = 0;
+
+    EXPECT_EQ(utl::iso8601_parse("1970-01-01T00:00:00Z", ts), 20u);
+    EXPECT_EQ(ts.sec, 0);
+    EXPECT_EQ(ts.nsec, 0u);
+
+    EXPECT_EQ(utl::iso8601_parse("2024-02-29t23:59:60.5z", ts), 22u);
+    EXPECT_EQ(ts.sec, 1709251200);
+    EXPECT_EQ(ts.nsec, 500000000u);
+
+    EXPECT_EQ(utl::iso8601_parse("2021-06-15 12:30:45.123456789123-07:30 tail", ts, &off), 38u);
+    EXPECT_EQ(ts.sec, 1623760245 + 7 * 3600 + 30 * 60);
+    EXPECT_EQ(ts.nsec, 123456789u);
+    EXPECT_EQ(off, -450);
+
+    EXPECT_EQ(utl::iso8601_parse("1999-12-31T23:59:59.00012+01:00", ts, &off), 31u);
+    EXPECT_EQ(ts.sec, 946684799 - 3600);
+    EXPECT_EQ(ts.nsec, 120000u);
+    EXPECT_EQ(off, 60);
+
+    for (auto bad : {
+        "1970-01-01T00:00:00", "1970-01-01T00:00:00.Z", "1970-01-01X00:00:00Z",
+        "1970/01-01T00:00:00Z", "1970-01-01T00-00:00Z", "1970-01-01T00:00:0aZ",
+        "1970-13-01T00:00:00Z", "1970-01-00T00:00:00Z", "1970-01-01T24:00:00Z",
+        "1970-01-01T00:00:00+0100", "1970-01-01T00:00:00+01:60", "197a-01-01T00:00:00Z",
+        "2023-02-29T00:00:00Z", "2023-02-31T00:00:00Z", "1900-02-29T00:00:00Z",
+        "2024-04-31T00:00:00Z", "2024-09-31T00:00:00Z", "2024-12-32T00:00:00Z"})
+        EXPECT_EQ(utl::iso8601_parse(bad, ts), 0u) << bad;
+
+    static_assert([] {
+        utl::timestamp t = {};
+        return utl::iso8601_parse("2000-03-01T00:00:00Z", t) && t.sec == 951868800;
+    }());
+    for (auto good : {"2000-02-29T00:00:00Z", "2024-07-31T00:00:00Z", "2024-08-31T00:00:00Z", "2024-11-30T00:00:00Z"})
+        EXPECT_NE(utl::iso8601_parse(good, ts), 0u) << good;
+}
+
+TEST(Iso8601, FormatRoundTrip)
+{
+    std::mt19937_64 rng{3};
+    const struct {
+        unsigned frac;
+        int32_t off;
+    } cfg[] = {{0, 0}, {3, 0}, {9, 330}, {6, -480}};
+    utl::iso8601_formatter cached[] = {{0, 0}, {3, 0}, {9, 330}, {6, -480}};
+    int64_t sec = 1600000000;
+
+    for (int i = 0; i < 20000; ++i) {
+        sec += rng() % 4 ? 0 : rng() % 100000;
+        utl::timestamp ts = {sec, uint32_t(rng() % 1000000000)};
+
+        for (size_t j = 0; j < utl::countof(cached); ++j) {
+            char a[utl::iso8601_max_len];
+            char b[utl::iso8601_max_len];
+            auto &fmt = cached[j];
+            auto frac = cfg[j].frac;
+            auto off = cfg[j].off;
+
+            size_t len = utl::iso8601_format(ts, a, sizeof(a), frac, off);
+            ASSERT_GT(len, 0u);
+            ASSERT_EQ(fmt.format(ts, b, sizeof(b)), len);
+            ASSERT_EQ(std::string_view(a, len), std::string_view(b, len));
+
+            utl::timestamp back = {};
+            int32_t parsed_off = 0;
+            ASSERT_EQ(utl::iso8601_parse(a, len, back, &parsed_off), len) << std::string_view(a, len);
+            ASSERT_EQ(back.sec, ts.sec);
+            ASSERT_EQ(parsed_off, off);
+            uint32_t unit = utl::ipow<uint32_t>(10, 9 - frac);
+            ASSERT_EQ(back.nsec, ts.nsec / unit * unit);
+        }
+    }
+    char s[utl::iso8601_max_len];
+    EXPECT_EQ(std::string_view(s, utl::iso8601_format({0, 7000000}, s, sizeof(s), 3)), "1970-01-01T00:00:00.007Z");
+    EXPECT_EQ(utl::iso8601_format({0, 0}, s, 20, 1), 0u);
+}
+
+TEST(Time, TscClock)
+{
+    using namespace std::chrono;
+
+    utl::tsc_clock::now(); // Calibrate
+    auto s0 = steady_clock::now().time_since_epoch();
+    auto t0 = utl::tsc_clock::now().time_since_epoch();
+    auto k0 = utl::tsc_clock::ticks();
+    std::this_thread::sleep_for(milliseconds(50));
+    auto k1 = utl::tsc_clock::ticks();
+    auto t1 = utl::tsc_clock::now().time_since_epoch();
+    auto s1 = steady_clock::now().time_since_epoch();
+
+    EXPECT_LE(s0.count(), t0.count() + 1000000);
+    EXPECT_GE(s1.count() + 1000000, t1.count());
+    EXPECT_NEAR(double((t1 - t0).count()), double((s1 - s0).count()), 2e6);
+    EXPECT_NEAR(double(utl::tsc_clock::to_ns(k1 - k0)), double((t1 - t0).count()), 1e6);
+
+    auto c0 = utl::coarse_clock::update();
+    std::this_thread::sleep_for(milliseconds(2));
+    EXPECT_EQ(utl::coarse_clock::now(), c0);
+    EXPECT_GT(utl::coarse_clock::update(), c0);
+}
+
+TEST(Float, HalfRounding)
+{
+    static_assert(utl::float_to_half(0x3f801000) == 0x3c00, "tie to even down");
+    static_assert(utl::float_to_half(0x3f803000) == 0x3c02, "tie to even up");
+    static_assert(utl::float_to_half(0x477fefff) == 0x7bff, "largest finite");
+    static_assert(utl::float_to_half(0x477ff000) == 0x7c00, "overflow to inf");
+    static_assert(utl::float_to_half(0xc7800000) == 0xfc00, "overflow to -inf");
+    static_assert(utl::float_to_half(0x33000000) == 0x0000, "half of smallest denormal");
+    static_assert(utl::float_to_half(0x33000001) == 0x0001, "above half of smallest denormal");
+    static_assert(utl::float_to_half(0x7f800001) == 0x7e00, "quiet NaN");
+    static_assert(utl::half_to_float(0x0001) == 0x33800000, "smallest denormal");
+    static_assert(utl::half_to_float(0x7c01) == 0x7fc02000, "quiet NaN");
+}
+
+TEST(Float, HalfBatchBitExact)
+{
+    std::vector<uint16_t> h(1 << 16), h2(h.size());
+    std::vector<float> f(h.size()), f2(h.size());
+
+    for (size_t i = 0; i < h.size(); ++i)
+        h[i] = i;
+    utl::half_to_float(h.data(), f.data(), h.size() - 3);
+    utl::impl::half_to_float_sw(h.data(), f2.data(), h.size());
+    for (size_t i = 0; i < h.size(); ++i) {
+        if (i < h.size() - 3) {
+            ASSERT_EQ(utl::Float(f[i]).u32, utl::half_to_float(h[i])) << i;
+        }
+        ASSERT_EQ(utl::Float(f2[i]).u32, utl::half_to_float(h[i])) << i;
+    }
+
+    for (uint64_t base = 0; base < (uint64_t(1) << 32); base += uint64_t(1) << 28) {
+        for (size_t i = 0; i < f.size(); ++i)
+            f[i] = utl::Float(uint32_t(base + i * 4093)).f32;
+        utl::float_to_half(f.data(), h.data(), f.size() - 5);
+        utl::impl::float_to_half_sw(f.data(), h2.data(), f.size());
+        for (size_t i = 0; i < f.size(); ++i) {
+            const uint16_t ref = utl::float_to_half(utl::Float(f[i]).u32);
+            if (i < f.size() - 5) {
+                ASSERT_EQ(h[i], ref) << std::hex << utl::Float(f[i]).u32;
+            }
+            ASSERT_EQ(h2[i], ref) << std::hex << utl::Float(f[i]).u32;
+        }
+    }
+}
+
+TEST(Float, MiniFormats)
+{
+    using utl::fp_mode;
+
+    static_assert(utl::float_to_bf16(0x3f808000) == 0x3f80, "tie to even down");
+    static_assert(utl::float_to_bf16(0x3f818000) == 0x3f82, "tie to even up");
+    static_assert(utl::float_to_bf16(0x7f7f8000) == 0x7f80, "overflow to inf");
+    static_assert(utl::float_to_bf16<fp_mode::saturate>(0x7f800000) == 0x7f7f, "saturate inf");
+    static_assert(utl::float_to_e4m3(0x43e80000) == 0x7e, "464 rounds to 448");
+    static_assert(utl::float_to_e4m3(0x43e80001) == 0x7f, "overflow to NaN");
+    static_assert(utl::float_to_e4m3<fp_mode::saturate>(0xc3e80001) == 0xfe, "saturate to -448");
+    static_assert(utl::float_to_e4m3(0x3a800000) == 0x00, "half of smallest denormal");
+    static_assert(utl::e4m3_to_float(0x01) == 0x3b000000, "smallest denormal");
+    static_assert(utl::float_to_e5m2(0x47700000) == 0x7c, "61440 overflows to inf");
+    static_assert(utl::float_to_e5m2<fp_mode::saturate>(0x47700000) == 0x7b, "saturate to 57344");
+    static_assert(utl::e5m2_to_float(0x7b) == 0x47600000, "largest finite");
+    static_assert(utl::double_to_half(0x3ff0020000001000) == 0x3c01, "single rounding");
+
+#define CHECK_MINI(T, codes, fmt, mode) \
+    check_mini<T, codes, mode>( \
+        [](uint32_t f) { return utl::float_to_##fmt<mode>(f); }, \
+        [](T h) { return utl::fmt##_to_float(h); }, \
+        [](const float *src, T *dst, size_t n) { utl::float_to_##fmt<mode>(src, dst, n); }, \
+        [](const T *src, float *dst, size_t n) { utl::fmt##_to_float(src, dst, n); })
+
+    CHECK_MINI(uint16_t, 0x10000, bf16, fp_mode::nearest);
+    CHECK_MINI(uint16_t, 0x10000, bf16, fp_mode::saturate);
+    CHECK_MINI(uint16_t, 0x10000, half, fp_mode::saturate);
+    CHECK_MINI(uint8_t, 0x100, e4m3, fp_mode::nearest);
+    CHECK_MINI(uint8_t, 0x100, e4m3, fp_mode::saturate);
+    CHECK_MINI(uint8_t, 0x100, e5m2, fp_mode::nearest);
+    CHECK_MINI(uint8_t, 0x100, e5m2, fp_mode::saturate);
+
+#undef CHECK_MINI
+}
+
+TEST(Float, DoubleToHalfSingleRounding)
+{
+    std::vector<double> d;
+    std::vector<uint16_t> ref;
+
+    // Midpoints of adjacent halves and values a double ulp around them,
+    // where rounding through float would go wrong
+    for (uint32_t h = 0; h < 0x7bff; ++h) {
+        double a = utl::Float(utl::half_to_double(h)).f64;
+        double b = utl::Float(utl::half_to_double(h + 1)).f64;
+        uint64_t mid = utl::Float((a + b) / 2).u64;
+        for (uint64_t m : {mid - 1, mid, mid + 1}) {
+            for (uint64_t s : {uint64_t(0), uint64_t(1) << 63}) {
+                d.push_back(utl::Float(m | s).f64);
+                ref.push_back((m == mid ? h + (h & 1) : m < mid ? h : h + 1) | (s >> 48));
+            }
+        }
+    }
+    std::vector<uint16_t> out(d.size());
+    utl::double_to_half(d.data(), out.data(), d.size());
+    for (size_t i = 0; i < d.size(); ++i) {
+        ASSERT_EQ(utl::double_to_half(utl::Float(d[i]).u64), ref[i]) << d[i];
+        ASSERT_EQ(out[i], ref[i]) << d[i];
+    }
+}
+
+TEST(Gf, TablesAndRegions)
+{
+    auto slow_mul = [](uint8_t x, uint8_t y) {
+        uint8_t r = 0;
+        while (y) {
+            if (y & 1)
+                r ^= x;
+            x = (x << 1) ^ ((x >> 7) * 0x11d);
+            y >>= 1;
+        }
+        return r;
+    };
+    static_assert(utl::gf_mul(0x53, 0xca) == 0x8f, "constexpr product");
+    static_assert(utl::gf_pow(2, 255) == 1, "generator order");
+
+    for (unsigned x = 0; x < 256; ++x) {
+        for (unsigned y = 0; y < 256; ++y) {
+            ASSERT_EQ(utl::gf_mul(x, y), slow_mul(x, y));
+            if (y) {
+                ASSERT_EQ(utl::gf_mul(utl::gf_div(x, y), y), x);
+            }
+        }
+        if (x) {
+            ASSERT_EQ(utl::gf_mul(x, utl::gf_inv(x)), 1);
+        }
+    }
+
+    std::vector<uint8_t> src(1000 + 13), dst(src.size()), acc(src.size());
+    for (size_t i = 0; i < src.size(); ++i)
+        src[i] = acc[i] = i * 7;
+    for (unsigned c = 0; c < 256; ++c) {
+        utl::gf_mul(c, src.data() + 1, dst.data() + 1, src.size() - 1);
+        utl::gf_mul_add(c, src.data() + 1, acc.data() + 1, src.size() - 1);
+        for (size_t i = 1; i < src.size(); ++i) {
+            ASSERT_EQ(dst[i], slow_mul(c, src[i])) << c;
+            ASSERT_EQ(acc[i] ^ dst[i], uint8_t(i * 7)) << c;
+        }
+#ifdef UTL_GF_SIMD
+        utl::impl::gf_region_ssse3<false>(utl::impl::gf_make_nibbles(c), src.data(), acc.data(), src.size());
+        for (size_t i = 0; i < src.size(); ++i)
+            ASSERT_EQ(acc[i], slow_mul(c, src[i])) << c;
+#endif
+        acc = src;
+    }
+}
+
+TEST(Gf, ReedSolomonReconstruct)
+{
+    constexpr size_t k = 6, m = 3, len = 5000 + 3;
+    using codec = utl::rs_codec<k, m>;
+    std::vector<std::vector<uint8_t>> orig(codec::shards, std::vector<uint8_t>(len));
+    std::vector<std::vector<uint8_t>> work = orig;
+    std::mt19937 rng{7};
+    uint8_t *shard[codec::shards];
+
+    for (size_t i = 0; i < k; ++i)
+        for (auto &b : orig[i])
+            b = rng();
+    for (size_t i = 0; i < codec::shards; ++i)
+        shard[i] = orig[i].data();
+    codec::encode(shard, shard + k, len);
+
+    // Every combination of up to m erasures
+    for (unsigned mask = 0; mask < (1u << codec::shards); ++mask) {
+        bool present[codec::shards];
+        size_t lost = 0;
+        for (size_t i = 0; i < codec::shards; ++i) {
+            present[i] = !(mask & (1u << i));
+            lost += !present[i];
+            work[i] = present[i] ? orig[i] : std::vector<uint8_t>(len, 0xee);
+            shard[i] = work[i].data();
+        }
+        ASSERT_EQ(codec::reconstruct(shard, present, len), lost <= m) << mask;
+        if (lost <= m) {
+            for (size_t i = 0; i < codec::shards; ++i)
+                ASSERT_EQ(work[i], orig[i]) << mask << " shard " << i;
+        }
+    }
+}
+
+TEST(Fixed, Arithmetic)
+{
+    using q16 = utl::fixed<15, 16>;
+    using q7 = utl::fixed<7, 8>;
+
+    static_assert(sizeof(q16) == 4 && sizeof(q7) == 2 && sizeof(utl::fixed<3, 4>) == 1);
+    static_assert(q16(1.5).raw == 0x18000 && q16(-0.25).raw == -0x4000);
+    static_assert(q16(1.5) + q16(2.25) == q16(3.75));
+    static_assert(q16(1.5) * q16(-2.5) == q16(-3.75));
+    static_assert(q16(1) / q16(3) == q16::from_raw(0x5555));
+    static_assert(q16(2) / q16(3) == q16::from_raw(0xaaab));
+    static_assert(q16(30000) + q16(30000) == q16::max());
+    static_assert(q16(-30000) - q16(30000) == q16::min());
+    static_assert(q16(300) * q16(300) == q16::max());
+    static_assert(-q16::min() == q16::max());
+    static_assert(q16(1) / q16(0) == q16::max() && q16(-1) / q16(0) == q16::min());
+    static_assert(q7(100) + q7(100) == q7::max() && q7::from_int(1000) == q7::max());
+
+    static_assert(q16(-2.5).to_int<utl::fx_round::floor>() == -3);
+    static_assert(q16(-2.5).to_int<utl::fx_round::zero>() == -2);
+    static_assert(q16(-2.5).to_int<utl::fx_round::nearest>() == -3);
+    static_assert(q16(-2.5).to_int<utl::fx_round::nearest_even>() == -2);
+    static_assert(q16(3.5).to_int<utl::fx_round::nearest_even>() == 4);
+    static_assert(q16::mul<utl::fx_round::floor>(q16::epsilon(), q16(-0.5)) == -q16::epsilon());
+    static_assert(q16::mul<utl::fx_round::zero>(q16::epsilon(), q16(-0.5)) == q16(0));
+
+    static_assert(utl::fixed_cast<q7>(q16(1.0 + 1.0 / 512)) == q7(1.0 + 1.0 / 256));
+    static_assert(utl::fixed_cast<q7, utl::fx_round::floor>(q16(1.0 + 1.0 / 512)) == q7(1));
+    static_assert(utl::fixed_cast<q16>(q7(-1.5)) == q16(-1.5));
+    static_assert(utl::fixed_cast<q7>(q16(1000)) == q7::max());
+
+    static_assert(utl::imap(q16(5), q16(0), q16(10), q16(-100), q16(100)) == q16(0));
+    static_assert(utl::imap(q16(2.5), q16(0), q16(10), q16(100), q16(-100)) == q16(50));
+    static_assert(utl::imap(q16(20), q16(0), q16(10), q16(0), q16(30000)) == q16::max());
+    static_assert(utl::imap(q16::max(), q16::min(), q16::max(), q16::max(), q16::min()) == q16::min());
+}
+
+TEST(Fixed, FloatConversion)
+{
+    using q16 = utl::fixed<15, 16>;
+    using q60 = utl::fixed<3, 60>;
+
+    static_assert(q16(1.5).to_float_bits() == 0x3fc00000 && q16(-0.25).to_float_bits() == 0xbe800000);
+    static_assert(q16::from_float_bits(0x3fc00000) == q16(1.5));
+    static_assert(q16::from_float_bits(0x7f800000) == q16::max() && q16::from_float_bits(0xff800000) == q16::min());
+    static_assert(q16::from_float_bits(0x7fc00000) == q16(0));
+    static_assert(q16::from_float_bits(0x4f000000) == q16::max());
+    static_assert(q16::from_float_bits(0x80000001) == q16(0));
+    static_assert(q16::from_float_bits<utl::fx_round::floor>(0x80000001) == -q16::epsilon());
+    static_assert(q16::from_half(0x3e00) == q16(1.5) && q16(32767).to_half() == 0x7800);
+    static_assert(q16(30000).to_half() == 0x7753);
+    static_assert(q60(1.0 / 3).to_float_bits() == 0x3eaaaaab);
+
+    std::mt19937 rng{11};
+    for (int i = 0; i < 100000; ++i) {
+        const q16 x = q16::from_raw(rng());
+        const float f = x.to_float();
+        ASSERT_EQ(f, float(x.to_double())) << x.raw;
+        ASSERT_EQ(q16::from_float(f), q16(double(f))) << x.raw;
+        ASSERT_EQ(x.to_half(), utl::double_to_half(utl::Float(x.to_double()).u64)) << x.raw;
+    }
+}
+
+TEST(Fixed, Trigonometry)
+{
+    using q16 = utl::fixed<15, 16>;
+    using q29 = utl::fixed<2, 29>;
+
+    static_assert(utl::radians(q16(180)) == q16::from_raw(205887));
+    static_assert(utl::degrees(q16::from_raw(205887)) == q16::from_raw(11796456));
+    static_assert(sin(q16(0)) == q16(0));
+
+    for (double d = -1000; d < 1000; d += 0.37) {
+        ASSERT_NEAR(utl::radians(q16(d)).to_double(), q16(d).to_double() * M_PI / 180, 1.0 / (1 << 16)) << d;
+        ASSERT_NEAR(utl::degrees(q16(d / 60)).to_double(), q16(d / 60).to_double() * 180 / M_PI, 1.0 / (1 << 16)) << d;
+    }
+
+    for (double a = -20; a < 20; a += 0.01) {
+        q16 s, c;
+        sincos(q16(a), s, c);
+        ASSERT_NEAR(s.to_double(), std::sin(q16(a).to_double()), 4.0 / (1 << 16)) << a;
+        ASSERT_NEAR(c.to_double(), std::cos(q16(a).to_double()), 4.0 / (1 << 16)) << a;
+        ASSERT_NEAR(sin(q29(a / 8)).to_double(), std::sin(q29(a / 8).to_double()), 4e-8) << a;
+    }
+    for (double y = -3; y <= 3; y += 0.125) {
+        for (double x = -3; x <= 3; x += 0.125) {
+            ASSERT_NEAR(atan2(q16(y), q16(x)).to_double(), std::atan2(y, x), 4.0 / (1 << 16)) << y << " " << x;
+            ASSERT_NEAR(atan2(q29(y / 4), q29(x / 4)).to_double(), std::atan2(y, x), 4e-8) << y << " " << x;
+        }
+    }
+}
+
+TEST(FastMath, Accuracy)
+{
+    constexpr size_t n = 4099;
+    std::mt19937 rng{5};
+    std::uniform_real_distribution<double> ang(-1e4, 1e4), unit(-1, 1), coord(-10, 10);
+    std::vector<double> a(n), u(n), x(n), y(n), out(n);
+    for (size_t i = 0; i < n; ++i) {
+        a[i] = ang(rng);
+        u[i] = unit(rng);
+        x[i] = coord(rng);
+        y[i] = coord(rng);
+    }
+    auto ulps = [](double v, double ref) {
+        return std::fabs(v - ref) / std::fabs(std::nextafter(ref, INFINITY) - ref);
+    };
+    auto check = [&](const std::vector<double> &src, double (*fast)(double), double (*ref)(double)) {
+        for (size_t i = 0; i < n; ++i) {
+            ASSERT_LE(ulps(fast(src[i]), ref(src[i])), 2) << src[i];
+            ASSERT_LE(ulps(out[i], ref(src[i])), 2) << src[i];
+        }
+    };
+    static_assert(utl::fast_sin(0) == 0 && utl::fast_cos(0) == 1 && utl::fast_atan2(0, -1) > 3.14159);
+
+    utl::fast_sin(a.data(), out.data(), n);
+    check(a, utl::fast_sin, std::sin);
+    utl::fast_cos(a.data(), out.data(), n);
+    check(a, utl::fast_cos, std::cos);
+    utl::fast_asin(u.data(), out.data(), n);
+    check(u, utl::fast_asin, std::asin);
+    utl::fast_acos(u.data(), out.data(), n);
+    check(u, utl::fast_acos, std::acos);
+
+    utl::fast_atan2(y.data(), x.data(), out.data(), n);
+    for (size_t i = 0; i < n; ++i) {
+        ASSERT_LE(ulps(utl::fast_atan2(y[i], x[i]), std::atan2(y[i], x[i])), 2) << y[i] << " " << x[i];
+        ASSERT_LE(ulps(out[i], std::atan2(y[i], x[i])), 2) << y[i] << " " << x[i];
+    }
+    utl::fast_hypot(x.data(), y.data(), out.data(), n);
+    for (size_t i = 0; i < n; ++i)
+        ASSERT_LE(ulps(out[i], std::hypot(x[i], y[i])), 2) << y[i] << " " << x[i];
+
+    EXPECT_EQ(utl::fast_atan2(-0.0, -1), -std::atan2(0.0, -1));
+    EXPECT_EQ(utl::fast_atan2(0, 0), 0);
+    EXPECT_EQ(utl::fast_asin(1), std::asin(1));
+
+#ifdef UTL_FASTMATH_SIMD
+    // Narrower paths than the one picked for this CPU
+    std::vector<double> ref(n);
+    utl::fast_atan2(y.data(), x.data(), ref.data(), n);
+    utl::impl::fm_batch<utl::impl::fm_op::atan2, __m128d>(y.data(), x.data(), out.data(), n);
+    for (size_t i = 0; i < n; ++i)
+        ASSERT_LE(ulps(out[i], ref[i]), 2);
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        utl::impl::fm_batch_avx2<utl::impl::fm_op::asin>(u.data(), nullptr, out.data(), n);
+        check(u, utl::fast_asin, std::asin);
+    }
+#endif
+}
+
+TEST(FastMath, PhysicsModes)
+{
+    EXPECT_NEAR(utl::fast_gcs_distance(52.52, 13.40, 48.85, 2.35), utl::gcs_distance(52.52, 13.40, 48.85, 2.35), 1e-6);
+    EXPECT_NEAR(utl::fast_inclination(0.3, -0.2, 0.9), utl::inclination(0.3, -0.2, 0.9), 1e-12);
+    EXPECT_NEAR(utl::fast_roll(-0.2, 0.9), utl::roll(-0.2, 0.9), 1e-12);
+    EXPECT_NEAR(utl::fast_pitch(0.3, -0.2, 0.9), utl::pitch(0.3, -0.2, 0.9), 1e-12);
+    // Plain functions, so they can be passed by name
+    const auto call = [](auto fn, auto ...args) { return fn(args...); };
+    EXPECT_EQ(call(utl::roll, -0.2, 0.9), utl::roll(-0.2, 0.9));
+    EXPECT_EQ(call(&utl::fast_inclination, 0.3, -0.2, 0.9), utl::fast_inclination(0.3, -0.2, 0.9));
+    double (*dist)(double, double, double, double, double) = &utl::haversine;
+    EXPECT_EQ(dist(52.52, 13.40, 48.85, 2.35, utl::earth_radius), utl::gcs_distance(52.52, 13.40, 48.85, 2.35));
+}
+
+TEST(Table, Generators)
+{
+    constexpr auto crc32 = utl::crc_table<uint32_t, 0xedb88320>();
+    constexpr auto crc16 = utl::crc_table<uint16_t, 0x1021, false>();
+    constexpr auto crc = [](auto &t, auto c, bool reflect, auto x) {
+        for (char ch : std::string_view{"123456789"}) {
+            if (reflect)
+                c = t[(c ^ ch) & 0xff] ^ (c >> 8);
+            else
+                c = t[((c >> 8) ^ ch) & 0xff] ^ decltype(c)(c << 8);
+        }
+        return decltype(c)(c ^ x);
+    };
+    static_assert(crc(crc32, 0xffffffffu, true, 0xffffffffu) == 0xcbf43926);
+    static_assert(crc(crc16, uint16_t(0xffff), false, uint16_t(0)) == 0x29b1);
+
+    constexpr auto pow10 = utl::pow10_table<uint64_t, 20>();
+    constexpr auto sin_q15 = utl::sin_table<256, int16_t>();
+    constexpr auto sin_dbl = utl::sin_table<90>();
+    static_assert(pow10[0] == 1 && pow10[19] == 10000000000000000000u);
+    static_assert(sin_q15[0] == 0 && sin_q15[256] == 32767 && sin_q15[128] == 23170);
+    static_assert(alignof(decltype(sin_dbl)) == 64);
+    static_assert(utl::hex_pair_table<true>()[0xa5][0] == 'A' && utl::hex_value_table()['F'] == 15);
+    static_assert(utl::gf_mul(utl::gf_exp_table()[100], utl::gf_exp_table()[200]) == utl::gf_exp_table()[45]);
+    static_assert(utl::make_table<4>([](size_t i) { return i * i; })[3] == 9);
+
+    for (size_t i = 0; i <= 90; ++i)
+        EXPECT_NEAR(sin_dbl[i], std::sin(i * M_PI / 180), 1e-15) << i;
+
+    uint8_t bin[4] = {};
+    char str[9] = {};
+    EXPECT_EQ(utl::str_to_bin("\xff" "DeAdbeef", 9, bin, sizeof(bin)), 4u);
+    EXPECT_EQ(utl::bin_to_str(bin, sizeof(bin), str, sizeof(str)), 8u);
+    EXPECT_STREQ(str, "0deadbee"); // Truncated to output, non-hex byte maps to 0
+    EXPECT_EQ(utl::str_to_dbl("1.000000000001"), 1.000000000001);
+}
+
+template<class T>
+void check_divider(std::mt19937_64 &rng)
+{
+    constexpr T lo = std::numeric_limits<T>::min();
+    constexpr T hi = std::numeric_limits<T>::max();
+    std::vector<T> ds = {1, 2, 3, 5, 7, 10, 16, 100, T(641), T(hi / 2), T(hi / 2 + 1), hi};
+    std::vector<T> ns = {0, 1, 2, 9, 10, 11, T(hi - 1), hi, lo, T(lo + 1)};
+    if constexpr (std::is_signed_v<T>) {
+        for (size_t i = 0, k = ds.size(); i < k; ++i)
+            ds.push_back(T(-ds[i]));
+        ds.push_back(lo);
+        ns.insert(ns.end(), {-1, -9, -10, -11});
+    }
+    for (int i = 0; i < 200; ++i)
+        ds.push_back(T(rng() >> (rng() % (64 - 1))) | 1);
+    for (int i = 0; i < 2000; ++i)
+        ns.push_back(T(rng()));
+
+    std::vector<T> q(ns.size()), r(ns.size());
+    for (T d : ds) {
+        if (!d)
+            continue;
+        const utl::divider<T> div(d);
+        div.divide(ns.data(), q.data(), ns.size());
+        div.modulo(ns.data(), r.data(), ns.size());
+        for (size_t i = 0; i < ns.size(); ++i) {
+            const T n = ns[i];
+            if (std::is_signed_v<T> && n == lo && d == T(-1))
+                continue;
+            ASSERT_EQ(q[i], T(n / d)) << +n << " / " << +d;
+            ASSERT_EQ(r[i], T(n % d)) << +n << " % " << +d;
+        }
+    }
+}
+
+TEST(Math, Divider)
+{
+    static_assert(1000u / utl::divider<uint32_t>(7) == 142);
+    static_assert(-1000 / utl::divider<int32_t>(-7) == 142 && -1000 % utl::divider<int32_t>(7) == -6);
+    static_assert(utl::uceil(4294967295u, utl::divider<uint32_t>(2)) == 2147483648u);
+
+    std::mt19937_64 rng(40);
+    check_divider<uint8_t>(rng);
+    check_divider<int8_t>(rng);
+    check_divider<uint16_t>(rng);
+    check_divider<int16_t>(rng);
+    check_divider<uint32_t>(rng);
+    check_divider<int32_t>(rng);
+    check_divider<uint64_t>(rng);
+    check_divider<int64_t>(rng);
+
+    for (uint32_t d = 1; d < 1000; ++d)
+        for (uint32_t n = 0; n < 3000; n += 7)
+            ASSERT_EQ(utl::uceil(n, utl::divider<uint32_t>(d)), utl::uceil(n, d));
+}
+
+TEST(Math, IntegerLengthAndMap)
+{
+    static_assert(utl::ilen(0) == 1 && utl::ilen(-9) == 1 && utl::ilen(10u) == 2);
+    static_assert(utl::ilen(INT64_MIN) == 19 && utl::ilen(UINT64_MAX) == 20);
+    for (uint64_t p = 1, k = 1; k < 20; p *= 10, ++k) {
+        EXPECT_EQ(utl::ilen(p), k);
+        EXPECT_EQ(utl::ilen(p - 1), std::max<uint64_t>(k - 1, 1));
+        EXPECT_EQ(utl::ilen(p * 10 - 1), k);
+    }
+
+    static_assert(utl::imap(5, 0, 10, -100, 100) == 0);
+    static_assert(utl::imap(1, 0, 255, -1000, 1000) == -992);  // -992.16
+    static_assert(utl::imap(uint32_t(0), uint32_t(0), UINT32_MAX, UINT32_MAX, uint32_t(0)) == UINT32_MAX);
+    static_assert(utl::imap(INT64_MAX, INT64_MIN, INT64_MAX, int64_t(0), int64_t(1000)) == 1000);
+    static_assert(utl::imap(3, 4, 4, 7, 9) == 7);
+
+    std::mt19937 rng(40);
+    std::vector<int32_t> src(5000), dst(src.size());
+    for (auto &x : src)
+        x = int32_t(rng()) >> (rng() % 31);
+    const int32_t ranges[][4] = {{0, 255, -1000, 1000}, {-1, 1, 1000, -1000}, {INT32_MIN, INT32_MAX, 0, 100},
+                                 {100, -100, INT32_MIN, INT32_MAX}, {0, 3, 0, 10}};
+    for (auto &rg : ranges) {
+        utl::imap(src.data(), dst.data(), src.size(), rg[0], rg[1], rg[2], rg[3]);
+        for (size_t i = 0; i < src.size(); ++i) {
+            const long double ref = rg[2] + (long double)(rg[3] - int64_t(rg[2])) / (rg[1] - int64_t(rg[0])) * (src[i] - int64_t(rg[0]));
+            if (std::fabs(ref) >= 2e9L)
+                continue;
+            ASSERT_EQ(dst[i], utl::imap(src[i], rg[0], rg[1], rg[2], rg[3])) << src[i];
+            if (std::fabs(ref - std::round(ref)) > 1e-6L) {
+                ASSERT_EQ(dst[i], int32_t(ref)) << src[i];
+            }
+        }
+    }
+
+    std::vector<uint32_t> usrc(src.begin(), src.end()), udst(usrc.size());
+    utl::imap<uint32_t>(usrc.data(), udst.data(), usrc.size(), UINT32_MAX, 0, 1000, 0);
+    for (size_t i = 0; i < usrc.size(); ++i) {
+        ASSERT_EQ(udst[i], utl::imap<uint32_t>(usrc[i], UINT32_MAX, 0, 1000, 0));
+        ASSERT_EQ(udst[i], uint32_t(usrc[i] * 1000.0L / UINT32_MAX));
+    }
+}
+
+TEST(Wide, ArithmeticMatchesInt128)
+{
+    using utl::uint128;
+    __extension__ typedef unsigned __int128 u128;
+    static_assert((uint128(1) << 127 >> 63) == uint128(1) << 64);
+    static_assert(uint128(0) - 1 == ~uint128(0) && uint128(5) < uint128(0) - 1);
+    static_assert(uint128::from_hex("0x1234567890abcdef1234567890ABCDEF").w[1] == 0x1234567890abcdef);
+    static_assert(uint128::from_hex("ffffffffffffffffffffffffffffffff") / uint128(0xffffffff) % 7 == 1);
+
+    std::mt19937_64 rng(41);
+    const auto rnd = [&] {
+        const int shape = rng() % 4;
+        const u128 x = u128(rng()) << 64 | rng();
+        return shape == 0 ? x >> (rng() % 128) : shape == 1 ? x & ~u128(0) << (rng() % 128) : x;
+    };
+    const auto wide = [](u128 x) { return uint128(uint64_t(x >> 64)) << 64 | uint64_t(x); };
+    for (int i = 0; i < 20000; ++i) {
+        const u128 a = rnd(), b = rnd() | 1;
+        const unsigned s = rng() % 128;
+        const uint128 wa = wide(a), wb = wide(b);
+        ASSERT_EQ(wa + wb, wide(a + b));
+        ASSERT_EQ(wa - wb, wide(a - b));
+        ASSERT_EQ(wa * wb, wide(a * b));
+        ASSERT_EQ(wa / wb, wide(a / b));
+        ASSERT_EQ(wa % wb, wide(a % b));
+        ASSERT_EQ(wa << s, wide(a << s));
+        ASSERT_EQ(wa >> s, wide(a >> s));
+        ASSERT_EQ(wa < wb, a < b);
+        ASSERT_EQ(wa.bit_width(), a ? 128 - (a >> 64 ? __builtin_clzll(uint64_t(a >> 64)) : 64 + __builtin_clzll(uint64_t(a))) : 0);
+    }
+}
+
+TEST(Wide, DivisionAndKaratsuba)
+{
+    using utl::uint512;
+    std::mt19937_64 rng(42);
+    const auto rnd = [&](unsigned bits) {
+        utl::wide_uint<1024> x;
+        for (auto &w : x.w)
+            w = rng();
+        return uint512(x >> (1024 - bits));
+    };
+    for (int i = 0; i < 3000; ++i) {
+        const uint512 a = rnd(1 + rng() % 512), b = rnd(1 + rng() % 512) | 1;
+        const utl::wide_uint<1024> p = utl::mul_wide(a, b);
+        ASSERT_EQ(p, utl::wide_uint<1024>(a) * utl::wide_uint<1024>(b));
+        ASSERT_EQ(p / utl::wide_uint<1024>(b), utl::wide_uint<1024>(a));
+        uint512 q, r;
+        uint512::divmod(a, b, q, r);
+        ASSERT_TRUE(r < b);
+        ASSERT_EQ(q * b + r, a);
+    }
+    // Quotient digit correction cases: divisor top words near maximum
+    const uint512 d = ~uint512(0) >> 200 ^ 1, n = ~uint512(0) - 12345;
+    EXPECT_EQ(n / d * d + n % d, n);
+    EXPECT_EQ(uint512(7) / uint512(0), uint512(0));
+    EXPECT_EQ(uint512(7) % uint512(0), uint512(7));
+
+    char hex[129] = {};
+    const uint512 x = rnd(500);
+    EXPECT_EQ(x.to_hex(hex, sizeof(hex)), 128u);
+    EXPECT_EQ(uint512::from_hex(hex), x);
+    EXPECT_EQ(uint512::from_hex("fff").to_hex(hex, sizeof(hex)), 128u);
+    EXPECT_EQ(std::string(hex).substr(124), "0fff");
+}
+
+TEST(Geo, BatchHaversine)
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> ulat(-90, 90), ulng(-180, 180);
+    std::vector<double> lat(1003), lng(lat.size());
+    for (size_t i = 0; i < lat.size(); ++i) {
+        lat[i] = ulat(rng);
+        lng[i] = ulng(rng);
+    }
+    const utl::geo_points pts(lat.data(), lng.data(), lat.size());
+    utl::geo_points rev;
+    for (size_t i = lat.size(); i--;)
+        rev.push_back(lat[i], lng[i]);
+
+    std::vector<double> d(lat.size());
+    utl::haversine(55.75, 37.62, pts, d.data());
+    for (size_t i = 0; i < lat.size(); ++i)
+        ASSERT_NEAR(d[i], utl::gcs_distance(55.75, 37.62, lat[i], lng[i]), 1e-3) << i;
+
+    utl::haversine(pts, rev, d.data(), 1000);
+    for (size_t i = 0; i < lat.size(); ++i) {
+        const size_t j = lat.size() - 1 - i;
+        ASSERT_NEAR(d[i], utl::haversine(lat[i], lng[i], lat[j], lng[j], 1000), 1e-9) << i;
+    }
+    EXPECT_EQ(utl::earth_radius, 6371000);
+}
+
+TEST(Geo, CellIndex)
+{
+    char hash[16] = {};
+    EXPECT_EQ(utl::geohash(57.64911, 10.40744, hash, 11), 11u);
+    EXPECT_STREQ(hash, "u4pruydqqvj");
+    static_assert(utl::geo_cell(-90, -180) == 0 && utl::geo_cell(90, 180) == ~uint64_t(0));
+
+    std::mt19937 rng(43);
+    std::uniform_real_distribution<double> ulat(-90, 90), ulng(-180, 180), u01(0, 1);
+    std::vector<double> lat(20000), lng(lat.size());
+    for (size_t i = 0; i < lat.size(); ++i) {
+        lat[i] = i % 4 ? ulat(rng) : 45 + u01(rng);    // Dense cluster and sparse rest
+        lng[i] = i % 4 ? ulng(rng) : 179.5 + u01(rng);                // Across antimeridian
+        lng[i] -= lng[i] > 180 ? 360 : 0;
+    }
+    std::vector<uint64_t> cells(lat.size());
+    utl::geo_cell(lat.data(), lng.data(), cells.data(), lat.size());
+    for (size_t i = 0; i < lat.size(); ++i)
+        ASSERT_EQ(cells[i], utl::geo_cell(lat[i], lng[i]));
+
+    const utl::geo_index idx(lat.data(), lng.data(), lat.size());
+    const double qs[][3] = {{45.5, 180, 30000}, {45.5, -179.9, 500}, {89.9, 10, 200000},
+                            {-10, 20, 1500000}, {0, 0, 3e7}, {45.2, 179.7, 10}};
+    std::vector<utl::geo_hit> hits, knn;
+    for (auto &q : qs) {
+        std::vector<std::pair<double, size_t>> ref;
+        for (size_t i = 0; i < lat.size(); ++i)
+            ref.push_back({utl::gcs_distance(q[0], q[1], lat[i], lng[i]), i});
+        std::sort(ref.begin(), ref.end());
+
+        size_t expect = 0;
+        while (expect < ref.size() && ref[expect].first <= q[2])
+            ++expect;
+        idx.within(q[0], q[1], q[2], hits);
+        EXPECT_EQ(hits.size(), expect) << q[0] << " " << q[1];
+        for (auto &h : hits)
+            ASSERT_LE(h.distance, q[2]);
+
+        ASSERT_EQ(idx.nearest(q[0], q[1], 10, knn), 10u);
+        for (size_t i = 0; i < 10; ++i)
+            ASSERT_NEAR(knn[i].distance, ref[i].first, 1e-3) << i;
+    }
+
+    // Zero radius finds the exact point, negative and NaN find nothing
+    ASSERT_EQ(idx.within(lat[7], lng[7], 0, hits), 1u);
+    EXPECT_EQ(hits[0].id, 7u);
+    EXPECT_EQ(hits[0].distance, 0);
+    EXPECT_EQ(idx.within(lat[7], lng[7], -1, hits), 0u);
+    EXPECT_EQ(idx.within(lat[7], lng[7], std::nan(""), hits), 0u);
+}
+
+TEST(Imu, TiltMatchesPhysics)
+{
+    utl::ring<utl::imu_vec, 256> in;
+    utl::ring<utl::imu_angles, 128> out;
+    std::mt19937 rng(44);
+    std::uniform_real_distribution<double> u(-16, 16);
+    std::vector<utl::imu_vec> v(200);
+    for (auto &s : v)
+        s = {u(rng), u(rng), u(rng)};
+    EXPECT_EQ(in.write(v.data(), v.size()), v.size());
+
+    EXPECT_EQ(utl::imu_tilt(in, out), 128u);   // Output full
+    EXPECT_EQ(in.size(), 72u);
+    for (size_t k = 0; k < 200; ++k) {
+        if (k == 128) {
+            out.clear();
+            EXPECT_EQ(utl::imu_tilt(in, out), 72u);
+        }
+        utl::imu_angles a;
+        ASSERT_TRUE(out.get(a));
+        ASSERT_NEAR(a.roll, utl::roll(v[k].y, v[k].z), 1e-12);
+        ASSERT_NEAR(a.pitch, utl::pitch(v[k].x, v[k].y, v[k].z), 1e-12);
+        ASSERT_NEAR(a.inclination, utl::inclination(v[k].x, v[k].y, v[k].z), 1e-12);
+    }
+}
+
+TEST(Imu, FiltersTrackRotation)
+{
+    constexpr double dt = 0.001, w = 1.0;   // 1 kHz, roll at 1 rad/s
+    utl::imu_complementary comp(dt);
+    utl::imu_madgwick madg(dt);
+    utl::ring<utl::imu_sample, 1024> in_c, in_m;
+    utl::ring<utl::imu_angles, 64, true> out_c, out_m;
+
+    for (int t = 1; t <= 1000; ++t) {
+        const double r = w * t * dt;
+        const utl::imu_sample s = {{0, 9.81 * std::sin(r), 9.81 * std::cos(r)}, {w, 0.01, 0}};
+        in_c.put(s);
+        in_m.put(s);
+    }
+    EXPECT_EQ(comp.process(in_c, out_c), 1000u);
+    EXPECT_EQ(madg.process(in_m, out_m), 1000u);
+    EXPECT_EQ(out_c.size(), 64u);
+
+    utl::imu_angles c = {}, m = {};
+    while (out_c.get(c) && out_m.get(m)) {}
+    EXPECT_NEAR(c.roll, 57.2958, 0.1);
+    EXPECT_NEAR(m.roll, 57.2958, 0.1);
+    EXPECT_NEAR(c.pitch, 0, 0.1);   // Gyro y bias is rejected
+    EXPECT_NEAR(m.pitch, 0, 0.1);
+    EXPECT_NEAR(m.inclination, 57.2958, 0.1);
+    EXPECT_NEAR(c.inclination, 57.2958, 0.1);
+}
+
+TEST(Parallel, ForAndReduce)
+{
+    utl::thread_pool pool(4);
+    EXPECT_EQ(pool.size(), 4u);
+    std::vector<int> hits(100003);
+    for (size_t grain : {1, 7, 1000, 200000}) {
+        std::fill(hits.begin(), hits.end(), 0);
+        pool.parallel_for(3, hits.size(), grain, [&](size_t b, size_t e) {
+            EXPECT_TRUE(e - b == grain || e == hits.size());
+            for (size_t i = b; i < e; ++i)
+                ++hits[i];
+        });
+        EXPECT_EQ(std::count(hits.begin(), hits.begin() + 3, 0), 3);
+        EXPECT_EQ(std::count(hits.begin() + 3, hits.end(), 1), long(hits.size() - 3));
+    }
+    auto sum = [&](size_t grain) {
+        return pool.parallel_reduce(0, 1000000, grain, uint64_t(0),
+            [](size_t b, size_t e) { uint64_t s = 0; for (; b < e; ++b) s += b; return s; },
+            [](uint64_t a, uint64_t b) { return a + b; });
+    };
+    EXPECT_EQ(sum(1), 499999500000u);
+    EXPECT_EQ(sum(4096), 499999500000u);
+    pool.parallel_for(5, 5, 1, [](size_t, size_t) { FAIL(); });
+    std::atomic<size_t> inner{0};
+    pool.parallel_for(0, 4, 1, [&](size_t, size_t) {
+        pool.parallel_for(0, 10, 3, [&](size_t b, size_t e) { inner += e - b; });  // Nested call runs serially
+    });
+    EXPECT_EQ(inner, 40u);
+    EXPECT_EQ(utl::parallel_reduce(0, 10, 1, 0, [](size_t b, size_t e) { return int((b + e - 1) * (e - b) / 2); }, [](int a, int b) { return a + b; }), 45);
+}
+
+TEST(Parallel, BulkConversions)
+{
+    utl::thread_pool pool(3);
+    std::mt19937 gen(7);
+    std::vector<uint8_t> bin(300001);
+    for (auto &b : bin)
+        b = uint8_t(gen());
+    std::string s1(bin.size() * 2 + 1, 'x'), s2 = s1;
+    EXPECT_EQ(utl::bin_to_str(pool, bin.data(), bin.size(), s1.data(), s1.size()),
+              utl::bin_to_str(bin.data(), bin.size(), s2.data(), s2.size()));
+    EXPECT_EQ(s1, s2);
+    EXPECT_EQ(utl::bin_to_str(pool, bin.data(), bin.size(), s1.data(), 1000), 998u);
+    EXPECT_EQ(s1.substr(0, 998), s2.substr(0, 998));
+    EXPECT_EQ(s1[998], 0);
+
+    std::uniform_real_distribution<float> fd(-70000, 70000);
+    std::vector<float> f(100000), back(f.size()), ref(f.size());
+    for (auto &x : f)
+        x = fd(gen);
+    std::vector<uint16_t> h1(f.size()), h2(f.size());
+    utl::float_to_half(pool, f.data(), h1.data(), f.size());
+    utl::float_to_half(f.data(), h2.data(), f.size());
+    EXPECT_EQ(h1, h2);
+    utl::half_to_float(pool, h1.data(), back.data(), h1.size());
+    utl::half_to_float(h2.data(), ref.data(), h2.size());
+    EXPECT_EQ(0, std::memcmp(back.data(), ref.data(), back.size() * sizeof(float)));
+
+    std::uniform_real_distribution<double> lat(-90, 90), lng(-180, 180);
+    utl::geo_points a, b;
+    for (int i = 0; i < 50000; ++i) {
+        a.push_back(lat(gen), lng(gen));
+        b.push_back(lat(gen), lng(gen));
+    }
+    std::vector<double> d1(a.size()), d2(a.size());
+    utl::haversine(pool, 12.5, -45, a, d1.data());
+    utl::haversine(12.5, -45, a, d2.data());
+    EXPECT_EQ(d1, d2);
+    utl::haversine(pool, a, b, d1.data());
+    utl::haversine(a, b, d2.data());
+    EXPECT_EQ(d1, d2);
+}
+
+TEST(Cpu, DispatchPathsAgree)
+{
+    static_assert(utl::impl::cpu_parse("avx2,bmi2") == (utl::cpu_avx2 | utl::cpu_bmi2));
+    static_assert(utl::impl::cpu_parse("all") == ~0u);
+    static_assert(utl::impl::cpu_parse("avx,nope,") == utl::cpu_avx);
+    constexpr uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    static_assert(utl::crc32c(check, sizeof(check)) == 0xe3069283);
+
+    std::mt19937 gen(11);
+    std::vector<uint8_t> bin(1017);   // AVX2 blocks, one SSSE3 block and scalar tail
+    for (auto &b : bin)
+        b = uint8_t(gen());
+    std::uniform_real_distribution<double> deg(-180, 180);
+    std::vector<double> lat(333), lng(333);
+    for (size_t i = 0; i < lat.size(); ++i) {
+        lat[i] = deg(gen) / 2;
+        lng[i] = deg(gen);
+    }
+    std::vector<float> f(lat.begin(), lat.end());
+
+    struct result {
+        std::string hex;
+        uint32_t crc;
+        std::vector<uint16_t> half;
+        std::vector<uint64_t> cells;
+        std::vector<uint8_t> gf;
+        std::vector<double> sin;
+    };
+    auto compute = [&] {
+        result r;
+        r.hex.resize(bin.size() * 2 + 1);
+        utl::bin_to_str(bin.data(), bin.size(), r.hex.data(), r.hex.size());
+        r.crc = utl::crc32c(bin.data(), bin.size());
+        EXPECT_EQ(utl::crc32c(bin.data() + 13, bin.size() - 13, utl::crc32c(bin.data(), 13)), r.crc);
+        r.half.resize(f.size());
+        utl::float_to_half(f.data(), r.half.data(), f.size());
+        r.cells.resize(lat.size());
+        utl::geo_cell(lat.data(), lng.data(), r.cells.data(), lat.size());
+        r.gf.resize(bin.size());
+        utl::gf_mul(0x53, bin.data(), r.gf.data(), bin.size());
+        r.sin.resize(lat.size());
+        utl::fast_sin(lat.data(), r.sin.data(), lat.size());
+        return r;
+    };
+
+    const uint32_t prev = utl::cpu_restrict(0);
+    EXPECT_EQ(utl::cpu_features(), 0u);
+    const result ref = compute();
+    for (uint32_t mask : {uint32_t(utl::cpu_sse2), utl::cpu_sse2 | utl::cpu_ssse3 | utl::cpu_sse42,
+                          ~(utl::cpu_avx512f | utl::cpu_bmi2), ~0u}) {
+        utl::cpu_restrict(mask);
+        EXPECT_EQ(utl::cpu_features() & ~mask, 0u);
+        const result r = compute();
+        EXPECT_EQ(r.hex, ref.hex);
+        EXPECT_EQ(r.crc, ref.crc);
+        EXPECT_EQ(r.half, ref.half);
+        EXPECT_EQ(r.cells, ref.cells);
+        EXPECT_EQ(r.gf, ref.gf);
+        for (size_t i = 0; i < r.sin.size(); ++i)
+            EXPECT_NEAR(r.sin[i], ref.sin[i], 1e-15);
+    }
+    utl::cpu_restrict(prev);
+}
+
+TEST(Mring, ContiguousAcrossWrap)
+{
+    utl::mring r(5000);
+    ASSERT_TRUE(r.valid());
+    const size_t cap = r.capacity();
+    EXPECT_GE(cap, 5000u);
+    EXPECT_EQ(cap & (cap - 1), 0u);
+
+    std::vector<uint8_t> msg(cap * 3 / 4), out(cap);
+    for (size_t i = 0; i < msg.size(); ++i)
+        msg[i] = uint8_t(i * 7);
+    EXPECT_EQ(r.write(msg.data(), msg.size()), msg.size());
+    EXPECT_EQ(r.read(out.data(), out.size()), msg.size());
+    EXPECT_TRUE(std::equal(msg.begin(), msg.end(), out.begin()));
+    EXPECT_TRUE(r.empty());
+
+    uint8_t *w = r.prepare(cap / 2);    // Crosses end of buffer
+    ASSERT_NE(w, nullptr);
+    for (size_t i = 0; i < cap / 2; ++i)
+        w[i] = uint8_t(i ^ 0x5a);
+    r.commit(cap / 2);
+    EXPECT_EQ(r.prepare(cap / 2 + 1), nullptr);
+    EXPECT_EQ(r.write(msg.data(), msg.size()), cap / 2);
+    EXPECT_EQ(r.space(), 0u);
+
+    size_t len;
+    const uint8_t *p = r.peek(len);
+    ASSERT_EQ(len, cap);
+    for (size_t i = 0; i < cap / 2; ++i)
+        ASSERT_EQ(p[i], uint8_t(i ^ 0x5a));
+    EXPECT_TRUE(std::equal(msg.begin(), msg.begin() + cap / 2, p + cap / 2));
+    r.consume(cap);
+    EXPECT_TRUE(r.empty());
+
+    for (size_t huge : {SIZE_MAX, SIZE_MAX / 2 + 2}) {   // Rounding up would overflow
+        utl::mring bad(huge);
+        EXPECT_FALSE(bad.valid());
+        EXPECT_EQ(bad.fd(), -1);
+    }
+}
+
+TEST(Mring, FileBackedSurvivesReopen)
+{
+    const std::string path = testing::TempDir() + "utl_mring_test";
+    std::remove(path.c_str());
+    const char text[] = "telemetry survives restart";
+    size_t cap;
+    {
+        utl::mring r(path.c_str(), 4096);
+        ASSERT_TRUE(r.valid());
+        cap = r.capacity();
+        std::vector<uint8_t> fill(cap - 10);
+        EXPECT_EQ(r.write(fill.data(), fill.size()), fill.size());
+        EXPECT_EQ(r.read(fill.data(), fill.size()), fill.size());
+        EXPECT_EQ(r.write(text, sizeof(text)), sizeof(text));   // Wraps
+        EXPECT_TRUE(r.sync());
+    }
+    utl::mring r(path.c_str(), 1 << 20);    // Size of existing file is kept
+    ASSERT_TRUE(r.valid());
+    EXPECT_EQ(r.capacity(), cap);
+    EXPECT_EQ(r.size(), sizeof(text));
+
+    utl::mring other(path.c_str(), 0);      // Separate mapping, as in other process
+    ASSERT_TRUE(other.valid());
+    size_t len;
+    EXPECT_STREQ(reinterpret_cast<const char*>(other.peek(len)), text);
+    EXPECT_EQ(len, sizeof(text));
+    other.consume(len);
+    EXPECT_TRUE(r.empty());
+    EXPECT_EQ(r.write("x", 1), 1u);
+    EXPECT_EQ(other.size(), 1u);
+    std::remove(path.c_str());
+}
+
+#ifdef __linux__
+TEST(Mring, AttachByPassedFd)
+{
+    int sock[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sock), 0);
+    const pid_t pid = fork();   // Before ring exists, so child gets fd only through socket
+    ASSERT_GE(pid, 0);
+    if (!pid) {
+        char byte;
+        char ctl[CMSG_SPACE(sizeof(int))];
+        iovec iov = {&byte, 1};
+        msghdr msg = {};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = ctl;
+        msg.msg_controllen = sizeof(ctl);
+        if (recvmsg(sock[1], &msg, 0) != 1 || !CMSG_FIRSTHDR(&msg))
+            _exit(1);
+        int fd;
+        memcpy(&fd, CMSG_DATA(CMSG_FIRSTHDR(&msg)), sizeof(fd));
+        utl::mring r(utl::mring::from_fd, fd);
+        close(fd);
+        _exit(r.valid() && r.write("from child", 11) == 11 ? 0 : 2);
+    }
+    utl::mring r(4096);
+    ASSERT_TRUE(r.valid());
+    char byte = 0;
+    char ctl[CMSG_SPACE(sizeof(int))] = {};
+    iovec iov = {&byte, 1};
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctl;
+    msg.msg_controllen = sizeof(ctl);
+    cmsghdr *c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(int));
+    const int fd = r.fd();
+    memcpy(CMSG_DATA(c), &fd, sizeof(fd));
+    ASSERT_EQ(sendmsg(sock[0], &msg, 0), 1);
+    int status = -1;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    close(sock[0]);
+    close(sock[1]);
+    size_t len;
+    EXPECT_STREQ(reinterpret_cast<const char*>(r.peek(len)), "from child");
+    EXPECT_EQ(len, 11u);
+
+    const std::string path = testing::TempDir() + "utl_mring_empty";
+    const int empty = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    utl::mring none(utl::mring::from_fd, empty);  // Attaching never initializes a ring
+    EXPECT_FALSE(none.valid());
+    close(empty);
+    std::remove(path.c_str());
+
+    utl::mring bad(utl::mring::from_fd, -1);
+    EXPECT_FALSE(bad.valid());
+    EXPECT_EQ(bad.size(), 0u);
+    EXPECT_EQ(bad.space(), 0u);
+    EXPECT_EQ(bad.prepare(1), nullptr);
+    EXPECT_EQ(bad.peek(len), nullptr);
+    EXPECT_EQ(len, 0u);
+    EXPECT_EQ(bad.write("x", 1), 0u);
+    EXPECT_EQ(bad.read(&byte, 1), 0u);
+    bad.commit(1);
+    bad.consume(1);
+    EXPECT_TRUE(bad.empty());
+}
+#endif
+
+TEST(Cbor, EncodesRfcExamples)
+{
+    uint8_t buf[64];
+    auto hex = [&](auto &&fn) {
+        utl::cbor_writer w(buf, sizeof(buf));
+        fn(w);
+        EXPECT_TRUE(w.valid());
+        char str[sizeof(buf) * 2 + 1];
+        utl::bin_to_str(w.data(), w.size(), str, sizeof(str));
+        return std::string(str);
+    };
+    auto enc = [&](auto x) { return hex([&](utl::cbor_writer &w) { w.put(x); }); };
+    EXPECT_EQ(enc(0), "00");
+    EXPECT_EQ(enc(23u), "17");
+    EXPECT_EQ(enc(24), "1818");
+    EXPECT_EQ(enc(1000), "1903e8");
+    EXPECT_EQ(enc(1000000000000ll), "1b000000e8d4a51000");
+    EXPECT_EQ(enc(UINT64_MAX), "1bffffffffffffffff");
+    EXPECT_EQ(enc(INT64_MIN), "3b7fffffffffffffff");
+    EXPECT_EQ(enc(-1), "20");
+    EXPECT_EQ(enc(-1000), "3903e7");
+    EXPECT_EQ(enc(0.0), "f90000");
+    EXPECT_EQ(enc(-0.0), "f98000");
+    EXPECT_EQ(enc(1.0f), "f93c00");
+    EXPECT_EQ(enc(1.1), "fb3ff199999999999a");
+    EXPECT_EQ(enc(1.5), "f93e00");
+    EXPECT_EQ(enc(65504.0), "f97bff");
+    EXPECT_EQ(enc(100000.0), "fa47c35000");
+    EXPECT_EQ(enc(3.4028234663852886e+38), "fa7f7fffff");
+    EXPECT_EQ(enc(1.0e+300), "fb7e37e43c8800759c");
+    EXPECT_EQ(enc(5.960464477539063e-8), "f90001");
+    EXPECT_EQ(enc(-4.1), "fbc010666666666666");
+    EXPECT_EQ(enc(INFINITY), "f97c00");
+    EXPECT_EQ(enc(-INFINITY), "f9fc00");
+    EXPECT_EQ(enc(NAN), "f97e00");
+    EXPECT_EQ(enc(false), "f4");
+    EXPECT_EQ(enc(nullptr), "f6");
+    EXPECT_EQ(enc(""), "60");
+    EXPECT_EQ(enc(std::string("IETF")), "6449455446");
+    EXPECT_EQ(hex([](auto &w) { const uint8_t b[] = {1, 2, 3, 4}; w.put_bytes(b, 4); }), "4401020304");
+    EXPECT_EQ(hex([](auto &w) { w.put_map(2).put("a").put(1).put("b").put_array(2).put(2).put(3); }), "a26161016162820203");
+    EXPECT_EQ(hex([](auto &w) { w.begin_array().put(1).put_break(); }), "9f01ff");
+    EXPECT_EQ(hex([](auto &w) { const double v[] = {1.5, 100000, 1.1}; w.put(v, 3); }), "83f93e00fa47c35000fb3ff199999999999a");
+
+    std::mt19937 gen(5);
+    std::vector<double> v(300);
+    for (auto &x : v) {
+        const double r = std::ldexp(double(int32_t(gen())), -int(gen() % 60));
+        x = gen() % 3 ? double(float(r)) : r;
+    }
+    std::vector<uint8_t> a(v.size() * 9 + 3), b(a.size());
+    utl::cbor_writer wa(a.data(), a.size()), wb(b.data(), b.size());
+    wa.put(v.data(), v.size());
+    wb.put_array(v.size());
+    for (double x : v)
+        wb.put(x);
+    ASSERT_EQ(wa.size(), wb.size());
+    EXPECT_TRUE(std::equal(a.begin(), a.begin() + wa.size(), b.begin()));
+
+    utl::cbor_writer small(buf, 4);
+    small.put("abcd");
+    EXPECT_FALSE(small.valid());
+    EXPECT_EQ(small.size(), 0u);
+    small.put(1).put(1.5).put(true).put_array(0);  // Would fit, but writer stopped
+    EXPECT_EQ(small.size(), 0u);
+    small.clear();
+    small.put(7).put("abcdef").put(8);
+    EXPECT_FALSE(small.valid());
+    EXPECT_EQ(small.size(), 1u);
+    EXPECT_EQ(buf[0], 7);
+}
+
+TEST(Cbor, PullDecoder)
+{
+    std::vector<double> samples(100);
+    for (size_t i = 0; i < samples.size(); ++i)
+        samples[i] = i % 3 ? i * 0.25 : i * 0.1;
+    uint8_t buf[2048];
+    utl::cbor_writer w(buf, sizeof(buf));
+    w.put_map(5);
+    w.put("id").put(-70000);
+    w.put("name").put("imu-3");
+    w.put("ok").put(true);
+    w.put("meta").put_tag(1).begin_map().put("x").put_array(2).put(1).put(2.5f).put_break();
+    w.put("samples").put(samples.data(), samples.size());
+    ASSERT_TRUE(w.valid());
+    EXPECT_LT(w.size(), samples.size() * 9);
+
+    utl::cbor_reader r(w.data(), w.size());
+    utl::cbor_item item;
+    ASSERT_TRUE(r.next(item));
+    EXPECT_EQ(item.type, utl::cbor_type::map);
+    EXPECT_EQ(item.val, 5u);
+    std::string_view key, name;
+    int32_t id = 0;
+    int8_t narrow;
+    bool ok = false;
+    utl::svector<double, 128> got;
+    utl::svector<double, 10> too_small;
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_TRUE(r.read(key));
+        if (key == "id") {
+            EXPECT_FALSE(r.read(narrow));
+            EXPECT_TRUE(r.read(id));
+        } else if (key == "name") {
+            EXPECT_TRUE(r.read(name));
+        } else if (key == "ok") {
+            EXPECT_TRUE(r.read(ok));
+        } else if (key == "samples") {
+            EXPECT_FALSE(r.read(too_small));
+            EXPECT_TRUE(r.read(got));
+        } else {
+            EXPECT_EQ(r.peek(), utl::cbor_type::tag);
+            EXPECT_TRUE(r.skip());
+        }
+    }
+    EXPECT_TRUE(r.done());
+    EXPECT_EQ(id, -70000);
+    EXPECT_EQ(name, "imu-3");
+    EXPECT_EQ(name.data(), reinterpret_cast<const char*>(buf) + 15);   // Points into input
+    EXPECT_TRUE(ok);
+    ASSERT_EQ(got.size(), samples.size());
+    EXPECT_TRUE(std::equal(got.begin(), got.end(), samples.begin()));
+
+    for (size_t cut = 0; cut < w.size(); ++cut) {   // Truncated input never reads out of bounds
+        utl::cbor_reader t(w.data(), cut);
+        EXPECT_FALSE(t.skip());
+    }
+    const std::vector<std::vector<uint8_t>> bad = {
+        {0x1c},         // Reserved additional info
+        {0xf8, 0x10},   // Simple value in long form
+        {0x1f},         // Indefinite integer
+        {0x42, 0x00},   // Truncated byte string
+        {0x1a, 0, 0},   // Truncated argument
+    };
+    for (auto &b : bad) {
+        utl::cbor_reader t(b.data(), b.size());
+        EXPECT_FALSE(t.next(item));
+        EXPECT_EQ(t.offset(), 0u);
+    }
+    const std::vector<std::vector<uint8_t>> bad_nested = {
+        {0x5f, 0x01, 0xff},         // Integer chunk in byte string
+        {0x5f, 0x61, 0x61, 0xff},   // Text chunk in byte string
+        {0x7f, 0x80, 0xff},         // Array chunk in text string
+        {0x7f, 0x7f, 0xff, 0xff},   // Indefinite chunk
+        {0xbf, 0x01, 0xff},         // Key without value
+        {0xbb, 0x80, 0, 0, 0, 0, 0, 0, 0, 0x01, 0x01},   // 2^63 pairs, count would wrap to 0
+        {0x9b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01},   // More items than bytes
+        {0xa2, 0x01, 0x01, 0x01},   // Second value missing
+    };
+    for (auto &b : bad_nested) {
+        utl::cbor_reader t(b.data(), b.size());
+        EXPECT_FALSE(t.skip());
+    }
+    const uint8_t chunks[] = {0x5f, 0x42, 1, 2, 0x40, 0x41, 3, 0xff, 0x7f, 0x60, 0xff};
+    utl::cbor_reader t(chunks, sizeof(chunks));
+    EXPECT_TRUE(t.skip());
+    EXPECT_TRUE(t.skip());
+    EXPECT_TRUE(t.done());
+}
+
+TEST(Sstring, BuildsWithoutHeap)
+{
+    constexpr auto key = utl::sstring("imu.") + utl::sstring("roll");
+    static_assert(key == "imu.roll" && key.capacity() == 8);
+    static_assert(utl::sstring<16>().append(-42).append(' ').append_hex(uint16_t(0xbeef)) == "-42 beef");
+    static_assert(std::is_trivially_copyable_v<utl::sstring<32>>);
+    static_assert(utl::sstring<8>().append(0.0, 1) == "0.0" && utl::sstring<8>().append(-0.0, 1) == "-0.0");
+
+    utl::sstring<64> s = "t=";
+    s += 1.5;
+    s.append(',').append(UINT64_MAX).append(',').append(-0.0049, 2).append(',').append(0.999, 2);
+    EXPECT_EQ(s, "t=1.500000,18446744073709551615,-0.00,1.00");
+    EXPECT_EQ(std::string_view(s.c_str()), s.view());
+    s.clear();
+    s.append(2.4e20, 0).append(' ').append(-1.0 / 0.0).append(' ').append(0.0 / 0.0).append(' ').append(INT64_MIN);
+    EXPECT_EQ(s, "2e+20 -inf nan -9223372036854775808");
+    s.clear();
+    s.append(1.2345e25, 3).append(' ').append(1.7976931348623157e308, 20).append(' ').append(9.9999e19, 2);
+    EXPECT_EQ(s, "1.234e+25 1.7976931348623157e+308 1.00e+20");
+    s.clear();
+    s.append(100000.0, 15).append(' ').append(1048576.5, 17);   // Digits after point that don't fit are dropped
+    EXPECT_EQ(s, "100000.00000000000000 1048576.5000000000000");
+    std::mt19937_64 gen(3);
+    for (int i = 0; i < 1000; ++i) {   // Same layout as printf, within one unit of last digit
+        const double x = std::ldexp(1.0 + double(gen() >> 11) / 9007199254740992.0, int(60 + gen() % 960));
+        const unsigned prec = unsigned(gen() % 17);
+        char ref[40];
+        snprintf(ref, sizeof(ref), "%.*e", int(prec), x);
+        const utl::sstring<40> got = utl::sstring<40>().append(x, prec);
+        const std::string_view r = ref;
+        ASSERT_EQ(got.size(), r.size()) << ref;
+        ASSERT_EQ(got.view().substr(got.view().find('e')), r.substr(r.find('e'))) << ref;
+        const double ulp = std::pow(10.0, std::atoi(ref + r.find('e') + 1) - int(prec));
+        ASSERT_LE(std::fabs(std::strtod(got.c_str(), nullptr) - std::strtod(ref, nullptr)), ulp * 1.01) << got.c_str() << " " << ref;
+    }
+    const uint8_t bin[] = {0x01, 0xab, 0xff};
+    s.clear();
+    s.append_hex(bin, sizeof(bin)).pop_back();
+    EXPECT_EQ(s, "01abf");
+    EXPECT_FALSE(s.truncated());
+
+    utl::sstring<16> text = "hello world";
+    text.erase(1).erase(4, 100).erase(9);  // Keeps order and terminator
+    EXPECT_EQ(text, "hllo");
+    EXPECT_STREQ(text.c_str(), "hllo");
+    EXPECT_EQ(std::string(text.begin(), text.end()), "hllo");
+    EXPECT_EQ(text[1], 'l');
+
+    utl::sstring<6> cut = "abc";
+    cut += "defgh";
+    EXPECT_EQ(cut, "abcdef");
+    EXPECT_TRUE(cut.truncated());
+    utl::sstring<6, utl::str_overflow::reject> whole = "abc";
+    whole.append(12345).append_hex(bin, 2).append(42);
+    EXPECT_EQ(whole, "abc42");
+    EXPECT_TRUE(whole.truncated());
+
+    utl::ring<utl::sstring<24>, 4> lines;   // Lives in raw ring storage
+    for (int i = 0; i < 3; ++i)
+        lines.put(utl::sstring<24>("line ").append(i));
+    utl::sstring<24> line;
+    ASSERT_TRUE(lines.get(line));
+    EXPECT_EQ(line, "line 0");
+    EXPECT_STREQ(line.c_str(), "line 0");
+}
+
+TEST(Window, MatchesRescan)
+{
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<double> dist(-50, 150);
+    std::vector<double> src(3000);
+    for (auto &x : src)
+        x = dist(gen);
+    for (uint32_t mask : {0u, ~0u}) {
+        const uint32_t prev = utl::cpu_restrict(mask);
+        utl::window_stats<double, 256> w(-50, 150);
+        size_t pos = 0;
+        for (size_t step : {1, 100, 1, 1, 37, 300, 5, 1000}) {
+            if (step == 1)
+                w.put(src[pos]);
+            else
+                w.write(&src[pos], step);
+            pos += step;
+            const size_t n = std::min<size_t>(pos, 256);
+            std::vector<double> win(src.begin() + (pos - n), src.begin() + pos);
+            ASSERT_EQ(w.size(), n);
+            EXPECT_TRUE(std::equal(win.begin(), win.end(), w.samples().begin()));
+            double mean = 0, var = 0;
+            for (double x : win)
+                mean += x / n;
+            for (double x : win)
+                var += n > 1 ? (x - mean) * (x - mean) / (n - 1) : 0;
+            EXPECT_NEAR(w.mean(), mean, 1e-9);
+            EXPECT_NEAR(w.variance(), var, 1e-7);
+            EXPECT_EQ(w.min(), *std::min_element(win.begin(), win.end()));
+            EXPECT_EQ(w.max(), *std::max_element(win.begin(), win.end()));
+            std::sort(win.begin(), win.end());
+            for (double p : {0.0, 10.0, 50.0, 99.0, 100.0})
+                EXPECT_NEAR(w.percentile(p), win[std::min(size_t(p / 100 * n), n - 1)], 2 * 200.0 / 64) << p;
+        }
+        utl::cpu_restrict(prev);
+    }
+    utl::window_stats<int, 4, 8> small(0, 8);
+    for (int x : {5, 1, 7, 3, 2, 6})
+        small.put(x);
+    EXPECT_EQ(small.min(), 2);
+    EXPECT_EQ(small.max(), 7);
+    EXPECT_DOUBLE_EQ(small.mean(), 4.5);
+    EXPECT_DOUBLE_EQ(small.percentile(100), 7);
+}